@@ -0,0 +1,91 @@
+#include "async_byte_stream.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+AsyncByteStream::AsyncByteStream( EventLoop& loop, uint64_t capacity ) : loop_( &loop ), stream_( capacity ) {}
+
+AsyncByteStream::~AsyncByteStream()
+{
+  try {
+    for ( auto* const waiter : { &reader_, &writer_ } ) {
+      if ( waiter->rule ) {
+        waiter->rule->cancel();
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing AsyncByteStream: " << e.what() << "\n";
+  }
+}
+
+bool AsyncByteStream::readable_now() const
+{
+  return stream_.has_error() or stream_.reader().bytes_buffered() > 0 or stream_.reader().is_finished();
+}
+
+bool AsyncByteStream::writable_now() const
+{
+  return stream_.has_error() or stream_.writer().is_closed() or stream_.writer().available_capacity() > 0;
+}
+
+void AsyncByteStream::Wait::await_suspend( const Task::Handle task ) const
+{
+  stream_->wait( reading_ ? stream_->reader_ : stream_->writer_, task );
+}
+
+void AsyncByteStream::wait( Waiter& waiter, const Task::Handle task )
+{
+  if ( waiter.task ) {
+    throw runtime_error( "AsyncByteStream: a coroutine is already waiting on this side" );
+  }
+
+  if ( not waiter.rule ) {
+    waiter.rule = loop_->add_rule(
+      loop_->task_category(),
+      [&waiter] {
+        waiter.rule->set_interest( false );
+        if ( waiter.task ) {
+          Task::resume( exchange( waiter.task, {} ) ); // may finish and destroy the AsyncByteStream
+        }
+      },
+      [] { return true; } ); // never asked: interest is explicit
+  }
+
+  waiter.task = task;
+  waiter.rule->set_interest( false );
+}
+
+void AsyncByteStream::notify( Waiter& waiter, bool ready )
+{
+  if ( waiter.task and ready ) {
+    waiter.rule->set_interest( true );
+  }
+}
+
+void AsyncByteStream::push( string data )
+{
+  stream_.writer().push( move( data ) );
+  notify( reader_, readable_now() );
+}
+
+void AsyncByteStream::close()
+{
+  stream_.writer().close();
+  notify( reader_, readable_now() );
+}
+
+void AsyncByteStream::pop( uint64_t len )
+{
+  stream_.reader().pop( len );
+  notify( writer_, writable_now() );
+}
+
+void AsyncByteStream::set_error()
+{
+  stream_.set_error();
+  notify( reader_, true );
+  notify( writer_, true );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "task.hh"
+
+#include <optional>
+
+// A ByteStream shared by coroutines on one EventLoop: `co_await stream.writable()` suspends until there is room
+// to push (or the stream is closed or has an error), and `co_await stream.readable()` until there are bytes to
+// peek (or the stream is finished or has an error).
+// 供同一EventLoop上的协程共享的ByteStream：可等待其可写（有空间）或可读（有数据）
+//
+// Push, pop, close and set errors through this object, so that a waiting coroutine is woken. It is resumed by
+// the loop, from a non-fd rule with explicit interest (see EventLoop::RuleHandle::set_interest) that is only
+// interested while the coroutine can go on, never from inside the coroutine that woke it. One coroutine at a
+// time may wait on each side.
+class AsyncByteStream
+{
+  struct Waiter
+  {
+    std::optional<EventLoop::RuleHandle> rule {};
+    Task::Handle task {};
+  };
+
+  EventLoop* loop_;
+  ByteStream stream_;
+  Waiter reader_ {};
+  Waiter writer_ {};
+
+  bool readable_now() const;
+  bool writable_now() const;
+
+  void wait( Waiter& waiter, Task::Handle task );
+  //! Has the loop resume the waiting coroutine, if there is one and it can go on.
+  static void notify( Waiter& waiter, bool ready );
+
+public:
+  //! Awaitable for AsyncByteStream::readable and AsyncByteStream::writable.
+  class Wait
+  {
+    AsyncByteStream* stream_;
+    bool reading_;
+
+  public:
+    Wait( AsyncByteStream* stream, bool reading ) : stream_( stream ), reading_( reading ) {}
+
+    bool await_ready() const { return reading_ ? stream_->readable_now() : stream_->writable_now(); }
+    void await_suspend( Task::Handle task ) const;
+    void await_resume() const {}
+  };
+
+  //! Rules go in `loop`'s task category (see EventLoop::task_category).
+  AsyncByteStream( EventLoop& loop, uint64_t capacity );
+  ~AsyncByteStream(); // cancels the rules
+
+  // the rules' callbacks refer to the object
+  AsyncByteStream( const AsyncByteStream& other ) = delete;
+  AsyncByteStream& operator=( const AsyncByteStream& other ) = delete;
+  AsyncByteStream( AsyncByteStream&& other ) = delete;
+  AsyncByteStream& operator=( AsyncByteStream&& other ) = delete;
+
+  const Reader& reader() const { return stream_.reader(); }
+  const Writer& writer() const { return stream_.writer(); }
+  bool has_error() const { return stream_.has_error(); }
+  std::string_view peek() const { return stream_.reader().peek(); }
+
+  void push( std::string data );
+  void close();
+  void pop( uint64_t len );
+  void set_error();
+
+  Wait readable() { return { this, true }; }
+  Wait writable() { return { this, false }; }
+};
@@ -1,134 +1,288 @@
 #include "bidirectional_stream_copy.hh"
 
-#include "byte_stream.hh"
+#include "async_byte_stream.hh"
+#include "async_fd.hh"
 #include "eventloop.hh"
+#include "exception.hh"
 
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace std;
 
-void bidirectional_stream_copy( Socket& socket, string_view peer_name )
+// Whether `fd` can be a splice(2) endpoint (sockets, pipes and regular files; not ttys or O_APPEND files)
+static bool spliceable( const FileDescriptor& fd )
 {
-  constexpr size_t buffer_size = 1048576;
+  struct stat st {};
+  CheckSystemCall( "fstat", fstat( fd.fd_num(), &st ) );
+  const int flags = CheckSystemCall( "fcntl", fcntl( fd.fd_num(), F_GETFL ) ); // NOLINT(*-vararg)
+  return ( S_ISSOCK( st.st_mode ) or S_ISFIFO( st.st_mode ) or S_ISREG( st.st_mode ) )
+         and not( flags & O_APPEND ); // NOLINT(*-bitwise)
+}
 
-  EventLoop eventloop {};
-  FileDescriptor input { STDIN_FILENO };
-  FileDescriptor output { STDOUT_FILENO };
-  ByteStream outbound { buffer_size };
-  ByteStream inbound { buffer_size };
-  bool outbound_shutdown { false };
-  bool inbound_shutdown { false };
+static bool is_regular_file( const FileDescriptor& fd )
+{
+  struct stat st {};
+  CheckSystemCall( "fstat", fstat( fd.fd_num(), &st ) );
+  return S_ISREG( st.st_mode );
+}
 
-  socket.set_blocking( false );
-  input.set_blocking( false );
-  output.set_blocking( false );
+// Zero-copy version of one direction of the copy: bytes go from `source` into a pipe and from the pipe to
+// `sink` with splice(2) (or straight from `source` to `sink` with sendfile(2) when `source` is a regular
+// file), so they stay in kernel pages. The pipe stands in for the ByteStream's buffer; `stream` is still
+// used for its error flag (which wakes the other direction's coroutines), and `buffered`/`capacity` give the
+// same flow control.
+void add_spliced_rules( EventLoop& eventloop,
+                        const string& name,
+                        FileDescriptor& source,
+                        FileDescriptor& sink,
+                        AsyncByteStream& stream,
+                        AsyncByteStream& other_stream,
+                        const function<void()>& finish_sink )
+{
+  struct State
+  {
+    pair<FileDescriptor, FileDescriptor> pipe { make_pipe() };
+    size_t capacity {};
+    size_t buffered {};
+    bool pipe_full {}; // the pipe ran out of slots before `capacity` bytes (each splice can take a page)
+    bool source_finished {};
+    bool sink_finished {};
+  };
+  auto state = make_shared<State>();
+
+  const auto set_error = [&stream, &other_stream] {
+    stream.set_error();
+    other_stream.set_error();
+  };
+
+  if ( is_regular_file( source ) ) {
+    eventloop.add_rule(
+      name + " (sendfile)",
+      sink,
+      Direction::Out,
+      [&source, &sink, state, finish_sink, capacity = stream.writer().available_capacity()] {
+        source.sendfile_to( sink, capacity );
+        if ( source.eof() ) {
+          state->sink_finished = true;
+          finish_sink();
+        }
+      },
+      [&stream, &other_stream, state] {
+        return not state->sink_finished and not stream.has_error() and not other_stream.has_error();
+      },
+      [] {},
+      set_error );
+    return;
+  }
+
+  // a pipe as large as the ByteStream would have been (the kernel may cap it at /proc/sys/fs/pipe-max-size)
+  const auto pipe_size = static_cast<int>( min<uint64_t>( stream.writer().available_capacity(), INT_MAX ) );
+  fcntl( state->pipe.second.fd_num(), F_SETPIPE_SZ, pipe_size ); // NOLINT(*-vararg)
+  state->capacity = CheckSystemCall( "fcntl(F_GETPIPE_SZ)",
+                                     fcntl( state->pipe.second.fd_num(), F_GETPIPE_SZ ) ); // NOLINT(*-vararg)
+  state->pipe.first.set_blocking( false );
+  state->pipe.second.set_blocking( false );
 
-  // rule 1: read from stdin into outbound byte stream
   eventloop.add_rule(
-    "read from stdin into outbound byte stream",
-    input,
+    name + " (splice in)",
+    source,
     Direction::In,
-    [&] {
-      string data;
-      data.resize( outbound.writer().available_capacity() );
-      input.read( data );
-      outbound.writer().push( move( data ) );
-      if ( input.eof() ) {
-        outbound.writer().close();
+    [&source, state] {
+      const size_t moved = source.splice_to( state->pipe.second, state->capacity - state->buffered );
+      state->buffered += moved;
+      if ( source.eof() ) {
+        state->source_finished = true;
+      } else if ( moved == 0 and state->buffered > 0 ) {
+        state->pipe_full = true;
       }
     },
-    [&] {
-      return !outbound.has_error() and !inbound.has_error() and ( outbound.writer().available_capacity() > 0 )
-             and !outbound.writer().is_closed();
+    [&stream, &other_stream, state] {
+      return not stream.has_error() and not other_stream.has_error() and state->buffered < state->capacity
+             and not state->pipe_full and not state->source_finished;
     },
-    [&] { outbound.writer().close(); },
-    [&] {
-      cerr << "DEBUG: Outbound stream had error from source.\n";
-      outbound.set_error();
-      inbound.set_error();
-    } );
-
-  // rule 2: read from outbound byte stream into socket
+    [state] { state->source_finished = true; },
+    set_error );
+
   eventloop.add_rule(
-    "read from outbound byte stream into socket",
-    socket,
+    name + " (splice out)",
+    sink,
     Direction::Out,
-    [&] {
-      if ( outbound.reader().bytes_buffered() ) {
-        outbound.reader().pop( socket.write( outbound.reader().peek() ) );
+    [&sink, state, finish_sink] {
+      if ( state->buffered ) {
+        const size_t moved = state->pipe.first.splice_to( sink, state->buffered );
+        state->buffered -= moved;
+        state->pipe_full = state->pipe_full and moved == 0;
       }
-      if ( outbound.reader().is_finished() ) {
-        socket.shutdown( SHUT_WR );
-        outbound_shutdown = true;
-        cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
+      if ( state->source_finished and state->buffered == 0 ) {
+        state->sink_finished = true;
+        finish_sink();
       }
     },
-    [&] {
-      return outbound.reader().bytes_buffered() or ( outbound.reader().is_finished() and not outbound_shutdown );
+    [state] {
+      return state->buffered or ( state->source_finished and not state->sink_finished );
     },
-    [&] { outbound.writer().close(); },
-    [&] {
-      cerr << "DEBUG: Outbound stream had error from destination.\n";
-      outbound.set_error();
-      inbound.set_error();
-    } );
-
-  // rule 3: read from socket into inbound byte stream
-  eventloop.add_rule(
-    "read from socket into inbound byte stream",
-    socket,
-    Direction::In,
-    [&] {
-      string data;
-      data.resize( inbound.writer().available_capacity() );
-      socket.read( data );
-      inbound.writer().push( move( data ) );
-      if ( socket.eof() ) {
-        inbound.writer().close();
+    [state] { state->source_finished = true; },
+    set_error );
+}
+
+// Copy-mode version of one direction, first half: reads `source` into `stream` whenever the stream has room,
+// until EOF.
+Task copy_into_stream( AsyncFD& source_waiter,
+                       FileDescriptor& source,
+                       AsyncByteStream& stream,
+                       AsyncByteStream& other_stream,
+                       string_view name )
+{
+  string data;
+  try {
+    while ( true ) {
+      co_await stream.writable();
+      if ( stream.has_error() ) {
+        break;
       }
-    },
-    [&] {
-      return !inbound.has_error() and !outbound.has_error() and ( inbound.writer().available_capacity() > 0 )
-             and !inbound.writer().is_closed();
-    },
-    [&] { inbound.writer().close(); },
-    [&] {
-      cerr << "DEBUG: Inbound stream had error from source.\n";
-      outbound.set_error();
-      inbound.set_error();
-    } );
-
-  // rule 4: read from inbound byte stream into stdout
-  eventloop.add_rule(
-    "read from inbound byte stream into stdout",
-    output,
-    Direction::Out,
-    [&] {
-      if ( inbound.reader().bytes_buffered() ) {
-        inbound.reader().pop( output.write( inbound.reader().peek() ) );
+      co_await source_waiter.readable();
+      data.resize( stream.writer().available_capacity() );
+      source.read( data );
+      stream.push( move( data ) );
+      if ( source.eof() ) {
+        stream.close();
+        break;
+      }
+    }
+  } catch ( const unix_error& ) {
+    cerr << "DEBUG: " << name << " stream had error from source.\n";
+    stream.set_error();
+    other_stream.set_error();
+  }
+}
+
+// Second half: writes what `stream` holds to `sink` whenever the sink can take it, then finishes the sink once
+// the stream is finished.
+Task copy_from_stream( AsyncFD& sink_waiter,
+                       FileDescriptor& sink,
+                       AsyncByteStream& stream,
+                       AsyncByteStream& other_stream,
+                       string_view name,
+                       const function<void()>& finish_sink )
+{
+  try {
+    while ( true ) {
+      co_await stream.readable();
+      if ( stream.has_error() ) {
+        co_return;
       }
-      if ( inbound.reader().is_finished() ) {
-        output.close();
-        inbound_shutdown = true;
-        cerr << "DEBUG: Inbound stream from " << peer_name << " finished"
-             << ( inbound.has_error() ? " uncleanly.\n" : ".\n" );
+      if ( stream.reader().is_finished() ) {
+        finish_sink();
+        co_return;
       }
-    },
-    [&] {
-      return inbound.reader().bytes_buffered() or ( inbound.reader().is_finished() and not inbound_shutdown );
-    },
-    [&] { inbound.writer().close(); },
-    [&] {
-      cerr << "DEBUG: Inbound stream had error from destination.\n";
-      outbound.set_error();
-      inbound.set_error();
-    } );
-
-  // loop until completion
-  while ( true ) {
-    if ( EventLoop::Result::Exit == eventloop.wait_next_event( -1 ) ) {
-      return;
+      co_await sink_waiter.writable();
+      if ( sink_waiter.gone( Direction::Out ) ) {
+        break; // hung up (or failed): writing would only raise SIGPIPE
+      }
+      stream.pop( sink.write( stream.peek() ) );
     }
+  } catch ( const unix_error& ) { // NOLINT(*-empty-catch): reported below, like a hangup
   }
+  cerr << "DEBUG: " << name << " stream had error from destination.\n";
+  stream.set_error();
+  other_stream.set_error();
+}
+
+void bidirectional_stream_copy( Socket& socket, string_view peer_name, CopyMode mode )
+{
+  constexpr size_t buffer_size = 1048576;
+
+  EventLoop eventloop {};
+  FileDescriptor input { STDIN_FILENO };
+  FileDescriptor output { STDOUT_FILENO };
+  // after the loop, so that they go (cancelling their rules) before it destroys any coroutine still waiting
+  AsyncByteStream outbound { eventloop, buffer_size };
+  AsyncByteStream inbound { eventloop, buffer_size };
+  AsyncFD input_waiter { eventloop, input };
+  AsyncFD output_waiter { eventloop, output };
+  AsyncFD socket_waiter { eventloop, socket };
+
+  socket.set_blocking( false );
+  input.set_blocking( false );
+  output.set_blocking( false );
+
+  const bool splice_outbound = mode == CopyMode::ZeroCopy and spliceable( input ) and spliceable( socket );
+  const bool splice_inbound = mode == CopyMode::ZeroCopy and spliceable( socket ) and spliceable( output );
+
+  const function<void()> finish_outbound = [&socket, peer_name] {
+    socket.shutdown( SHUT_WR );
+    cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
+  };
+  const function<void()> finish_inbound = [&output, &inbound, peer_name] {
+    output.close();
+    cerr << "DEBUG: Inbound stream from " << peer_name << " finished"
+         << ( inbound.has_error() ? " uncleanly.\n" : ".\n" );
+  };
+
+  if ( splice_outbound ) {
+    add_spliced_rules( eventloop, "stdin to socket", input, socket, outbound, inbound, finish_outbound );
+  } else {
+    eventloop.spawn( copy_into_stream( input_waiter, input, outbound, inbound, "Outbound" ) );
+    eventloop.spawn( copy_from_stream( socket_waiter, socket, outbound, inbound, "Outbound", finish_outbound ) );
+  }
+
+  if ( splice_inbound ) {
+    add_spliced_rules( eventloop, "socket to stdout", socket, output, inbound, outbound, finish_inbound );
+  } else {
+    eventloop.spawn( copy_into_stream( socket_waiter, socket, inbound, outbound, "Inbound" ) );
+    eventloop.spawn( copy_from_stream( output_waiter, output, inbound, outbound, "Inbound", finish_inbound ) );
+  }
+
+  // loop until completion, or until an error (which leaves coroutines waiting on fds that will never be ready)
+  while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit
+          and not( outbound.has_error() and inbound.has_error() ) ) {}
+
+  if ( FDStatsRegistry::enabled() ) {
+    FDStatsRegistry::dump( cerr ); // MINNOW_FD_STATS=1
+  }
+  if ( eventloop.profiling() ) {
+    eventloop.dump_stats( cerr ); // MINNOW_LOOP_STATS=1
+  }
+}
+
+// The whole connection as one coroutine: it waits for the socket with co_await instead of splitting the copy
+// into rules that share state.
+Task echo_session( EventLoop& eventloop, TCPSocket socket )
+{
+  constexpr size_t buffer_size = 65536;
+
+  AsyncFD connection { eventloop, socket };
+  string buffer;
+  try {
+    while ( true ) {
+      co_await connection.readable();
+      buffer.resize( buffer_size );
+      socket.read( buffer );
+      if ( socket.eof() ) {
+        break;
+      }
+
+      string_view unsent { buffer };
+      while ( not unsent.empty() ) {
+        co_await connection.writable();
+        unsent.remove_prefix( socket.write( unsent ) );
+      }
+    }
+    socket.shutdown( SHUT_WR );
+  } catch ( const unix_error& ) {
+    // the peer went away (reset, or hung up mid-write): that ends this session only
+  }
+}
+
+void add_echo_session( EventLoop& eventloop, TCPSocket&& socket )
+{
+  socket.set_blocking( false );
+  eventloop.spawn( echo_session( eventloop, move( socket ) ) );
 }
@@ -1,6 +1,17 @@
 #pragma once
 
+#include "eventloop.hh"
 #include "socket.hh"
 
+enum class CopyMode : uint8_t
+{
+  Copy,    //!< Read into user space and write back out (through a ByteStream) in both directions
+  ZeroCopy //!< Use splice/sendfile for each direction whose endpoints allow it, and copy the rest
+};
+
 //! Copy socket input/output to stdin/stdout until finished
-void bidirectional_stream_copy( Socket& socket, std::string_view peer_name );
+void bidirectional_stream_copy( Socket& socket, std::string_view peer_name, CopyMode mode = CopyMode::Copy );
+
+//! Serve `socket` on `eventloop` by copying what the peer sends back to it, until the peer finishes sending.
+//! The session is a coroutine (see EventLoop::spawn) that owns the socket.
+void add_echo_session( EventLoop& eventloop, TCPSocket&& socket );
@@ -1,5 +1,7 @@
 #include "bidirectional_stream_copy.hh"
+#include "core_runtime.hh"
 
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -9,8 +11,10 @@ using namespace std;
 
 void show_usage( const char* argv0 )
 {
-  cerr << "Usage: " << argv0 << " [-l] <host> <port>\n\n"
-       << "  -l specifies listen mode; <host>:<port> is the listening address.\n";
+  cerr << "Usage: " << argv0 << " [-l | -c] <host> <port>\n\n"
+       << "  -l specifies listen mode; <host>:<port> is the listening address.\n"
+       << "  -c listens on every core (one event loop per CPU, sharing <host>:<port> with SO_REUSEPORT),\n"
+       << "     accepting any number of connections and copying each one's input back to it.\n";
 }
 
 int main( int argc, char** argv )
@@ -29,6 +33,20 @@ int main( int argc, char** argv )
       return EXIT_FAILURE;
     }
 
+    // every core: each connection lives on the loop (and thread) that accepted it
+    if ( strncmp( "-c", args[1], 3 ) == 0 ) {
+      if ( argc < 4 ) {
+        show_usage( args[0] );
+        return EXIT_FAILURE;
+      }
+      CoreRuntime runtime { { args[2], args[3] }, add_echo_session };
+      EventLoop::dump_stats_on_signal( SIGUSR1 ); // with MINNOW_LOOP_STATS=1, each loop's stats on `kill -USR1`
+      cerr << "DEBUG: Listening on " << runtime.address().to_string() << " with " << runtime.threads()
+           << " event loops...\n";
+      runtime.run();
+      return EXIT_SUCCESS;
+    }
+
     // in client mode, connect; in server mode, accept exactly one connection
     auto socket = [&] {
       if ( server_mode ) {
@@ -49,7 +67,8 @@ int main( int argc, char** argv )
       return connecting_socket;
     }();
 
-    bidirectional_stream_copy( socket, socket.peer_address().to_string() );
+    // a kernel socket: move data with splice/sendfile where stdin/stdout allow it
+    bidirectional_stream_copy( socket, socket.peer_address().to_string(), CopyMode::ZeroCopy );
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
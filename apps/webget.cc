@@ -148,11 +148,10 @@ void get_URL( const string& host, const string& path )
 
   socket.write(request);
   // 循环读取并打印服务器的响应
-  string buffer;
+  // 每次读取都复用内存池中的同一块缓冲区，不再反复分配和清零
+  BufferPool pool { 16384 };
   while ( !socket.eof() ) {
-    socket.read( buffer );
-    cout << buffer;
-    buffer.clear();
+    cout << socket.read( pool ).view();
   }
   /*
    * ⚙️ 深度解析：`while (!socket.eof())` 循环的底层工作原理
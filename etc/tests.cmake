@@ -23,6 +23,28 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_stress_sharded)
+
+ttest(buffer_pool)
+ttest(fd_read_size)
+ttest(fd_handle)
+ttest(fd_splice)
+ttest(fd_stats)
+ttest(fd_try_io)
+ttest(io_uring)
+ttest(eventloop_epoll)
+ttest(eventloop_dispatch)
+ttest(timer_wheel)
+ttest(core_runtime)
+ttest(eventloop_rules)
+ttest(eventloop_interest)
+ttest(eventloop_coroutines)
+ttest(eventloop_stats)
+ttest(eventloop_post)
+ttest(eventloop_priority)
+ttest(mapped_file)
+ttest(file_sink)
+ttest(zerocopy)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -92,3 +114,9 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+
+# ~10^8 randomized steps against the optimized libraries: named as a speed test so that it runs with `speed`
+# (and the other speed tests) rather than in the default check
+add_test(NAME byte_stream_stress_speed_test COMMAND byte_stream_stress_test_optimized)
+set_property(TEST byte_stream_stress_speed_test PROPERTY FIXTURES_REQUIRED compile_opt)
+set_property(TEST byte_stream_stress_speed_test PROPERTY TIMEOUT 60)
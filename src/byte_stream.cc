@@ -1,12 +1,61 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
+
 using namespace std;
 
 ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
 
+// Takes ownership of `data`: the string's own allocation becomes the buffered chunk, so nothing is copied.
+// If it doesn't all fit, the excess is truncated in place -- unless only a small part of the allocation
+// would be used, in which case the prefix is copied so a large buffer isn't pinned for a few bytes.
 void Writer::push( string data )
 {
-  (void)data; // Your code here.
+  if ( data.size() > available_capacity() ) {
+    if ( available_capacity() < data.capacity() / 2 ) {
+      push( string_view { data } );
+      return;
+    }
+    data.resize( available_capacity() );
+  }
+
+  if ( data.empty() ) {
+    return;
+  }
+
+  bytes_pushed_ += data.size();
+  buffer_.push_back( move( data ) );
+}
+
+// Copies only the prefix of `data` that fits: one allocation of at most available_capacity() bytes,
+// and none at all if the stream is full.
+void Writer::push( string_view data )
+{
+  data = data.substr( 0, available_capacity() );
+
+  if ( data.empty() ) {
+    return;
+  }
+
+  bytes_pushed_ += data.size();
+  buffer_.emplace_back( data );
+}
+
+// An owned Ref is released into the stream with no copy (as in push( string ));
+// a borrowed Ref can't outlive its owner, so the bytes that fit are copied (as in push( string_view )).
+void Writer::push( Ref<string> data )
+{
+  if ( data.is_borrowed() ) {
+    push( string_view { data.get() } );
+    return;
+  }
+
+  push( data.release() );
+}
+
+void Writer::push( const char* data )
+{
+  push( string_view { data } );
 }
 
 void Writer::close()
@@ -30,41 +79,56 @@ c++98就有了
 */
 bool Writer::is_closed() const
 {
-  return {}; // Your code here.
+  return closed_;
 }
 
 uint64_t Writer::available_capacity() const
 {
-  return {}; // Your code here.
+  return capacity_ - ( bytes_pushed_ - bytes_poped_ );
 }
 
 uint64_t Writer::bytes_pushed() const
 {
-  return {}; // Your code here.
+  return bytes_pushed_;
 }
 
 string_view Reader::peek() const
 {
-  return {}; // Your code here.
+  if ( buffer_.empty() ) {
+    return {};
+  }
+  return string_view { buffer_.front() }.substr( front_offset_ );
 }
 
 void Reader::pop( uint64_t len )
 {
-  (void)len; // Your code here.
+  len = min( len, bytes_buffered() );
+  bytes_poped_ += len;
+
+  while ( len > 0 ) {
+    const uint64_t front_remaining = buffer_.front().size() - front_offset_;
+    if ( len < front_remaining ) {
+      front_offset_ += len;
+      return;
+    }
+    len -= front_remaining;
+    buffer_.pop_front();
+    front_offset_ = 0;
+  }
 }
 
 bool Reader::is_finished() const
 {
-  return {}; // Your code here.
+  return closed_ and bytes_buffered() == 0;
 }
 
 uint64_t Reader::bytes_buffered() const
 {
-  return {}; // Your code here.
+  return bytes_pushed_ - bytes_poped_;
 }
 
 uint64_t Reader::bytes_popped() const
 {
-  return {}; // Your code here.
+  return bytes_poped_;
 }
 
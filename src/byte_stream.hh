@@ -1,12 +1,12 @@
 #pragma once
 
+#include "ref.hh"
+
 #include <cstdint>
+#include <deque>
 #include <string>
 #include <string_view>
 
-// 需要队列
-#include <queue>
-
 class Reader;
 class Writer;
 
@@ -58,7 +58,12 @@ protected:
   */
 
   // 因为数据是写到缓冲区的，所以命名为buffer_
-  std::queue<char> buffer_ {}; 
+  // Buffered chunks in push order; each chunk is kept whole so that peek() can return it without copying.
+  // 按写入顺序保存的数据块；每个块整体保存，peek()可以直接返回视图而无需拷贝
+  std::deque<std::string> buffer_ {};
+  // Bytes of buffer_.front() that have already been popped
+  // buffer_.front()中已经被弹出的字节数
+  uint64_t front_offset_ {};
   // 已写
   uint64_t bytes_pushed_ {};
   // 已读
@@ -72,6 +77,9 @@ class Writer : public ByteStream
 {
 public:
   void push( std::string data );       // Push data to stream, but only as much as available capacity allows.          // 将数据推送到流中，但仅限于可用容量允许的范围
+  void push( std::string_view data );  // Same, copying only the bytes that fit (one allocation, none if nothing fits) // 同上，只拷贝能放下的字节
+  void push( Ref<std::string> data );  // Same; an owned Ref is moved in without copying, a borrowed Ref is copied as a string_view // 同上；owned的Ref直接移入，borrowed的Ref按string_view拷贝
+  void push( const char* data );       // Same as the string_view overload (keeps push( "literal" ) unambiguous)       // 同string_view重载（使push( "literal" )不产生歧义）
   void close();                        // Signal that the stream has reached its ending. Nothing more will be written. // 表示流已到达结束位置，不会再写入任何内容
 
   bool is_closed() const;              // Has the stream been closed?                                   // 流是否已关闭？
@@ -0,0 +1,67 @@
+#include "address.hh"
+#include "bench.hh"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+void program_body()
+{
+  BenchmarkSuite suite { "Address" };
+
+  suite.add( "Address( \"18.243.0.1\", 80 )", []( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const Address addr { "18.243.0.1", 80 };
+      do_not_optimize( addr );
+    }
+  } );
+
+  suite.add( "Address::from_ipv4_numeric", []( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const Address addr = Address::from_ipv4_numeric( 0x12f30001 + static_cast<uint32_t>( i ) );
+      do_not_optimize( addr );
+    }
+  } );
+
+  const Address addr { "18.243.0.1", 80 };
+
+  suite.add( "Address::ipv4_numeric", [&addr]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      do_not_optimize( addr.ipv4_numeric() );
+    }
+  } );
+
+  suite.add( "Address::ip_port", [&addr]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      do_not_optimize( addr.ip_port() );
+    }
+  } );
+
+  suite.add( "Address::to_string", [&addr]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      do_not_optimize( addr.to_string() );
+    }
+  } );
+
+  suite.add( "Address::operator==", [&addr]( uint64_t iterations ) {
+    const Address other = Address::from_ipv4_numeric( addr.ipv4_numeric() );
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      do_not_optimize( addr == other );
+    }
+  } );
+
+  suite.run();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "bench.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+duration<double, nano> time_body( const BenchmarkSuite::BodyT& body, const uint64_t iterations )
+{
+  clobber_memory();
+  const auto start = steady_clock::now();
+  body( iterations );
+  clobber_memory();
+  return steady_clock::now() - start;
+}
+
+double BenchmarkResult::gigabits_per_second() const
+{
+  return 8.0 * static_cast<double>( bytes_per_iteration ) / median_ns;
+}
+
+BenchmarkSuite::BenchmarkSuite( string name, BenchmarkOptions options )
+  : name_( move( name ) ), options_( options )
+{}
+
+void BenchmarkSuite::add( string name, BodyT body, uint64_t bytes_per_iteration )
+{
+  cases_.push_back( { move( name ), move( body ), bytes_per_iteration } );
+}
+
+BenchmarkResult BenchmarkSuite::run_case( const Case& c, PerfCounters* counters ) const
+{
+  // calibrate: grow the iteration count until one sample takes at least sample_time
+  uint64_t iterations = 1;
+  while ( true ) {
+    const auto elapsed = time_body( c.body, iterations );
+    if ( elapsed >= options_.sample_time ) {
+      break;
+    }
+    const double ratio = elapsed.count() > 0 ? duration<double, nano>( options_.sample_time ) / elapsed : 10;
+    iterations = static_cast<uint64_t>( static_cast<double>( iterations ) * clamp( ratio * 1.2, 2.0, 10.0 ) );
+  }
+
+  // warm up caches, branch predictors and the allocator at the calibrated size
+  const auto warmup_start = steady_clock::now();
+  while ( steady_clock::now() - warmup_start < options_.warmup_time ) {
+    time_body( c.body, iterations );
+  }
+
+  vector<double> ns_per_iteration;
+  ns_per_iteration.reserve( options_.samples );
+  if ( counters ) {
+    counters->start();
+  }
+  for ( unsigned int i = 0; i < options_.samples; ++i ) {
+    ns_per_iteration.push_back( time_body( c.body, iterations ).count() / static_cast<double>( iterations ) );
+  }
+  if ( counters ) {
+    counters->stop();
+  }
+  sort( ns_per_iteration.begin(), ns_per_iteration.end() );
+
+  const auto percentile = [&]( double p ) {
+    const auto rank = static_cast<size_t>( ceil( p * static_cast<double>( ns_per_iteration.size() ) ) );
+    return ns_per_iteration.at( clamp<size_t>( rank, 1, ns_per_iteration.size() ) - 1 );
+  };
+
+  return { c.name,
+           iterations,
+           percentile( 0.5 ),
+           percentile( 0.99 ),
+           c.bytes_per_iteration,
+           counters ? optional { counters->reading() } : nullopt };
+}
+
+vector<BenchmarkResult> BenchmarkSuite::run() const
+{
+  const char* filter = getenv( "BENCH_FILTER" );
+
+  optional<PerfCounters> counters;
+  if ( PerfCounters::requested() ) {
+    counters.emplace();
+    if ( not counters->available() ) {
+      cout << "(BENCH_COUNTERS: perf_event_open is not available here; reporting times only)\n";
+      counters.reset();
+    } else if ( not counters->has_hardware_counters() ) {
+      cout << "(BENCH_COUNTERS: no hardware counters available; reporting software counters only)\n";
+    }
+  }
+
+  cout << name_ << "\n";
+  cout << "  " << left << setw( 56 ) << "benchmark" << right << setw( 12 ) << "iterations" << setw( 14 )
+       << "median ns" << setw( 14 ) << "p99 ns" << setw( 12 ) << "Gbit/s" << "\n";
+
+  vector<BenchmarkResult> results;
+  for ( const auto& c : cases_ ) {
+    if ( filter and c.name.find( filter ) == string::npos ) {
+      continue;
+    }
+
+    const auto& r = results.emplace_back( run_case( c, counters ? &*counters : nullptr ) );
+    cout << "  " << left << setw( 56 ) << r.name << right << setw( 12 ) << r.iterations_per_sample << fixed
+         << setprecision( 1 ) << setw( 14 ) << r.median_ns << setw( 14 ) << r.p99_ns;
+    if ( r.bytes_per_iteration ) {
+      cout << setprecision( 2 ) << setw( 12 ) << r.gigabits_per_second();
+    }
+    cout << "\n";
+    if ( r.counters ) {
+      const auto total_iterations = static_cast<double>( r.iterations_per_sample * options_.samples );
+      cout << "    "
+           << ( r.bytes_per_iteration
+                  ? r.counters->describe( total_iterations * static_cast<double>( r.bytes_per_iteration ), "B" )
+                  : r.counters->describe( total_iterations, "op" ) )
+           << "\n";
+    }
+    cout << flush;
+  }
+  cout << "\n";
+
+  return results;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "perf_counters.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Make the compiler assume `value` is read, so the computation that produced it can't be optimized away.
+template<typename T>
+inline void do_not_optimize( const T& value )
+{
+  asm volatile( "" : : "r,m"( value ) : "memory" );
+}
+
+// Make the compiler assume all memory is read and written here, so pending stores can't be elided.
+inline void clobber_memory()
+{
+  asm volatile( "" : : : "memory" );
+}
+
+struct BenchmarkResult
+{
+  std::string name;
+  uint64_t iterations_per_sample;
+  double median_ns; // per iteration
+  double p99_ns;    // per iteration
+  uint64_t bytes_per_iteration;
+  std::optional<PerfReading> counters; // totals over all samples, if BENCH_COUNTERS was set
+
+  double gigabits_per_second() const;
+};
+
+struct BenchmarkOptions
+{
+  std::chrono::nanoseconds warmup_time { std::chrono::milliseconds { 50 } };
+  std::chrono::nanoseconds sample_time { std::chrono::milliseconds { 2 } };
+  unsigned int samples { 101 };
+};
+
+// A named group of microbenchmarks. Each case is a body that performs `n` iterations of the
+// operation being measured; the runner warms it up, picks `n` so that one sample takes about
+// sample_time, and reports the median and 99th-percentile time per iteration over all samples.
+class BenchmarkSuite
+{
+public:
+  using BodyT = std::function<void( uint64_t iterations )>;
+
+private:
+  struct Case
+  {
+    std::string name;
+    BodyT body;
+    uint64_t bytes_per_iteration;
+  };
+
+  std::string name_;
+  BenchmarkOptions options_;
+  std::vector<Case> cases_ {};
+
+  BenchmarkResult run_case( const Case& c, PerfCounters* counters ) const;
+
+public:
+  explicit BenchmarkSuite( std::string name, BenchmarkOptions options = {} );
+
+  // bytes_per_iteration (optional) adds a throughput column
+  void add( std::string name, BodyT body, uint64_t bytes_per_iteration = 0 );
+
+  // Runs every case (or only those whose name contains $BENCH_FILTER) and prints a table to stdout.
+  // With $BENCH_COUNTERS set, each case is followed by its perf_event counters per byte (or per iteration).
+  std::vector<BenchmarkResult> run() const;
+};
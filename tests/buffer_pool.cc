@@ -0,0 +1,79 @@
+#include "buffer_pool.hh"
+#include "expect.hh"
+#include "file_descriptor.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+
+using namespace std;
+
+void recycles_slabs()
+{
+  BufferPool pool { 4096 };
+
+  const char* first_data = nullptr;
+  {
+    PooledBuffer buf = pool.acquire();
+    expect( buf.empty() and buf.capacity() == 4096, "fresh buffer is empty with slab capacity" );
+    first_data = buf.data();
+
+    PooledBuffer copy = buf;
+    expect( buf.use_count() == 2, "copies share the slab" );
+    expect( pool.available() == 0, "slab is not free while in use" );
+  }
+
+  expect( pool.available() == 1, "slab returns to freelist when last handle drops" );
+
+  PooledBuffer again = pool.acquire();
+  expect( again.data() == first_data, "freed slab is reused" );
+  expect( pool.allocated() == 1, "no new slab allocated in steady state" );
+
+  PooledBuffer moved = move( again );
+  expect( again.use_count() == 0 and moved.use_count() == 1, "move transfers the reference" );
+
+  moved = moved; // NOLINT(*-self-assign*)
+  expect( moved.use_count() == 1 and pool.available() == 0, "self-assignment keeps the slab" );
+}
+
+void buffer_outlives_pool()
+{
+  optional<BufferPool> pool { in_place, 64 };
+  PooledBuffer buf = pool->acquire();
+  buf.resize( 5 );
+  buf.data()[0] = 'x';
+  pool.reset();
+  expect( buf.size() == 5 and buf.view().front() == 'x', "buffer stays valid after its pool is gone" );
+}
+
+void read_from_pipe()
+{
+  auto [read_end, write_end] = make_pipe();
+
+  BufferPool pool { 8 };
+  write_end.write( "hello, world" );
+
+  const PooledBuffer first = read_end.read( pool );
+  expect( first.view() == "hello, w", "read fills up to slab capacity" );
+  const PooledBuffer second = read_end.read( pool );
+  expect( second.view() == "orld", "read returns the rest" );
+  expect( pool.allocated() == 2, "both buffers are live" );
+
+  write_end.close();
+  expect( read_end.read( pool ).empty() and read_end.eof(), "EOF gives an empty buffer" );
+  expect( pool.allocated() == 3 and pool.available() == 1, "buffer used for the EOF read is recycled" );
+}
+
+int main()
+{
+  try {
+    recycles_slabs();
+    buffer_outlives_pool();
+    read_from_pipe();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "bench.hh"
+#include "byte_stream.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// push `write_size` bytes and drain them `read_size` bytes at a time, once per iteration
+template<typename PushFn>
+BenchmarkSuite::BodyT push_and_drain( size_t write_size, size_t read_size, PushFn push )
+{
+  return [write_size, read_size, push]( uint64_t iterations ) {
+    ByteStream bs { 1 << 16 };
+    const string data( write_size, 'x' );
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      push( bs.writer(), data );
+      while ( bs.reader().bytes_buffered() ) {
+        const auto peeked = bs.reader().peek().substr( 0, read_size );
+        do_not_optimize( peeked );
+        bs.reader().pop( peeked.size() );
+      }
+    }
+    do_not_optimize( bs );
+  };
+}
+
+void program_body()
+{
+  BenchmarkSuite suite { "ByteStream" };
+
+  for ( const size_t read_size : { 4096, 128, 32 } ) {
+    const string suffix = "(write 1500, read " + to_string( read_size ) + ")";
+    suite.add( "push(string) " + suffix,
+               push_and_drain( 1500, read_size, []( Writer& w, const string& d ) { w.push( string { d } ); } ),
+               1500 );
+    suite.add( "push(string_view) " + suffix,
+               push_and_drain( 1500, read_size, []( Writer& w, const string& d ) { w.push( string_view { d } ); } ),
+               1500 );
+    suite.add( "push(Ref<string>) borrowed " + suffix,
+               push_and_drain( 1500, read_size, []( Writer& w, const string& d ) { w.push( borrow( d ) ); } ),
+               1500 );
+  }
+
+  suite.add( "push(string_view) 1 byte, pop 1 byte",
+             push_and_drain( 1, 1, []( Writer& w, const string& d ) { w.push( string_view { d } ); } ),
+             1 );
+
+  suite.add( "push into full stream", []( uint64_t iterations ) {
+    ByteStream bs { 16 };
+    bs.writer().push( string( 16, 'x' ) );
+    const string data( 1500, 'y' );
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      bs.writer().push( string_view { data } );
+    }
+    do_not_optimize( bs );
+  } );
+
+  suite.run();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
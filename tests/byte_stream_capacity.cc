@@ -96,6 +96,22 @@ int main()
       test.execute( BytesBuffered { 1 } );
     }
 
+    {
+      ByteStreamTestHarness test { "overwrite-with-refs", 4 };
+
+      test.execute( PushRef { "cat" } );
+      test.execute( BytesPushed { 3 } );
+      test.execute( PushRef { "dog", true } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Peek { "catd" } );
+      test.execute( Pop { 2 } );
+      test.execute( PushRef { "bird" } );
+      test.execute( PushRef { "fish", true } );
+      test.execute( BytesBuffered { 4 } );
+      test.execute( Peek { "tdbi" } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -1,10 +1,12 @@
 #include "byte_stream.hh"
+#include "perf_counters.hh"
 
 #include <chrono>
 #include <cstddef>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <queue>
 #include <random>
 
@@ -39,6 +41,12 @@ double speed_test( fstream& debug_output,
   string output_data;
   output_data.reserve( data.size() );
 
+  optional<PerfCounters> counters;
+  if ( PerfCounters::requested() ) {
+    counters.emplace();
+    counters->start();
+  }
+
   const auto start_time = steady_clock::now();
   while ( not bs.reader().is_finished() ) {
     if ( split_data.empty() ) {
@@ -64,6 +72,10 @@ double speed_test( fstream& debug_output,
 
   const auto stop_time = steady_clock::now();
 
+  if ( counters ) {
+    counters->stop();
+  }
+
   if ( data != output_data ) {
     throw runtime_error( "Mismatch between data written and read" );
   }
@@ -76,6 +88,10 @@ double speed_test( fstream& debug_output,
   cout << "ByteStream with capacity=" << capacity << ", write_size=" << write_size << ", read_size=" << read_size
        << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
 
+  if ( counters ) {
+    cout << "    " << counters->reading().describe( static_cast<double>( input_len ), "B" ) << "\n";
+  }
+
   auto read_s = to_string( read_size );
   string fill( 5 - read_s.size(), ' ' );
   debug_output << "        ByteStream throughput (pop length " << read_s << "):" << fill << fixed
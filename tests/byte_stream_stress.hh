@@ -0,0 +1,81 @@
+#pragma once
+
+#include "byte_stream_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+// Randomized push/peek/pop against a ByteStream of `capacity`, checking every counter after each step.
+// Returns the number of harness steps executed (0 if the test was skipped).
+inline uint64_t stress_test( const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+{
+  std::default_random_engine rd { random_seed };
+
+  const std::string data = [&rd, &input_len] {
+    std::uniform_int_distribution<char> ud;
+    std::string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  ByteStreamTestHarness bs {
+    "stress test input=" + std::to_string( input_len ) + ", capacity=" + std::to_string( capacity ), capacity };
+  if ( bs.skipped() ) {
+    return 0;
+  }
+
+  size_t expected_bytes_pushed {};
+  size_t expected_bytes_popped {};
+  size_t expected_available_capacity { capacity };
+  while ( expected_bytes_pushed < data.size() or expected_bytes_popped < data.size() ) {
+    bs.execute( BytesPushed { expected_bytes_pushed } );
+    bs.execute( BytesPopped { expected_bytes_popped } );
+    bs.execute( AvailableCapacity { expected_available_capacity } );
+    bs.execute( BytesBuffered { expected_bytes_pushed - expected_bytes_popped } );
+
+    /* write something */
+    std::uniform_int_distribution<size_t> bytes_to_push_dist { 0, data.size() - expected_bytes_pushed };
+    const size_t amount_to_push = bytes_to_push_dist( rd );
+    bs.execute( Push { data.substr( expected_bytes_pushed, amount_to_push ) } );
+    expected_bytes_pushed += std::min( amount_to_push, expected_available_capacity );
+    expected_available_capacity -= std::min( amount_to_push, expected_available_capacity );
+
+    bs.execute( BytesPushed { expected_bytes_pushed } );
+    bs.execute( AvailableCapacity { expected_available_capacity } );
+
+    if ( expected_bytes_pushed == data.size() ) {
+      bs.execute( Close {} );
+    }
+
+    /* read something */
+    const size_t peek_size = bs.peek_size();
+    if ( ( expected_bytes_pushed != expected_bytes_popped ) and peek_size == 0 ) {
+      throw std::runtime_error( "ByteStream::reader().peek() returned empty view" );
+    }
+    if ( expected_bytes_popped + peek_size > expected_bytes_pushed ) {
+      throw std::runtime_error( "ByteStream::reader().peek() returned too-large view" );
+    }
+
+    bs.execute( PeekOnce { data.substr( expected_bytes_popped, peek_size ) } );
+
+    std::uniform_int_distribution<size_t> bytes_to_pop_dist { 0, peek_size };
+    const size_t amount_to_pop = bytes_to_pop_dist( rd );
+
+    bs.execute( Pop { amount_to_pop } );
+    expected_bytes_popped += amount_to_pop;
+    expected_available_capacity += amount_to_pop;
+    bs.execute( BytesPopped { expected_bytes_popped } );
+  }
+
+  bs.execute( IsClosed { true } );
+  bs.execute( IsFinished { true } );
+
+  return bs.steps_completed();
+}
@@ -0,0 +1,121 @@
+#include "byte_stream_stress.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Runs many randomized stress tests with configurations drawn from consecutive seeds, sharded across one
+// worker thread per core. Each worker owns its ByteStream (via its own test harness) and RNG.
+//
+// Environment:
+//   STRESS_CONFIGS=n   number of configurations (seeds 1..n) to run (default 10000)
+//   STRESS_SEED=s      replay only seed s, on the calling thread
+
+struct StressConfig
+{
+  size_t seed;
+  size_t input_len;
+  size_t capacity;
+
+  // The configuration is drawn from the seed itself, so the seed alone is enough to replay it.
+  // Sizes are log-uniform so that tiny and large streams are both well covered.
+  static StressConfig from_seed( size_t seed )
+  {
+    default_random_engine rd { seed };
+    const auto log_uniform = [&rd]( size_t min_value, unsigned int max_log2 ) {
+      const auto log2 = uniform_int_distribution<unsigned int> { 0, max_log2 }( rd );
+      return uniform_int_distribution<size_t> { min_value, size_t { 1 } << log2 }( rd );
+    };
+    const size_t input_len = log_uniform( 1, 12 );
+    const size_t capacity = log_uniform( 1, 12 );
+    return { seed, input_len, capacity };
+  }
+
+  string str() const
+  {
+    return "seed " + to_string( seed ) + " (input=" + to_string( input_len ) + ", capacity="
+           + to_string( capacity ) + ")";
+  }
+
+  uint64_t run() const { return stress_test( input_len, capacity, seed ); }
+};
+
+static size_t env_or( const char* name, size_t default_value )
+{
+  const char* value = getenv( name );
+  return value ? stoull( value ) : default_value;
+}
+
+void program_body( const string& program_name )
+{
+  if ( getenv( "STRESS_SEED" ) ) {
+    StressConfig::from_seed( env_or( "STRESS_SEED", 0 ) ).run();
+    return;
+  }
+
+  const size_t config_count = env_or( "STRESS_CONFIGS", 10000 );
+  const unsigned int worker_count = max( 1U, thread::hardware_concurrency() );
+
+  atomic<size_t> next_seed { 1 };
+  atomic<bool> stop { false };
+  mutex failures_mutex;
+  vector<pair<StressConfig, string>> failures;
+
+  const auto worker = [&] {
+    while ( not stop.load( memory_order_relaxed ) ) {
+      const size_t seed = next_seed.fetch_add( 1, memory_order_relaxed );
+      if ( seed > config_count ) {
+        return;
+      }
+
+      const auto config = StressConfig::from_seed( seed );
+      try {
+        config.run();
+      } catch ( const exception& e ) {
+        const lock_guard lock { failures_mutex };
+        failures.emplace_back( config, e.what() );
+        stop = true;
+      }
+    }
+  };
+
+  vector<thread> workers;
+  workers.reserve( worker_count );
+  for ( unsigned int i = 0; i < worker_count; ++i ) {
+    workers.emplace_back( worker );
+  }
+  for ( auto& w : workers ) {
+    w.join();
+  }
+
+  if ( not failures.empty() ) {
+    sort( failures.begin(), failures.end(), []( const auto& a, const auto& b ) {
+      return a.first.seed < b.first.seed;
+    } );
+    for ( const auto& [config, what] : failures ) {
+      cerr << "Failed: stress test with " << config.str() << ": " << what << "\n";
+      cerr << "  replay with: STRESS_SEED=" << config.seed << " " << program_name << "\n";
+    }
+    throw runtime_error( to_string( failures.size() ) + " stress configuration(s) failed" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body( argc > 0 ? argv[0] : "byte_stream_stress_sharded" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -30,7 +30,25 @@ struct Push : public Action<ByteStream>
 
   explicit Push( std::string data ) : data_( move( data ) ) {}
   std::string description() const override { return "push \"" + pretty_print( data_ ) + "\" to the stream"; }
-  void execute( ByteStream& bs ) const override { bs.writer().push( data_ ); }
+  void execute( ByteStream& bs ) const override { bs.writer().push( std::string_view { data_ } ); }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
+struct PushRef : public Action<ByteStream>
+{
+  std::string data_;
+  bool borrowed_;
+
+  explicit PushRef( std::string data, bool borrowed = false ) : data_( move( data ) ), borrowed_( borrowed ) {}
+  std::string description() const override
+  {
+    return std::string { borrowed_ ? "push borrowed" : "push owned" } + " Ref \"" + pretty_print( data_ )
+           + "\" to the stream";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    bs.writer().push( borrowed_ ? borrow( data_ ) : Ref<std::string> { std::string { data_ } } );
+  }
   constexpr std::string obj() const override { return "Writer"; }
 };
 
@@ -2,8 +2,8 @@
 #include "exception.hh"
 
 #include <csignal>
+#include <ctime>
 #include <iostream>
-#include <sys/time.h>
 #include <unistd.h>
 
 using namespace std;
@@ -33,6 +33,7 @@ void Printer::print_debug_messages( const DisplayStep& step ) const
 
 void Printer::diagnostic( string_view test_name,
                           const vector<DisplayStep>& steps_executed,
+                          uint64_t steps_omitted,
                           const DisplayStep& failing_step,
                           std::string_view exception_type,
                           std::string_view exception_message ) const
@@ -40,10 +41,14 @@ void Printer::diagnostic( string_view test_name,
   const string quote = Printer::with_color( Printer::def, "\"" );
   cerr << "\nThe test " << quote << Printer::with_color( Printer::def, test_name ) << quote
        << " failed after these steps:\n\n";
-  unsigned int step_num = 0;
+  uint64_t step_num = 0;
   for ( const auto& step : steps_executed ) {
     cerr << "  " << step_num++ << "." << "\t" << with_color( step.color, step.text ) << "\n";
     print_debug_messages( step );
+    if ( step_num == 1 and steps_omitted > 0 ) {
+      cerr << "  ...\t" << with_color( faint, "(" + to_string( steps_omitted ) + " steps not shown)" ) << "\n";
+      step_num += steps_omitted;
+    }
   }
   cerr << with_color( red, "  ***** Unsuccessful " + failing_step.text + " *****\n" );
   print_debug_messages( failing_step );
@@ -70,18 +75,6 @@ string Printer::with_color( int color_value, string_view str ) const
   return ret;
 }
 
-Timeout::Timer::Timer()
-{
-  static constexpr itimerval deadline { .it_interval = { 0, 0 }, .it_value = { 2, 0 } };
-  CheckSystemCall( "setitimer", setitimer( ITIMER_PROF, &deadline, nullptr ) );
-}
-
-Timeout::Timer::~Timer()
-{
-  static constexpr itimerval disable { .it_interval = { 0, 0 }, .it_value = { 0, 0 } };
-  CheckSystemCall( "setitimer", setitimer( ITIMER_PROF, &disable, nullptr ) );
-}
-
 void throw_timeout( int signal_number )
 {
   if ( signal_number != SIGPROF ) {
@@ -91,20 +84,42 @@ void throw_timeout( int signal_number )
   throw TestException { "the individual test step took longer than 2 seconds (possibly an infinite loop?)" };
 }
 
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
 Timeout::Timeout()
 {
   struct sigaction action
   {};
   action.sa_handler = throw_timeout;
   CheckSystemCall( "sigaction", sigaction( SIGPROF, &action, nullptr ) );
+
+  // deliver SIGPROF to this thread once it has used up its own CPU-time budget
+  sigevent event {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = gettid();
+  CheckSystemCall( "timer_create", timer_create( CLOCK_THREAD_CPUTIME_ID, &event, &timer_ ) );
 }
 
 Timeout::~Timeout()
 {
+  CheckSystemCall( "timer_delete", timer_delete( timer_ ) );
   CheckSystemCall( "sigaction", sigaction( SIGPROF, nullptr, nullptr ) );
 }
 
-Timeout::Timer Timeout::make_timer() // NOLINT(readability-convert-member-functions-to-static)
+void Timeout::arm()
 {
-  return {};
+  static constexpr itimerspec deadline { .it_interval = { 0, 0 }, .it_value = { 2, 0 } };
+  static constexpr auto rearm_interval = chrono::milliseconds { 100 };
+
+  const auto now = chrono::steady_clock::now();
+  if ( armed_ and now - armed_at_ < rearm_interval ) {
+    return;
+  }
+
+  CheckSystemCall( "timer_settime", timer_settime( timer_, 0, &deadline, nullptr ) );
+  armed_ = true;
+  armed_at_ = now;
 }
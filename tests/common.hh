@@ -4,7 +4,15 @@
 #include "debug.hh"
 #include "exception.hh"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <ctime>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -62,25 +70,32 @@ public:
 
   void diagnostic( std::string_view test_name,
                    const std::vector<DisplayStep>& steps_executed,
+                   uint64_t steps_omitted,
                    const DisplayStep& failing_step,
                    std::string_view exception_type,
                    std::string_view exception_message ) const;
 };
 
+// Limits each test step to 2 seconds of CPU time on the calling thread (so harnesses in
+// different threads each get their own deadline).
 class Timeout
 {
-  class Timer
-  {
-  public:
-    Timer();
-    ~Timer();
-  };
+  timer_t timer_ {};
+  std::chrono::steady_clock::time_point armed_at_ {};
+  bool armed_ {};
 
 public:
   Timeout();
   ~Timeout();
 
-  Timer make_timer();
+  // (Re-)arm the deadline before a step. If it was armed within the last 100 ms, the
+  // timer_settime() call is skipped, so a fast step costs a clock read instead of a syscall.
+  void arm();
+
+  Timeout( const Timeout& ) = delete;
+  Timeout( Timeout&& ) = delete;
+  Timeout& operator=( const Timeout& ) = delete;
+  Timeout& operator=( Timeout&& ) = delete;
 };
 
 class TestException : public std::runtime_error
@@ -111,9 +126,72 @@ class TestHarness
     DebugHandler& operator=( DebugHandler&& ) = delete;
   };
 
+  // A step that has already run. Its description is only built if a later step fails and it
+  // has to be printed, so a passing step never pays for pretty_print() or string concatenation.
+  // The step is copied into the slot itself, so recording it doesn't allocate either; a step
+  // too large for the slot (or only known through the base class) is described right away.
+  class RecordedStep
+  {
+    static constexpr size_t capacity = 128;
+
+    alignas( std::max_align_t ) std::array<std::byte, capacity> storage_; // NOLINT(*-member-init)
+    const TestStep<T>* step_ {}; // the copy in storage_, or null if described eagerly
+    std::string text_ {};
+    int color_ {};
+
+    void destroy_step()
+    {
+      if ( step_ ) {
+        std::destroy_at( step_ );
+        step_ = nullptr;
+      }
+    }
+
+  public:
+    std::vector<std::string> debug_output {};
+
+    RecordedStep() = default;
+    ~RecordedStep() { destroy_step(); }
+    RecordedStep( const RecordedStep& ) = delete;
+    RecordedStep( RecordedStep&& ) = delete;
+    RecordedStep& operator=( const RecordedStep& ) = delete;
+    RecordedStep& operator=( RecordedStep&& ) = delete;
+
+    template<std::derived_from<TestStep<T>> Step>
+    void store( const Step& step )
+    {
+      destroy_step();
+      if constexpr ( sizeof( Step ) <= capacity and alignof( Step ) <= alignof( std::max_align_t ) ) {
+        step_ = new ( storage_.data() ) const Step( step );
+      } else {
+        describe( step );
+      }
+    }
+
+    void describe( const TestStep<T>& step )
+    {
+      destroy_step();
+      text_ = step.str();
+      color_ = step.color();
+    }
+
+    DisplayStep display() const
+    {
+      return step_ ? DisplayStep { step_->str(), step_->color(), debug_output }
+                   : DisplayStep { text_, color_, debug_output };
+    }
+  };
+
+  // Only the most recent steps are kept (in a ring, allocated by the first step), so long stress
+  // runs use bounded memory.
+  static constexpr size_t max_recorded_steps = 256;
+
   std::string test_name_;
 
-  std::optional<std::vector<DisplayStep>> steps_executed_ {};
+  bool skipped_ { true };
+  DisplayStep initialized_ {};
+  std::unique_ptr<RecordedStep[]> recent_steps_ {}; // NOLINT(*-avoid-c-arrays)
+  uint64_t steps_completed_ {};
   Printer pr_ {};
   Timeout timeout_ {};
   DebugHandler handler_ { this };
@@ -121,56 +199,57 @@ class TestHarness
 
   T obj_;
 
-  void finish_step( const std::string& str, int color )
+  size_t recorded_steps() const { return std::min<uint64_t>( steps_completed_, max_recorded_steps ); }
+
+  // the ring slot for the step that is finishing, with the step's debug output moved in
+  RecordedStep& next_slot()
   {
-    steps_executed_.value().emplace_back( str, color, std::move( debug_output_ ) );
+    if ( not recent_steps_ ) {
+      recent_steps_ = std::make_unique_for_overwrite<RecordedStep[]>( max_recorded_steps ); // NOLINT(*-c-arrays)
+    }
+    RecordedStep& slot = recent_steps_[steps_completed_ % max_recorded_steps];
+    slot.debug_output = std::move( debug_output_ );
     debug_output_.clear();
+    ++steps_completed_;
+    return slot;
   }
 
-protected:
-  explicit TestHarness( std::string test_name, std::string_view desc, T&& object )
-    : test_name_( std::move( test_name ) ), obj_( std::move( object ) )
+  // the initialization step followed by the recorded steps, oldest first
+  std::vector<DisplayStep> steps_executed() const
   {
-    auto run_only = test_only();
-    if ( run_only and *run_only != test_name_ ) {
-      std::cerr << pr_.with_color( Printer::red, "Skipping Test: " ) << test_name_ << "\n";
-      return;
+    std::vector<DisplayStep> ret { initialized_ };
+    const size_t oldest = steps_completed_ > max_recorded_steps ? steps_completed_ % max_recorded_steps : 0;
+    for ( size_t i = 0; i < recorded_steps(); ++i ) {
+      ret.push_back( recent_steps_[( oldest + i ) % max_recorded_steps].display() );
     }
-    steps_executed_.emplace();
-    finish_step( "Initialized " + demangle( typeid( T ).name() ) + " with " + std::string { desc }, Printer::def );
+    return ret;
   }
 
-  const T& object() const { return obj_; }
-
-public:
-  void execute( const TestStep<T>& step )
+  void run( const TestStep<T>& step )
   {
-    if ( skipped() ) {
-      return;
-    }
     try {
-      {
-        auto timer = timeout_.make_timer();
-        step.execute( obj_ );
-      }
-      finish_step( step.str(), step.color() );
+      timeout_.arm();
+      step.execute( obj_ );
     } catch ( const ExpectationViolation& e ) {
       pr_.diagnostic( test_name_,
-                      steps_executed_.value(),
+                      steps_executed(),
+                      steps_completed_ - recorded_steps(),
                       { step.str(), Printer::red, std::move( debug_output_ ) },
                       "Unmet Expectation",
                       "The " + step.obj() + " " + e.what() + "." );
       throw std::runtime_error { "The test \"" + test_name_ + "\" failed because of an unmet expectation." };
     } catch ( const TestException& e ) {
       pr_.diagnostic( test_name_,
-                      steps_executed_.value(),
+                      steps_executed(),
+                      steps_completed_ - recorded_steps(),
                       { step.str(), Printer::red, std::move( debug_output_ ) },
                       "Failure",
                       e.what() );
       throw std::runtime_error { "The test \"" + test_name_ + "\" failed." };
     } catch ( const std::exception& e ) {
       pr_.diagnostic( test_name_,
-                      steps_executed_.value(),
+                      steps_executed(),
+                      steps_completed_ - recorded_steps(),
                       { step.str(), Printer::red, std::move( debug_output_ ) },
                       demangle( typeid( e ).name() ),
                       e.what() );
@@ -178,6 +257,47 @@ public:
     }
   }
 
+protected:
+  explicit TestHarness( std::string test_name, std::string_view desc, T&& object )
+    : test_name_( std::move( test_name ) ), obj_( std::move( object ) )
+  {
+    auto run_only = test_only();
+    if ( run_only and *run_only != test_name_ ) {
+      std::cerr << pr_.with_color( Printer::red, "Skipping Test: " ) << test_name_ << "\n";
+      return;
+    }
+    skipped_ = false;
+    initialized_ = { "Initialized " + demangle( typeid( T ).name() ) + " with " + std::string { desc },
+                     Printer::def,
+                     std::move( debug_output_ ) };
+    debug_output_.clear();
+  }
+
+  const T& object() const { return obj_; }
+
+public:
+  // Steps whose concrete type is known are copied (in place) and described lazily.
+  template<std::derived_from<TestStep<T>> Step>
+    requires std::copy_constructible<Step>
+  void execute( const Step& step )
+  {
+    if ( skipped() ) {
+      return;
+    }
+    run( step );
+    next_slot().store( step );
+  }
+
+  // Steps only known through the base class are described right away.
+  void execute( const TestStep<T>& step )
+  {
+    if ( skipped() ) {
+      return;
+    }
+    run( step );
+    next_slot().describe( step );
+  }
+
   void debug( std::string_view message )
   {
     debug_output_.emplace_back( message );
@@ -186,7 +306,8 @@ public:
     }
   }
 
-  bool skipped() const { return not steps_executed_.has_value(); }
+  bool skipped() const { return skipped_; }
+  uint64_t steps_completed() const { return steps_completed_; }
 };
 
 template<typename T>
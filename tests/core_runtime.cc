@@ -0,0 +1,118 @@
+#include "core_runtime.hh"
+#include "expect.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Echo each connection's bytes back, checking that every callback for a connection runs on the thread that
+// accepted it.
+void echo_on_every_core()
+{
+  mutex mutex;
+  set<thread::id> accepting_threads;
+  atomic<bool> strayed = false;
+
+  CoreRuntime runtime {
+    Address { "127.0.0.1", 0 },
+    [&]( EventLoop& loop, TCPSocket&& accepted ) {
+      const auto home = this_thread::get_id();
+      {
+        const lock_guard lock { mutex };
+        accepting_threads.insert( home );
+      }
+
+      auto socket = make_shared<TCPSocket>( move( accepted ) );
+      loop.add_rule( "echo", *socket, Direction::In, [socket, home, &strayed] {
+        if ( this_thread::get_id() != home ) {
+          strayed = true;
+        }
+        string buf;
+        socket->read( buf );
+        if ( not buf.empty() ) {
+          socket->write( buf );
+        }
+      } );
+    },
+    4 };
+  expect( runtime.threads() == 4, "four workers" );
+
+  thread server { [&] { runtime.run(); } };
+
+  // many connections, so the kernel's hash is all but certain to pick more than one listener
+  constexpr size_t count = 64;
+  vector<TCPSocket> clients( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    clients[i].connect( runtime.address() );
+    clients[i].write( "hello " + to_string( i ) );
+  }
+  for ( size_t i = 0; i < count; ++i ) {
+    const string expected = "hello " + to_string( i );
+    string received;
+    while ( received.size() < expected.size() ) {
+      string buf;
+      clients[i].read( buf );
+      received += buf;
+    }
+    expect( received == expected, "echoed" );
+  }
+
+  runtime.stop();
+  clients.clear(); // the echo rules see EOF and finish, so the workers can exit
+  server.join();
+
+  uint64_t total = 0;
+  size_t busy_workers = 0;
+  for ( size_t i = 0; i < runtime.threads(); ++i ) {
+    total += runtime.connections( i );
+    busy_workers += runtime.connections( i ) > 0;
+  }
+  expect( total == count, "every connection accepted once" );
+  expect( busy_workers > 1 and accepting_threads.size() == busy_workers, "connections spread across workers" );
+  expect( not strayed, "each connection stayed on the thread that accepted it" );
+}
+
+// an exception in one worker stops them all and comes out of run()
+void worker_error()
+{
+  CoreRuntime runtime {
+    Address { "127.0.0.1", 0 },
+    []( EventLoop&, TCPSocket&& ) { throw runtime_error( "handler failed" ); },
+    2,
+    EventLoop::Backend::Poll };
+
+  thread client { [address = runtime.address()] {
+    TCPSocket socket;
+    socket.connect( address );
+  } };
+
+  bool threw = false;
+  try {
+    runtime.run();
+  } catch ( const runtime_error& e ) {
+    threw = string( e.what() ) == "handler failed";
+  }
+  client.join();
+  expect( threw, "worker's exception rethrown by run()" );
+}
+
+int main()
+{
+  try {
+    echo_on_every_core();
+    worker_error();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include "bench.hh"
+#include "eventloop.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// One ready pipe (written and drained once per iteration), plus `idle_count` pipes that never become ready.
+// The loop and its rules are set up once, outside the timed body.
+struct FdDispatch
+{
+  EventLoop loop;
+  vector<pair<FileDescriptor, FileDescriptor>> idle {};
+  pair<FileDescriptor, FileDescriptor> active { make_pipe() };
+  string buf {};
+
+  FdDispatch( size_t idle_count, EventLoop::Backend backend ) : loop( backend )
+  {
+    const size_t idle_category = loop.add_category( "idle" );
+    idle.reserve( idle_count );
+    for ( size_t i = 0; i < idle_count; ++i ) {
+      auto& read_end = idle.emplace_back( make_pipe() ).first;
+      loop.add_rule( idle_category, read_end, Direction::In, [&read_end] {
+        string discard;
+        read_end.read( discard );
+      } );
+    }
+
+    loop.add_rule( "active", active.first, Direction::In, [this] {
+      buf.resize( 64 );
+      active.first.read( buf );
+    } );
+  }
+
+  void operator()( uint64_t iterations )
+  {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      active.second.write( "x" );
+      loop.wait_next_event( 0 );
+    }
+  }
+};
+
+// `count` pipes all made ready each iteration, then served until drained.
+struct ManyReady
+{
+  EventLoop loop;
+  vector<pair<FileDescriptor, FileDescriptor>> pipes {};
+  size_t pending {};
+
+  ManyReady( size_t count, EventLoop::Backend backend, EventLoop::Dispatch dispatch ) : loop( backend )
+  {
+    loop.set_dispatch( dispatch );
+    const size_t category = loop.add_category( "ready" );
+    pipes.reserve( count );
+    for ( size_t i = 0; i < count; ++i ) {
+      auto& read_end = pipes.emplace_back( make_pipe() ).first;
+      loop.add_rule( category, read_end, Direction::In, [this, &read_end] {
+        string buf( 64, 0 );
+        read_end.read( buf );
+        --pending;
+      } );
+    }
+  }
+
+  void operator()( uint64_t iterations )
+  {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      for ( auto& pipe : pipes ) {
+        pipe.second.write( "x" );
+      }
+      pending = pipes.size();
+      while ( pending > 0 ) {
+        loop.wait_next_event( 0 );
+      }
+    }
+  }
+};
+
+BenchmarkSuite::BodyT many_ready( size_t count, EventLoop::Backend backend, EventLoop::Dispatch dispatch )
+{
+  auto state = make_shared<ManyReady>( count, backend, dispatch );
+  return [state]( uint64_t iterations ) { ( *state )( iterations ); };
+}
+
+BenchmarkSuite::BodyT fd_dispatch( size_t idle_count, EventLoop::Backend backend = EventLoop::Backend::Poll )
+{
+  auto state = make_shared<FdDispatch>( idle_count, backend );
+  return [state]( uint64_t iterations ) { ( *state )( iterations ); };
+}
+
+// `count` timers armed far in the future; each iteration adds one more and cancels it
+struct ArmedTimers
+{
+  EventLoop loop {};
+  size_t category { loop.add_category( "timers" ) };
+  vector<EventLoop::RuleHandle> armed {};
+
+  explicit ArmedTimers( size_t count )
+  {
+    armed.reserve( count );
+    for ( size_t i = 0; i < count; ++i ) {
+      armed.push_back( loop.add_timer( category, chrono::milliseconds { 1'000'000 + i }, [] {} ) );
+    }
+  }
+
+  void operator()( uint64_t iterations )
+  {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      loop.add_timer( category, chrono::milliseconds { 500'000 }, [] {} ).cancel();
+    }
+  }
+};
+
+BenchmarkSuite::BodyT armed_timers( size_t count )
+{
+  auto state = make_shared<ArmedTimers>( count );
+  return [state]( uint64_t iterations ) { ( *state )( iterations ); };
+}
+
+void program_body()
+{
+  BenchmarkSuite suite { "EventLoop" };
+
+  suite.add( "non-fd rule dispatch", []( uint64_t iterations ) {
+    EventLoop loop;
+    uint64_t pending = 0;
+    loop.add_rule( "work", [&] { --pending; }, [&] { return pending > 0; } );
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      pending = 1;
+      loop.wait_next_event( 0 );
+    }
+  } );
+
+  suite.add( "fd rule add + cancel", []( uint64_t iterations ) {
+    EventLoop loop;
+    const size_t category = loop.add_category( "rules" );
+    auto [read_end, write_end] = make_pipe();
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      loop.add_rule( category, read_end, Direction::In, [] {} ).cancel();
+      loop.wait_next_event( 0 );
+    }
+  } );
+
+  suite.add( "timer add + cancel (10k armed)", armed_timers( 10'000 ) );
+
+  // per closure, in batches of 64 (one wakeup each)
+  suite.add( "post + run (batches of 64)", []( uint64_t iterations ) {
+    EventLoop loop;
+    uint64_t ran = 0;
+    while ( ran < iterations ) {
+      for ( int i = 0; i < 64; ++i ) {
+        loop.post( [&ran] { ++ran; } );
+      }
+      loop.wait_next_event( 0 );
+    }
+  } );
+
+  suite.add( "fd rule dispatch (pipe)", fd_dispatch( 0 ) );
+  suite.add( "fd rule dispatch (pipe) + 100 idle rules", fd_dispatch( 100 ) );
+  suite.add( "fd rule dispatch (pipe) + 400 idle rules", fd_dispatch( 400 ) );
+
+  const auto epoll = EventLoop::Backend::Epoll;
+  suite.add( "epoll: fd rule dispatch (pipe)", fd_dispatch( 0, epoll ) );
+  suite.add( "epoll: fd rule dispatch (pipe) + 100 idle rules", fd_dispatch( 100, epoll ) );
+  suite.add( "epoll: fd rule dispatch (pipe) + 400 idle rules", fd_dispatch( 400, epoll ) );
+
+  const auto one_rule = EventLoop::Dispatch::OneRule;
+  const auto all_ready = EventLoop::Dispatch::AllReady;
+  suite.add( "16 ready pipes, one rule per call", many_ready( 16, EventLoop::Backend::Poll, one_rule ) );
+  suite.add( "16 ready pipes, all ready per call", many_ready( 16, EventLoop::Backend::Poll, all_ready ) );
+  suite.add( "epoll: 16 ready pipes, one rule per call", many_ready( 16, epoll, one_rule ) );
+  suite.add( "epoll: 16 ready pipes, all ready per call", many_ready( 16, epoll, all_ready ) );
+
+  if ( IoUring::supported() ) {
+    const auto uring = EventLoop::Backend::IoUring;
+    suite.add( "io_uring: fd rule dispatch (pipe)", fd_dispatch( 0, uring ) );
+    suite.add( "io_uring: fd rule dispatch (pipe) + 100 idle rules", fd_dispatch( 100, uring ) );
+    suite.add( "io_uring: fd rule dispatch (pipe) + 400 idle rules", fd_dispatch( 400, uring ) );
+  }
+
+  suite.run();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#include "async_fd.hh"
+#include "eventloop.hh"
+#include "expect.hh"
+#include "task.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+// count every allocation in the program
+size_t allocations = 0; // NOLINT(*-avoid-non-const-global-variables)
+
+void* operator new( size_t size )
+{
+  ++allocations;
+  if ( void* const p = malloc( size ) ) { // NOLINT(*-no-malloc)
+    return p;
+  }
+  throw bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+  free( p ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* p, size_t /* size */ ) noexcept
+{
+  free( p ); // NOLINT(*-no-malloc)
+}
+
+void run( EventLoop& loop )
+{
+  while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+}
+
+Task produce( EventLoop& loop, FileDescriptor& sink, string_view data, bool& done )
+{
+  AsyncFD writer { loop, sink };
+  while ( not data.empty() ) {
+    co_await writer.writable();
+    data.remove_prefix( sink.write( data.substr( 0, 3 ) ) ); // a few bytes at a time
+    co_await loop.sleep( 1ms );
+  }
+  sink.close();
+  done = true;
+}
+
+Task consume( EventLoop& loop, FileDescriptor& source, string& received )
+{
+  AsyncFD reader { loop, source };
+  string buf;
+  while ( true ) {
+    co_await reader.readable();
+    source.read( buf );
+    if ( source.eof() ) {
+      break;
+    }
+    received += buf;
+  }
+}
+
+// a producer and a consumer coroutine on either end of a pipe
+void pipeline( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  auto [read_end, write_end] = make_pipe();
+  read_end.set_blocking( false );
+  write_end.set_blocking( false );
+
+  const string data = "the quick brown fox jumps over the lazy dog";
+  string received;
+  bool done = false;
+  loop.spawn( consume( loop, read_end, received ) );
+  loop.spawn( produce( loop, write_end, data, done ) );
+  expect( loop.tasks() == 2, "both suspended" );
+
+  run( loop );
+  expect( done and received == data, "everything went through" );
+  expect( loop.tasks() == 0, "both finished" );
+}
+
+Task nap( EventLoop& loop, chrono::steady_clock::time_point& woke )
+{
+  co_await loop.sleep( 5ms );
+  co_await loop.sleep( 5ms );
+  woke = chrono::steady_clock::now();
+}
+
+void sleeping()
+{
+  EventLoop loop;
+  const auto start = chrono::steady_clock::now();
+  auto woke = start;
+  loop.spawn( nap( loop, woke ) );
+  run( loop );
+  expect( woke - start >= 10ms, "slept twice" );
+}
+
+Task fail( EventLoop& loop )
+{
+  co_await loop.sleep( 1ms );
+  throw runtime_error( "task failed" );
+}
+
+void exception_comes_out()
+{
+  EventLoop loop;
+  loop.spawn( fail( loop ) );
+  bool threw = false;
+  try {
+    run( loop );
+  } catch ( const runtime_error& e ) {
+    threw = string( e.what() ) == "task failed";
+  }
+  expect( threw and loop.tasks() == 0, "exception rethrown by wait_next_event, and the frame destroyed" );
+}
+
+struct SetOnDestruction
+{
+  bool* flag;
+  explicit SetOnDestruction( bool* s_flag ) : flag( s_flag ) {}
+  SetOnDestruction( const SetOnDestruction& other ) = delete;
+  SetOnDestruction& operator=( const SetOnDestruction& other ) = delete;
+  ~SetOnDestruction() { *flag = true; }
+};
+
+Task wait_forever( EventLoop& loop, FileDescriptor& fd, bool& destroyed )
+{
+  const SetOnDestruction guard { &destroyed };
+  AsyncFD waiting { loop, fd };
+  co_await waiting.readable();
+  throw runtime_error( "never readable" );
+}
+
+void destroyed_with_loop( EventLoop::Backend backend )
+{
+  auto [read_end, write_end] = make_pipe();
+  bool destroyed = false;
+  {
+    EventLoop loop { backend };
+    loop.spawn( wait_forever( loop, read_end, destroyed ) );
+    expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "still waiting" );
+  }
+  expect( destroyed, "suspended frame destroyed with the loop" );
+}
+
+Task echo_once( EventLoop& loop, FileDescriptor& source, string& buf )
+{
+  AsyncFD reader { loop, source };
+  co_await reader.readable();
+  source.read( buf );
+}
+
+// once warmed up, starting a task, waiting in it and finishing it allocates nothing
+void no_allocation_per_task( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  auto [read_end, write_end] = make_pipe();
+  string buf;
+  buf.reserve( 64 );
+
+  const auto cycle = [&] {
+    loop.spawn( echo_once( loop, read_end, buf ) );
+    write_end.write( "x" );
+    while ( loop.tasks() ) {
+      loop.wait_next_event( 1000 );
+    }
+    loop.wait_next_event( 0 ); // erases the rule
+  };
+
+  cycle();
+  const size_t before = allocations;
+  for ( int i = 0; i < 100; ++i ) {
+    cycle();
+  }
+  const bool allocated = allocations != before;
+  expect( not allocated, "no allocations after warming up" );
+  expect( FramePool::local().cached() > 0, "frame recycled" );
+}
+
+int main()
+{
+  try {
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      pipeline( backend );
+      destroyed_with_loop( backend );
+    }
+    no_allocation_per_task( EventLoop::Backend::Poll ); // (epoll allocates each fd's registration)
+    no_allocation_per_task( EventLoop::Backend::IoUring );
+    sleeping();
+    exception_comes_out();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include "eventloop.hh"
+#include "expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// `count` pipes with data waiting, each with a rule that reads one byte per callback
+struct ReadyPipes
+{
+  vector<pair<FileDescriptor, FileDescriptor>> pipes {};
+  vector<unsigned int> calls {};
+
+  ReadyPipes( EventLoop& loop, size_t category_id, size_t count, size_t bytes_each )
+  {
+    pipes.reserve( count );
+    calls.resize( count );
+    for ( size_t i = 0; i < count; ++i ) {
+      auto& [read_end, write_end] = pipes.emplace_back( make_pipe() );
+      write_end.write( string( bytes_each, 'x' ) );
+      loop.add_rule( category_id, read_end, Direction::In, [this, i, &read_end = read_end] {
+        string byte( 1, 0 );
+        read_end.read( byte );
+        ++calls[i];
+      } );
+    }
+  }
+
+  unsigned int total() const
+  {
+    unsigned int ret = 0;
+    for ( const auto n : calls ) {
+      ret += n;
+    }
+    return ret;
+  }
+};
+
+void one_rule_per_call( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  const ReadyPipes ready { loop, loop.add_category( "pipes" ), 5, 1 };
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and ready.total() == 1, "one rule served" );
+}
+
+void all_ready_per_call( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  loop.set_dispatch( EventLoop::Dispatch::AllReady );
+  const ReadyPipes ready { loop, loop.add_category( "pipes" ), 5, 1 };
+
+  unsigned int pending = 3;
+  loop.add_rule( "work", [&] { --pending; }, [&] { return pending > 0; } );
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success, "served" );
+  expect( ready.total() == 5, "every ready fd rule served by one call" );
+  expect( pending == 0, "non-fd rule drained in the same call" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "nothing left" );
+}
+
+void budgets( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  loop.set_dispatch( EventLoop::Dispatch::AllReady );
+
+  const size_t hot_category = loop.add_category( "hot" );
+  loop.set_category_budget( hot_category, 2 );
+  const ReadyPipes hot { loop, hot_category, 5, 100 };
+  const ReadyPipes other { loop, loop.add_category( "other" ), 3, 100 };
+
+  const size_t work_category = loop.add_category( "work" );
+  loop.set_category_budget( work_category, 10 );
+  unsigned int pending = 1000; // would trip the busy-wait check if drained in one go
+  loop.add_rule( work_category, [&] { --pending; }, [&] { return pending > 0; } );
+
+  for ( unsigned int round = 1; round <= 5; ++round ) {
+    expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success, "served" );
+    expect( hot.total() == 2 * round, "budgeted category served up to its budget" );
+    expect( other.total() == 3 * round, "other category served in full" );
+    expect( pending == 1000 - 10 * round, "non-fd rule stops at its budget" );
+  }
+
+  // rules left waiting go first next time, so no pipe in the budgeted category is starved
+  for ( const auto n : hot.calls ) {
+    expect( n >= 1, "budget rotates through the category's rules" );
+  }
+}
+
+void busy_wait_detected( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  loop.set_dispatch( EventLoop::Dispatch::AllReady );
+  auto [read_end, write_end] = make_pipe();
+  write_end.write( "x" );
+  loop.add_rule( "lazy", read_end, Direction::In, [] {} );
+
+  bool threw = false;
+  try {
+    loop.wait_next_event( 0 );
+  } catch ( const runtime_error& e ) {
+    threw = string( e.what() ).find( "busy wait" ) != string::npos;
+  }
+  expect( threw, "busy wait detected" );
+}
+
+int main()
+{
+  try {
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      one_rule_per_call( backend );
+      all_ready_per_call( backend );
+      budgets( backend );
+      busy_wait_detected( backend );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
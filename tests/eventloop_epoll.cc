@@ -0,0 +1,191 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "socket.hh"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void interest_and_hangup()
+{
+  EventLoop loop { EventLoop::Backend::Epoll };
+  expect( loop.backend() == EventLoop::Backend::Epoll, "epoll backend selected" );
+
+  auto [read_end, write_end] = make_pipe();
+  string received;
+  bool want_read = true;
+  bool cancelled = false;
+  loop.add_rule(
+    "reader",
+    read_end,
+    Direction::In,
+    [&] {
+      string buf;
+      read_end.read( buf );
+      received += buf;
+    },
+    [&] { return want_read; },
+    [&] { cancelled = true; } );
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "nothing to read yet" );
+
+  write_end.write( "abc" );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abc", "rule fired" );
+
+  want_read = false;
+  write_end.write( "def" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "uninterested rule leaves nothing to wait for" );
+  want_read = true;
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abcdef",
+          "interest change updates the registration" );
+
+  write_end.close();
+  while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+  expect( cancelled, "rule cancelled at hangup" );
+}
+
+pair<TCPSocket, TCPSocket> connected_pair()
+{
+  TCPSocket server;
+  server.set_reuseaddr();
+  server.bind( Address { "127.0.0.1", 0 } );
+  server.listen();
+
+  TCPSocket client;
+  client.connect( server.local_address() );
+  return { move( client ), server.accept() };
+}
+
+// an In and an Out rule share one registration
+void two_rules_on_one_socket()
+{
+  EventLoop loop { EventLoop::Backend::Epoll };
+  auto [a, b] = connected_pair();
+
+  string outgoing = "ping";
+  string received;
+  loop.add_rule(
+    "send", a, Direction::Out, [&] { a.write( exchange( outgoing, "" ) ); }, [&] { return not outgoing.empty(); } );
+  loop.add_rule( "receive", a, Direction::In, [&] {
+    string buf;
+    a.read( buf );
+    received += buf;
+  } );
+
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and outgoing.empty(), "Out rule sent" );
+  string buf;
+  b.read( buf );
+  expect( buf == "ping", "peer received" );
+  b.write( "pong" );
+
+  for ( int i = 0; i < 5 and received.empty(); ++i ) {
+    loop.wait_next_event( 1000 );
+  }
+  expect( received == "pong", "In rule on the same fd received" );
+}
+
+// cancelled and closed rules give up their registrations, even when the fd number comes back
+void cancel_and_reuse()
+{
+  EventLoop loop { EventLoop::Backend::Epoll };
+  const size_t category = loop.add_category( "pipes" );
+
+  vector<pair<FileDescriptor, FileDescriptor>> idle;
+  for ( int i = 0; i < 100; ++i ) {
+    auto& pipe = idle.emplace_back( make_pipe() );
+    loop.add_rule( category, pipe.first, Direction::In, [&pipe] {
+      string buf;
+      pipe.first.read( buf );
+    } );
+  }
+
+  auto first = make_pipe();
+  const int number = first.first.fd_num();
+  bool first_cancelled = false;
+  auto handle = loop.add_rule(
+    category,
+    first.first,
+    Direction::In,
+    [&] { throw runtime_error( "cancelled rule ran" ); },
+    [] { return true; },
+    [&] { first_cancelled = true; } );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "all idle" );
+
+  handle.cancel();
+  first.second.write( "x" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "a cancelled rule is not woken" );
+  expect( not first_cancelled, "cancelling from outside doesn't call the cancel callback" );
+
+  // close under the loop, then hand the same number to a new pipe
+  auto closed_rule = make_pipe();
+  const int closed_number = closed_rule.first.fd_num();
+  bool closed_cancelled = false;
+  loop.add_rule(
+    category,
+    closed_rule.first,
+    Direction::In,
+    [&] { throw runtime_error( "rule on a closed fd ran" ); },
+    [] { return true; },
+    [&] { closed_cancelled = true; } );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "registered" );
+  closed_rule.first.close();
+  first.first.close();
+
+  auto second = make_pipe();
+  expect( second.first.fd_num() == number or second.first.fd_num() == closed_number, "fd number reused" );
+  string received;
+  loop.add_rule( category, second.first, Direction::In, [&] {
+    string buf;
+    second.first.read( buf );
+    received += buf;
+  } );
+
+  second.second.write( "hello" );
+  for ( int i = 0; i < 5 and received.empty(); ++i ) {
+    loop.wait_next_event( 1000 );
+  }
+  expect( received == "hello", "new rule on a reused fd number fires" );
+  expect( closed_cancelled, "rule on a closed fd cancelled" );
+}
+
+// an error cancels the rule after calling its error callback
+void error_cancels()
+{
+  EventLoop loop { EventLoop::Backend::Epoll };
+  auto [read_end, write_end] = make_pipe();
+  read_end.close();
+
+  bool errored = false;
+  bool cancelled = false;
+  loop.add_rule(
+    "writer",
+    write_end,
+    Direction::Out,
+    [&] { throw runtime_error( "wrote to a broken pipe" ); },
+    [] { return true; },
+    [&] { cancelled = true; },
+    [&] { errored = true; } );
+
+  while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+  expect( errored and cancelled, "error and cancel callbacks called" );
+}
+
+int main()
+{
+  try {
+    signal( SIGPIPE, SIG_IGN ); // NOLINT(*-err33-c)
+    interest_and_hangup();
+    two_rules_on_one_socket();
+    cancel_and_reuse();
+    error_cancels();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
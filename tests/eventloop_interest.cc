@@ -0,0 +1,143 @@
+#include "eventloop.hh"
+#include "expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// a reader that turns its own interest off and on
+void toggled_reader( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  auto [read_end, write_end] = make_pipe();
+  string received;
+  bool cancelled = false;
+  unsigned int interest_calls = 0;
+
+  optional<EventLoop::RuleHandle> reader;
+  reader = loop.add_rule(
+    "reader",
+    read_end,
+    Direction::In,
+    [&] {
+      string buf;
+      read_end.read( buf );
+      received += buf;
+      reader->set_interest( false ); // one read, then wait to be asked again
+    },
+    [&] {
+      ++interest_calls;
+      return true;
+    },
+    [&] { cancelled = true; } );
+  reader->set_interest( false );
+
+  write_end.write( "abc" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "uninterested: nothing to wait for" );
+  reader->set_interest( true );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abc", "interested: served" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "turned itself off" );
+
+  write_end.write( "def" );
+  reader->set_interest( true );
+  reader->set_interest( true ); // no change
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abcdef", "served again" );
+  expect( interest_calls == 0, "interest function never called once interest is explicit" );
+
+  write_end.close();
+  reader->set_interest( true );
+  while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+  expect( cancelled, "rule cancelled at EOF" );
+}
+
+void explicit_non_fd_rule()
+{
+  EventLoop loop;
+  unsigned int pending = 0;
+  optional<EventLoop::RuleHandle> work;
+  work = loop.add_rule( "work", [&] {
+    if ( --pending == 0 ) {
+      work->set_interest( false );
+    }
+  } );
+  work->set_interest( false );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "idle" );
+
+  pending = 5;
+  work->set_interest( true );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and pending == 0, "drained" );
+}
+
+// Many idle rules: with explicit interest, none of them is looked at per call (epoll).
+void many_idle( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  const size_t category = loop.add_category( "idle" );
+  unsigned int interest_calls = 0;
+
+  vector<pair<FileDescriptor, FileDescriptor>> idle;
+  vector<EventLoop::RuleHandle> handles;
+  idle.reserve( 2000 );
+  for ( int i = 0; i < 2000; ++i ) {
+    auto& read_end = idle.emplace_back( make_pipe() ).first;
+    handles.push_back( loop.add_rule(
+      category,
+      read_end,
+      Direction::In,
+      [&read_end] {
+        string buf;
+        read_end.read( buf );
+      },
+      [&] {
+        ++interest_calls;
+        return true;
+      } ) );
+    handles.back().set_interest( true );
+  }
+
+  auto [read_end, write_end] = make_pipe();
+  unsigned int served = 0;
+  loop.add_rule( "active", read_end, Direction::In, [&] {
+    string buf;
+    read_end.read( buf );
+    ++served;
+  } );
+
+  for ( int i = 0; i < 100; ++i ) {
+    write_end.write( "x" );
+    expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success, "active rule served" );
+  }
+  expect( served == 100 and interest_calls == 0, "idle rules' interest never asked" );
+
+  // one of them wakes up
+  idle[1234].second.write( "y" );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and idle[1234].first.read_count() > 0,
+          "explicitly interested rule served" );
+
+  // cancelling and closing
+  for ( auto& handle : handles ) {
+    handle.cancel();
+  }
+  write_end.close(); // the active rule sees EOF
+  while ( loop.wait_next_event( 0 ) != EventLoop::Result::Exit ) {}
+}
+
+int main()
+{
+  try {
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      toggled_reader( backend );
+      many_idle( backend );
+    }
+    explicit_non_fd_rule();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "mpsc_queue.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+// several producers, one consumer draining as they go: nothing lost, each producer's items in order
+void queue_order()
+{
+  constexpr int producers = 4;
+  constexpr int items = 20000;
+  MPSCQueue<pair<int, int>> queue;
+
+  vector<thread> threads;
+  for ( int p = 0; p < producers; ++p ) {
+    threads.emplace_back( [&queue, p] {
+      for ( int i = 0; i < items; ++i ) {
+        queue.push( pair { p, i } );
+      }
+    } );
+  }
+
+  vector<int> next( producers );
+  int received = 0;
+  bool in_order = true;
+  while ( received < producers * items ) {
+    received += static_cast<int>( queue.drain( [&]( const pair<int, int>& item ) {
+      in_order = in_order and item.second == next[item.first]++;
+    } ) );
+  }
+  for ( auto& t : threads ) {
+    t.join();
+  }
+  expect( in_order and queue.empty(), "every item, in order per producer" );
+}
+
+// a throwing consumer leaves the rest of its batch queued, ahead of later items
+void queue_requeue()
+{
+  MPSCQueue<int> queue;
+  expect( queue.push( 1 ), "first push finds the queue empty" );
+  expect( not queue.push( 2 ), "second doesn't" );
+  for ( int i = 3; i <= 5; ++i ) {
+    queue.push( i );
+  }
+
+  vector<int> seen;
+  try {
+    queue.drain( [&]( int i ) {
+      seen.push_back( i );
+      if ( i == 3 ) {
+        queue.push( 6 );
+        throw runtime_error( "stop" );
+      }
+    } );
+  } catch ( const runtime_error& ) {
+    seen.push_back( 0 );
+  }
+  queue.drain( [&]( int i ) { seen.push_back( i ); } );
+  expect( seen == vector<int> { 1, 2, 3, 0, 4, 5, 6 }, "rest of the batch kept, in order" );
+}
+
+// closures posted from other threads run on the loop's thread
+void post_from_threads( EventLoop::Backend backend )
+{
+  constexpr int producers = 4;
+  constexpr int posts = 5000;
+  EventLoop loop { backend };
+  const auto loop_thread = this_thread::get_id();
+  int ran = 0; // only touched by the loop's thread
+  bool strayed = false;
+
+  vector<thread> threads;
+  for ( int p = 0; p < producers; ++p ) {
+    threads.emplace_back( [&, alive = loop.keep_alive()]() mutable {
+      for ( int i = 0; i < posts; ++i ) {
+        loop.post( [&] {
+          strayed = strayed or this_thread::get_id() != loop_thread;
+          ++ran;
+        } );
+      }
+      alive.reset(); // the last one lets the loop exit
+    } );
+  }
+
+  while ( loop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+  for ( auto& t : threads ) {
+    t.join();
+  }
+  expect( ran == producers * posts and not strayed, "every closure ran, on the loop's thread" );
+}
+
+// the first post from another thread wakes a loop that is already blocked waiting on other rules
+void first_post_wakes( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  expect( loop.add_category( "idle" ) == 0, "user categories start at 0" );
+  auto [read_end, write_end] = make_pipe();
+  loop.add_rule( "idle", read_end, Direction::In, [] {} );
+
+  bool ran = false;
+  thread poster { [&] {
+    this_thread::sleep_for( 20ms );
+    loop.post( [&] { ran = true; } );
+  } };
+
+  const auto start = chrono::steady_clock::now();
+  const auto result = loop.wait_next_event( 10000 );
+  poster.join();
+  expect( result == EventLoop::Result::Success and ran, "the posted closure ran" );
+  expect( chrono::steady_clock::now() - start < 5s, "woken by the post" );
+}
+
+void batches_and_exit()
+{
+  EventLoop loop;
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "nothing to do: exit" );
+
+  int ran = 0;
+  for ( int i = 0; i < 100; ++i ) {
+    loop.post( [&] { ++ran; } );
+  }
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and ran == 100, "one call ran the whole batch" );
+
+  loop.post( [&] { loop.post( [&] { ++ran; } ); } ); // posted while running posts: left for the next batch
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and ran == 100, "one batch at a time" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and ran == 101, "then the next" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "pending posts done: exit" );
+
+  loop.post( [] { throw runtime_error( "posted closure failed" ); } );
+  loop.post( [&] { ++ran; } );
+  bool threw = false;
+  try {
+    loop.wait_next_event( 0 );
+  } catch ( const runtime_error& e ) {
+    threw = string( e.what() ) == "posted closure failed";
+  }
+  expect( threw and ran == 101, "exception comes out of wait_next_event" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and ran == 102, "later closures still run" );
+}
+
+// dropping the last KeepAlive on another thread wakes a loop that was waiting only for posts
+void keep_alive_wakes( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  optional<EventLoop::KeepAlive> alive { loop.keep_alive() };
+  thread releaser { [&] {
+    this_thread::sleep_for( 20ms );
+    alive.reset();
+  } };
+
+  const auto start = chrono::steady_clock::now();
+  while ( loop.wait_next_event( 10000 ) != EventLoop::Result::Exit ) {}
+  releaser.join();
+  expect( chrono::steady_clock::now() - start < 5s, "woken to exit" );
+}
+
+int main()
+{
+  try {
+    queue_order();
+    queue_requeue();
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      post_from_threads( backend );
+      keep_alive_wakes( backend );
+      first_post_wakes( backend );
+    }
+    batches_and_exit();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include "eventloop.hh"
+#include "expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// `count` pipes with data waiting, each with a rule that reads one byte per callback and logs its category
+struct ReadyPipes
+{
+  vector<pair<FileDescriptor, FileDescriptor>> pipes {};
+  unsigned int calls {};
+
+  ReadyPipes( EventLoop& loop, size_t category_id, size_t count, size_t bytes_each, vector<size_t>& log )
+  {
+    pipes.reserve( count );
+    for ( size_t i = 0; i < count; ++i ) {
+      auto& [read_end, write_end] = pipes.emplace_back( make_pipe() );
+      write_end.write( string( bytes_each, 'x' ) );
+      loop.add_rule( category_id, read_end, Direction::In, [this, &log, category_id, &read_end = read_end] {
+        string byte( 1, 0 );
+        read_end.read( byte );
+        ++calls;
+        log.push_back( category_id );
+      } );
+    }
+  }
+};
+
+// a High rule added after several ready Bulk ones still goes first
+void high_first( EventLoop::Backend backend, EventLoop::Dispatch dispatch )
+{
+  EventLoop loop { backend };
+  loop.set_dispatch( dispatch );
+  vector<size_t> log;
+  const ReadyPipes bulk { loop, loop.add_category( "bulk" ), 4, 1, log };
+  const size_t high_category = loop.add_category( "high" );
+  loop.set_category_priority( high_category, EventLoop::Priority::High );
+  const ReadyPipes high { loop, high_category, 1, 1, log };
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and high.calls == 1, "High rule served first" );
+  if ( dispatch == EventLoop::Dispatch::OneRule ) {
+    expect( bulk.calls == 0, "and alone" );
+    expect( loop.priority_stats( EventLoop::Priority::Bulk ).deferred == 4, "ready Bulk rules deferred" );
+    while ( loop.wait_next_event( 0 ) == EventLoop::Result::Success ) {}
+    expect( loop.priority_stats( EventLoop::Priority::Bulk ).max_wait == 4, "the last waited four calls" );
+  } else {
+    expect( bulk.calls == 4 and log.size() == 5 and log.front() == high_category,
+            "then the Bulk ones, in the same call" );
+  }
+  expect( loop.priority_stats( EventLoop::Priority::High ).callbacks == 1
+            and loop.priority_stats( EventLoop::Priority::Bulk ).callbacks == 4
+            and loop.priority_stats( EventLoop::Priority::High ).deferred == 0,
+          "callbacks counted per class" );
+}
+
+// among non-fd rules too
+void high_first_non_fd()
+{
+  EventLoop loop;
+  vector<string> order;
+  unsigned int bulk_pending = 1;
+  unsigned int high_pending = 1;
+  loop.add_rule( "bulk", [&] { --bulk_pending, order.emplace_back( "bulk" ); }, [&] { return bulk_pending > 0; } );
+  const size_t high_category = loop.add_category( "high" );
+  loop.set_category_priority( high_category, EventLoop::Priority::High );
+  loop.add_rule(
+    high_category, [&] { --high_pending, order.emplace_back( "high" ); }, [&] { return high_pending > 0; } );
+
+  loop.wait_next_event( 0 );
+  loop.wait_next_event( 0 );
+  expect( order == vector<string> { "high", "bulk" }, "High non-fd rule first" );
+}
+
+// under a Bulk budget, Bulk categories share the callbacks by weight; High rules aren't counted
+void weighted_shares( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  loop.set_dispatch( EventLoop::Dispatch::AllReady );
+  loop.set_bulk_budget( 4 );
+  vector<size_t> log;
+
+  const size_t heavy_category = loop.add_category( "heavy" );
+  loop.set_category_priority( heavy_category, EventLoop::Priority::Bulk, 3 );
+  const ReadyPipes heavy { loop, heavy_category, 4, 100, log };
+  const ReadyPipes light { loop, loop.add_category( "light" ), 4, 100, log };
+  const size_t high_category = loop.add_category( "high" );
+  loop.set_category_priority( high_category, EventLoop::Priority::High );
+  const ReadyPipes high { loop, high_category, 2, 100, log };
+
+  for ( unsigned int round = 1; round <= 20; ++round ) {
+    expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success, "served" );
+    expect( high.calls == 2 * round, "High rules all served" );
+    expect( heavy.calls + light.calls == 4 * round, "Bulk callbacks up to the budget" );
+  }
+  expect( heavy.calls == 60 and light.calls == 20, "shared 3:1" );
+  expect( loop.priority_stats( EventLoop::Priority::Bulk ).deferred > 0
+            and loop.priority_stats( EventLoop::Priority::Bulk ).max_wait == 3,
+          "Bulk rules left waiting, each light one three calls of every four" );
+
+  ostringstream dumped;
+  loop.dump_stats( dumped );
+  expect( dumped.str().find( "high: 40 callbacks, 0 deferred" ) != string::npos, "per-class line: " + dumped.str() );
+}
+
+void zero_weight_rejected()
+{
+  EventLoop loop;
+  const size_t nothing = loop.add_category( "nothing" );
+  expect_throws( [&] { loop.set_category_priority( nothing, EventLoop::Priority::Bulk, 0 ); }, "weight 0 rejected" );
+}
+
+int main()
+{
+  try {
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      high_first( backend, EventLoop::Dispatch::OneRule );
+      high_first( backend, EventLoop::Dispatch::AllReady );
+      weighted_shares( backend );
+    }
+    high_first_non_fd();
+    zero_weight_rejected();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
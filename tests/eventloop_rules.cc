@@ -0,0 +1,158 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "inline_function.hh"
+#include "slab_list.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// count every allocation in the program
+size_t allocations = 0; // NOLINT(*-avoid-non-const-global-variables)
+
+void* operator new( size_t size )
+{
+  ++allocations;
+  if ( void* const p = malloc( size ) ) { // NOLINT(*-no-malloc)
+    return p;
+  }
+  throw bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+  free( p ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* p, size_t /* size */ ) noexcept
+{
+  free( p ); // NOLINT(*-no-malloc)
+}
+
+void inline_function()
+{
+  int calls = 0;
+  auto shared = make_shared<int>( 7 );
+  auto small = [&calls, shared] { calls += *shared; };
+  static_assert( InlineFunction<void()>::stores_inline<decltype( small )>() );
+
+  const size_t before = allocations;
+  InlineFunction<void()> f { small };
+  InlineFunction<void()> g { f };
+  InlineFunction<void()> h { move( f ) };
+  g();
+  h();
+  const bool allocated = allocations != before; // before building expect()'s message
+  expect( not allocated, "small lambda copied and moved without allocating" );
+  expect( calls == 14 and shared.use_count() == 4, "copies share the captures" ); // shared, small, g and h
+  expect( not f, "moved-from function is empty" );
+
+  h = g;
+  g.reset();
+  expect( shared.use_count() == 3, "reset destroys the captures" );
+
+  // too big for the inline storage: kept on the heap instead
+  array<char, 100> big {};
+  big[0] = 'x';
+  InlineFunction<char()> fallback { [big] { return big[0]; } };
+  const InlineFunction<char()> copy { fallback };
+  expect( fallback() == 'x' and copy() == 'x', "large lambda called" );
+}
+
+void slab_list()
+{
+  SlabList<string> list;
+  vector<SlabList<string>::iterator> its;
+  for ( int i = 0; i < 100; ++i ) {
+    its.push_back( list.emplace_back( to_string( i ) ) );
+  }
+  string* const element = &*its[50];
+
+  const auto handle = list.handle( its[10] );
+  list.erase( its[10] );
+  expect( not list.find( handle ), "erased element not found through its handle" );
+  const auto reused = list.emplace_back( "new" );
+  expect( reused.index() == handle.index and not list.find( handle ), "slot reused under a new generation" );
+  expect( *list.find( list.handle( reused ) ) == "new", "new element found through its own handle" );
+
+  list.move_to_back( its[0] );
+  expect( &*its[50] == element, "elements never move" );
+
+  vector<string> order;
+  for ( const auto& s : list ) {
+    order.push_back( s );
+  }
+  expect( order.size() == 100 and order.front() == "1" and order[98] == "new" and order.back() == "0",
+          "list order kept through erase, insertion and move_to_back" );
+}
+
+// once the slabs have grown, adding, serving and cancelling rules allocates nothing
+void no_allocation_per_rule( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  const size_t category = loop.add_category( "rules" );
+  auto [read_end, write_end] = make_pipe();
+  string buf;
+  buf.reserve( 64 );
+
+  const auto cycle = [&] {
+    unsigned int pending = 1;
+    auto work = loop.add_rule( category, [&] { --pending; }, [&] { return pending > 0; } );
+    auto reader = loop.add_rule( category, read_end, Direction::In, [&] {
+      buf.resize( 64 );
+      read_end.read( buf );
+    } );
+    write_end.write( "x" );
+    while ( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and pending > 0 ) {}
+    loop.wait_next_event( 1000 );
+    work.cancel();
+    reader.cancel();
+    loop.wait_next_event( 0 );
+  };
+
+  cycle(); // grows the slabs and the loop's scratch vectors
+  const size_t before = allocations;
+  for ( int i = 0; i < 100; ++i ) {
+    cycle();
+  }
+  const bool allocated = allocations != before;
+  expect( not allocated, "no allocations after warming up" );
+}
+
+void stale_handle()
+{
+  EventLoop loop;
+  unsigned int first_calls = 0;
+  auto first = loop.add_rule( "first", [&] { ++first_calls; }, [] { return false; } );
+  first.cancel();
+  loop.wait_next_event( 0 ); // erases it, freeing its slot
+
+  unsigned int pending = 1;
+  loop.add_rule( "second", [&] { --pending; }, [&] { return pending > 0; } ); // takes the same slot
+  first.cancel();
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and pending == 0,
+          "stale handle doesn't cancel the rule now in its slot" );
+  expect( first_calls == 0, "cancelled rule never ran" );
+}
+
+int main()
+{
+  try {
+    inline_function();
+    slab_list();
+    no_allocation_per_rule( EventLoop::Backend::Poll );
+    no_allocation_per_rule( EventLoop::Backend::IoUring );
+    stale_handle();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
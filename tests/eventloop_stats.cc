@@ -0,0 +1,124 @@
+#include "eventloop.hh"
+#include "expect.hh"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+bool contains( const string& haystack, const string& needle )
+{
+  return haystack.find( needle ) != string::npos;
+}
+
+void per_category()
+{
+  EventLoop loop;
+  loop.set_profiling( true );
+  auto [read_end, write_end] = make_pipe();
+
+  unsigned int pending = 10;
+  const size_t fast = loop.add_category( "fast" );
+  loop.add_rule( fast, [&] { --pending; }, [&] { return pending > 0; } );
+
+  const size_t slow = loop.add_category( "slow \"reader\"" );
+  loop.add_rule( slow, read_end, Direction::In, [&] {
+    string buf;
+    read_end.read( buf );
+    this_thread::sleep_for( 2ms );
+  } );
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and pending == 0, "fast rule drained" );
+  write_end.write( "x" );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success, "slow rule served" );
+  expect( loop.wait_next_event( 20 ) == EventLoop::Result::Timeout, "then nothing" );
+
+  const auto& fast_stats = loop.category_stats( fast );
+  const auto& slow_stats = loop.category_stats( slow );
+  expect( fast_stats.callbacks == 10 and slow_stats.callbacks == 1, "callbacks counted" );
+  expect( slow_stats.max_callback_time >= 2ms and slow_stats.callback_time == slow_stats.max_callback_time,
+          "callback time measured" );
+  expect( fast_stats.max_callback_time < slow_stats.max_callback_time, "per category" );
+  expect( slow_stats.scanned == 2, "the fd rule scanned once per call that got that far" ); // not the first
+
+  const auto& loop_stats = loop.loop_stats();
+  expect( loop_stats.iterations == 3 and loop_stats.iteration_latency.count() == 3, "iterations counted" );
+  expect( loop_stats.blocked_time >= 15ms, "blocked time measured" );
+
+  ostringstream table;
+  loop.dump_stats( table );
+  expect( contains( table.str(), "3 iterations" ) and contains( table.str(), "fast" ), "table" );
+
+  ostringstream json;
+  loop.dump_stats( json, EventLoop::StatsFormat::Json );
+  expect( contains( json.str(), R"({"iterations":3,)" )
+            and contains( json.str(), R"({"name":"fast","callbacks":10,)" )
+            and contains( json.str(), R"("name":"slow \"reader\"")" ),
+          "JSON, with names escaped: " + json.str() );
+}
+
+void off_by_default()
+{
+  EventLoop loop;
+  const size_t category = loop.add_category( "rule" );
+  unsigned int pending = 1;
+  loop.add_rule( category, [&] { --pending; }, [&] { return pending > 0; } );
+  loop.wait_next_event( 0 );
+  expect( not loop.profiling() and loop.category_stats( category ).callbacks == 0
+            and loop.loop_stats().iterations == 0,
+          "nothing counted" );
+}
+
+// the signal interrupts a wait, which returns as a timeout; the next call dumps the stats
+void dump_on_signal( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  loop.set_profiling( true );
+  auto [read_end, write_end] = make_pipe();
+  loop.add_rule( "idle reader", read_end, Direction::In, [&] {} );
+
+  EventLoop::dump_stats_on_signal( SIGUSR1 );
+  const pthread_t waiting = pthread_self();
+  thread signaller { [waiting] {
+    this_thread::sleep_for( 50ms );
+    pthread_kill( waiting, SIGUSR1 );
+  } };
+
+  const auto start = chrono::steady_clock::now();
+  const auto result = loop.wait_next_event( 10000 );
+  signaller.join();
+  expect( result == EventLoop::Result::Timeout and chrono::steady_clock::now() - start < 5s,
+          "wait cut short by the signal" );
+
+  ostringstream dumped;
+  auto* const saved = cerr.rdbuf( dumped.rdbuf() );
+  loop.wait_next_event( 0 );
+  loop.wait_next_event( 0 );
+  cerr.rdbuf( saved );
+  expect( contains( dumped.str(), "idle reader" ) and dumped.str().find( "event loop stats" ) == 0
+            and dumped.str().find( "event loop stats", 1 ) == string::npos,
+          "dumped once" );
+}
+
+int main()
+{
+  try {
+    per_category();
+    off_by_default();
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      dump_on_signal( backend );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+// Checks for the tests that exercise the util/ library directly: each throws, so a test's main() reports the
+// first failed expectation and exits with a failure status.
+
+inline void expect( bool condition, const std::string& what )
+{
+  if ( not condition ) {
+    throw std::runtime_error( "expectation failed: " + what );
+  }
+}
+
+template<typename Fn>
+void expect_throws( Fn fn, const std::string& what )
+{
+  try {
+    fn();
+  } catch ( const std::exception& ) {
+    return;
+  }
+  throw std::runtime_error( "expected an exception: " + what );
+}
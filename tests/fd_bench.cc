@@ -0,0 +1,143 @@
+#include "bench.hh"
+#include "buffer_pool.hh"
+#include "fd_handle.hh"
+#include "file_descriptor.hh"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// A pipe with `chunk` bytes written and read back once per iteration.
+struct PipeRead
+{
+  FileDescriptor read_end;
+  FileDescriptor write_end;
+  string chunk;
+
+  static PipeRead make( size_t chunk_size )
+  {
+    auto [read_end, write_end] = make_pipe();
+    return { move( read_end ), move( write_end ), string( chunk_size, 'x' ) };
+  }
+};
+
+template<typename ReadFn>
+BenchmarkSuite::BodyT pipe_read( size_t chunk_size, ReadFn read )
+{
+  auto state = make_shared<PipeRead>( PipeRead::make( chunk_size ) );
+  return [state, read]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      state->write_end.write( state->chunk );
+      read( state->read_end );
+    }
+  };
+}
+
+void program_body()
+{
+  BenchmarkSuite suite { "FileDescriptor" };
+
+  for ( const size_t chunk_size : { 64, 1500, 16384 } ) {
+    const string suffix = "(" + to_string( chunk_size ) + " bytes)";
+
+    suite.add( "read(string&), fresh string " + suffix,
+               pipe_read( chunk_size,
+                          []( FileDescriptor& fd ) {
+                            string buf;
+                            fd.read( buf );
+                            do_not_optimize( buf );
+                          } ),
+               chunk_size );
+
+    suite.add( "read(string&), reused string " + suffix,
+               pipe_read( chunk_size,
+                          [buf = make_shared<string>()]( FileDescriptor& fd ) {
+                            buf->clear();
+                            fd.read( *buf );
+                            do_not_optimize( *buf );
+                          } ),
+               chunk_size );
+
+    suite.add( "read(BufferPool&) " + suffix,
+               pipe_read( chunk_size,
+                          [pool = make_shared<BufferPool>( 16384 )]( FileDescriptor& fd ) {
+                            const PooledBuffer buf = fd.read( *pool );
+                            do_not_optimize( buf.data() );
+                          } ),
+               chunk_size );
+  }
+
+  // A peer that has gone away: every write fails with EPIPE.
+  auto broken = make_shared<PipeRead>( PipeRead::make( 0 ) );
+  broken->read_end.close();
+  signal( SIGPIPE, SIG_IGN ); // NOLINT(*-err33-c)
+
+  suite.add( "write() to a closed pipe (throws)", [broken]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      try {
+        broken->write_end.write( "x" );
+      } catch ( const unix_error& e ) {
+        do_not_optimize( e.error_code() );
+      }
+    }
+  } );
+
+  suite.add( "try_write() to a closed pipe", [broken]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      do_not_optimize( broken->write_end.try_write( "x" ).error() );
+    }
+  } );
+
+  // Handle churn, as in an accept loop: take ownership of a new fd, share it once, drop both.
+  auto pipe = make_shared<PipeRead>( PipeRead::make( 0 ) );
+
+  suite.add( "FileDescriptor: adopt + duplicate() + close", [pipe]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const FileDescriptor fd { dup( pipe->read_end.fd_num() ) };
+      const FileDescriptor copy = fd.duplicate();
+      do_not_optimize( copy.fd_num() );
+    }
+  } );
+
+  suite.add( "FDHandle: adopt + duplicate() + close", [pipe]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const FDHandle fd { dup( pipe->read_end.fd_num() ) };
+      const FDHandle copy = fd.duplicate();
+      do_not_optimize( copy.fd_num() );
+    }
+  } );
+
+  suite.add( "FileDescriptor: duplicate() only", [pipe]( uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const FileDescriptor copy = pipe->read_end.duplicate();
+      do_not_optimize( copy.fd_num() );
+    }
+  } );
+
+  suite.add( "FDHandle: duplicate() only", [handle = make_shared<FDHandle>( dup( pipe->read_end.fd_num() ) )](
+                                               uint64_t iterations ) {
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+      const FDHandle copy = handle->duplicate();
+      do_not_optimize( copy.fd_num() );
+    }
+  } );
+
+  suite.run();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
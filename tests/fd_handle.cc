@@ -0,0 +1,118 @@
+#include "expect.hh"
+#include "fd_handle.hh"
+#include "socket.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+pair<FDHandle, FDHandle> handle_pipe()
+{
+  array<int, 2> fds {};
+  if ( pipe2( fds.data(), O_CLOEXEC ) < 0 ) {
+    throw runtime_error( "pipe2 failed" );
+  }
+  return { FDHandle { fds[0] }, FDHandle { fds[1] } };
+}
+
+int main()
+{
+  try {
+    {
+      auto [read_end, write_end] = handle_pipe();
+      expect( read_end.use_count() == 1, "one handle" );
+
+      FDHandle reader = read_end.duplicate();
+      expect( read_end.use_count() == 2 and reader.fd_num() == read_end.fd_num(), "duplicate shares the fd" );
+
+      expect( write_end.write( "hello" ) == 5, "write" );
+      string buf;
+      reader.read( buf );
+      expect( buf == "hello", "read through the duplicate" );
+      expect( read_end.read_count() == 1 and write_end.write_count() == 1, "counts are shared" );
+
+      const FDHandle moved = move( reader );
+      expect( not reader.valid() and moved.valid() and read_end.use_count() == 2, "move keeps the count" ); // NOLINT
+
+      write_end.close();
+      read_end.read( buf );
+      expect( buf.empty() and moved.eof(), "eof is shared" );
+      expect_throws( [&] { FDHandle again { read_end.fd_num() }; }, "an fd can only be adopted once" );
+    }
+
+    {
+      // the last handle closes the fd
+      auto [read_end, write_end] = handle_pipe();
+      const int fd = read_end.fd_num();
+      { const FDHandle gone = move( read_end ); }
+      expect( fcntl( fd, F_GETFD ) < 0, "closed by the last handle" ); // NOLINT(*-vararg)
+    }
+
+    {
+      // a handle whose fd was closed and reused is stale
+      auto [read_end, write_end] = handle_pipe();
+      const FDHandle old = read_end.duplicate();
+      const int fd = read_end.fd_num();
+      read_end.close();
+      expect( old.closed(), "close is seen by every handle" );
+
+      const int reused = dup( write_end.fd_num() ); // lowest free number: the one just closed
+      expect( reused == fd, "the kernel reuses the number" );
+      FDHandle fresh { reused };
+      expect( not old.valid() and not read_end.valid(), "old handles are stale" );
+      expect_throws( [&] { (void)old.fd_num(); }, "use of a stale handle" );
+      expect( fresh.use_count() == 1 and not fresh.closed(), "stale handles don't count" );
+    }
+
+    {
+      // another thread reusing the number: the stale check and accessors are race-free (for the thread sanitizer)
+      auto [read_end, write_end] = handle_pipe();
+      const FDHandle old = read_end.duplicate();
+      const int fd = read_end.fd_num();
+      read_end.close();
+
+      atomic<bool> done = false;
+      thread other { [&] {
+        for ( int i = 0; i < 1000; ++i ) {
+          const FDHandle fresh { dup( write_end.fd_num() ) };
+        }
+        done = true;
+      } };
+      while ( not done ) {
+        (void)old.valid();
+        try {
+          (void)old.read_count();
+        } catch ( const runtime_error& ) { // stale by now
+        }
+      }
+      other.join();
+      expect( not old.valid() and fcntl( fd, F_GETFD ) < 0, "stale after reuse on another thread" ); // NOLINT
+    }
+
+    {
+      TCPSocket server;
+      server.set_reuseaddr();
+      server.bind( Address { "127.0.0.1", 0 } );
+      server.listen();
+
+      TCPSocket client;
+      client.connect( server.local_address() );
+      FDHandle conn = server.accept_handle();
+      expect( conn.write( "hi" ) == 2, "write to accepted handle" );
+      string buf;
+      client.read( buf );
+      expect( buf == "hi", "accept_handle connection works" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include "expect.hh"
+#include "file_descriptor.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Each iteration writes `chunk_size` bytes and drains them with reads into fresh (empty) buffers: strings, or
+// (if `vectored`) a single-string vector.
+void exchange( FileDescriptor& read_end,
+               FileDescriptor& write_end,
+               size_t chunk_size,
+               size_t iterations,
+               bool vectored )
+{
+  const string chunk( chunk_size, 'x' );
+  for ( size_t i = 0; i < iterations; ++i ) {
+    write_end.write( chunk );
+    size_t received = 0;
+    while ( received < chunk_size ) {
+      if ( vectored ) {
+        vector<string> buffers( 1 );
+        read_end.read( buffers );
+        expect( buffers.back().size() <= 1048576, "read size within bounds" );
+        received += buffers.back().size();
+      } else {
+        string buf;
+        read_end.read( buf );
+        expect( buf.size() <= 16384, "string reads stay within kReadBufferSize" );
+        received += buf.size();
+      }
+    }
+  }
+}
+
+int main()
+{
+  try {
+    auto [read_end, write_end] = make_pipe();
+
+    expect( read_end.read_size() == 16384, "starts at the default read size" );
+
+    exchange( read_end, write_end, 100, 64, false );
+    expect( read_end.read_size() == 512, "small reads shrink the read size to the minimum" );
+    expect( read_end.read_average() < 200, "average tracks the small reads" );
+
+    // with 60000 bytes queued, a full 512-byte read lets FIONREAD jump straight to a large enough size
+    exchange( read_end, write_end, 60000, 1, true );
+    expect( read_end.read_size() >= 32768, "a full read grows the read size" );
+
+    exchange( read_end, write_end, 60000, 16, true );
+    expect( read_end.read_size() >= 32768 and read_end.read_size() <= 1048576, "bulk reads stay large" );
+
+    // a string read doesn't zero-fill the grown size
+    exchange( read_end, write_end, 60000, 1, false );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
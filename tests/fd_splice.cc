@@ -0,0 +1,85 @@
+#include "exception.hh"
+#include "expect.hh"
+#include "file_descriptor.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// read until EOF (or, if `fd` is non-blocking, until nothing is ready)
+string drain( FileDescriptor& fd )
+{
+  string ret;
+  while ( true ) {
+    string buf;
+    fd.read( buf );
+    if ( buf.empty() ) {
+      return ret;
+    }
+    ret += buf;
+  }
+}
+
+void splice_between_pipes()
+{
+  auto [a_read, a_write] = make_pipe();
+  auto [b_read, b_write] = make_pipe();
+
+  a_write.write( "spliced bytes" );
+  expect( a_read.splice_to( b_write, 7 ) == 7, "splice moves at most len bytes" );
+  expect( a_read.splice_to( b_write, 100 ) == 6, "splice moves what is available" );
+  expect( a_read.read_count() == 2 and b_write.write_count() == 2, "splice counts as a read and a write" );
+
+  a_write.close();
+  expect( a_read.splice_to( b_write, 100 ) == 0 and a_read.eof(), "splice at EOF sets eof" );
+
+  b_write.close();
+  expect( drain( b_read ) == "spliced bytes", "data arrives intact" );
+}
+
+void splice_would_block()
+{
+  auto [a_read, a_write] = make_pipe();
+  auto [b_read, b_write] = make_pipe();
+  expect( a_read.splice_to( b_write, 100 ) == 0 and not a_read.eof(), "empty pipe is not EOF" );
+}
+
+void sendfile_from_file()
+{
+  FILE* tmp = tmpfile();
+  expect( tmp != nullptr, "tmpfile" );
+  FileDescriptor file { dup( fileno( tmp ) ) };
+  fclose( tmp ); // NOLINT(*-owning-memory)
+
+  const string contents( 100000, 'z' );
+  file.write( contents );
+  CheckSystemCall( "lseek", static_cast<int>( lseek( file.fd_num(), 0, SEEK_SET ) ) );
+
+  auto [read_end, write_end] = make_pipe();
+  read_end.set_blocking( false );
+  size_t total = 0;
+  string received;
+  while ( not file.eof() ) {
+    total += file.sendfile_to( write_end, 16384 );
+    received += drain( read_end );
+  }
+  expect( total == contents.size() and received == contents, "sendfile copies the whole file" );
+}
+
+int main()
+{
+  try {
+    splice_between_pipes();
+    splice_would_block();
+    sendfile_from_file();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
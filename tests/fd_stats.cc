@@ -0,0 +1,61 @@
+#include "expect.hh"
+#include "file_descriptor.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    FDStatsRegistry::enable( false );
+    {
+      auto [read_end, write_end] = make_pipe();
+      expect( read_end.stats() == nullptr, "no stats unless enabled" );
+    }
+
+    FDStatsRegistry::enable();
+    const size_t live_before = FDStatsRegistry::size();
+    {
+      auto [read_end, write_end] = make_pipe();
+      expect( read_end.stats() and write_end.stats(), "stats when enabled" );
+      expect( FDStatsRegistry::size() == live_before + 2, "registered" );
+
+      write_end.write( "hello" );
+      string buf;
+      read_end.read( buf );
+      const FDStats& rs = *read_end.stats();
+      expect( rs.reads == 1 and rs.bytes_read == 5, "read counted" );
+      expect( write_end.stats()->writes == 1 and write_end.stats()->bytes_written == 5, "write counted" );
+      expect( rs.read_latency.count() == 1, "read latency recorded" );
+
+      read_end.set_blocking( false );
+      read_end.read( buf );
+      expect( rs.would_block_reads == 1, "EAGAIN counted" );
+
+      // fill the pipe: the write that doesn't fit is partial
+      write_end.set_blocking( false );
+      const string big( 1 << 20, 'x' );
+      write_end.write( big );
+      expect( write_end.stats()->partial_writes == 1, "partial write counted" );
+      try {
+        write_end.write( big ); // full pipe: FileDescriptor::write treats EAGAIN as writing nothing, and throws
+      } catch ( const runtime_error& ) {
+      }
+      expect( write_end.stats()->would_block_writes == 1, "EAGAIN on write counted" );
+
+      ostringstream dump;
+      FDStatsRegistry::dump( dump );
+      expect( dump.str().find( to_string( read_end.fd_num() ) ) != string::npos, "dump lists the descriptor" );
+    }
+    expect( FDStatsRegistry::size() == live_before, "unregistered when the descriptor goes away" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "buffer_pool.hh"
+#include "expect.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+
+using namespace std;
+
+int main()
+{
+  try {
+    signal( SIGPIPE, SIG_IGN ); // NOLINT(*-err33-c)
+
+    {
+      auto [read_end, write_end] = make_pipe();
+      read_end.set_blocking( false );
+
+      string buf;
+      const IOResult nothing = read_end.try_read( buf );
+      expect( not nothing and nothing.would_block() and buf.empty(), "empty non-blocking pipe would block" );
+      read_end.read( buf );
+      expect( buf.empty(), "read() still treats EAGAIN as no data" );
+
+      expect( write_end.try_write( "hello" ).bytes() == 5, "try_write" );
+      const IOResult got = read_end.try_read( buf );
+      expect( got and got.bytes() == 5 and buf == "hello", "try_read" );
+      expect( read_end.read_count() == 1 and write_end.write_count() == 1, "counted like read()/write()" );
+
+      write_end.close();
+      const IOResult at_eof = read_end.try_read( buf );
+      expect( at_eof and at_eof.bytes() == 0 and read_end.eof(), "EOF is a successful read of 0 bytes" );
+    }
+
+    {
+      auto [read_end, write_end] = make_pipe();
+      read_end.set_blocking( false );
+
+      vector<string> buffers( 2 );
+      BufferPool pool { 4096 };
+      PooledBuffer pooled;
+      expect( read_end.try_read( buffers ).would_block() and buffers.empty(), "readv would block" );
+      expect( read_end.try_read( pool, pooled ).would_block() and pooled.empty(), "pooled read would block" );
+
+      write_end.write( "scatter" );
+      buffers.resize( 2 );
+      expect( read_end.try_read( buffers ).bytes() == 7 and buffers.back() == "scatter", "try_read (readv)" );
+      write_end.write( "pooled" );
+      expect( read_end.try_read( pool, pooled ).bytes() == 6 and pooled.view() == "pooled", "try_read (pool)" );
+    }
+
+    {
+      auto [read_end, write_end] = make_pipe();
+      read_end.close();
+
+      const IOResult result = write_end.try_write( vector<string_view> { "a", "b" } );
+      expect( not result and result.error() == EPIPE and result.peer_closed(), "EPIPE is returned" );
+
+      bool threw = false;
+      try {
+        write_end.write( "x" );
+      } catch ( const unix_error& e ) {
+        threw = e.error_code() == EPIPE;
+      }
+      expect( threw, "write() throws the same error" );
+    }
+
+    {
+      TCPSocket server;
+      server.set_reuseaddr();
+      server.bind( Address { "127.0.0.1", 0 } );
+      server.listen();
+      server.set_blocking( false );
+
+      optional<TCPSocket> connection;
+      const IOResult none = server.try_accept( connection );
+      expect( none.would_block() and not connection, "nothing to accept" );
+
+      TCPSocket client;
+      client.connect( server.local_address() );
+      expect( server.try_accept( connection ) and connection.has_value(), "try_accept" );
+
+      // a reset from the peer is an ordinary result, not an exception
+      const linger abort_on_close { 1, 0 };
+      setsockopt( client.fd_num(), SOL_SOCKET, SO_LINGER, &abort_on_close, sizeof( abort_on_close ) );
+      client.close();
+
+      connection->set_blocking( true );
+      string buf;
+      const IOResult reset = connection->try_read( buf );
+      expect( not reset and reset.error() == ECONNRESET and reset.peer_closed(), "ECONNRESET is returned" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "expect.hh"
+#include "file_sink.hh"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+string pattern( size_t size, char seed )
+{
+  string ret( size, 0 );
+  for ( size_t i = 0; i < size; ++i ) {
+    ret[i] = static_cast<char>( seed + i % 61 );
+  }
+  return ret;
+}
+
+// a temporary file open for reading and writing, and its name (unlinked when the test is done with it)
+pair<FileDescriptor, string> temp_file()
+{
+  string name = "/tmp/file_sink_test.XXXXXX";
+  FileDescriptor fd { mkstemp( name.data() ) };
+  return { move( fd ), name };
+}
+
+string contents( const string& name )
+{
+  FileDescriptor fd { CheckSystemCall( "open", open( name.c_str(), O_RDONLY ) ) };
+  string ret;
+  while ( not fd.eof() ) {
+    string chunk;
+    fd.read( chunk );
+    ret += chunk;
+  }
+  return ret;
+}
+
+int main()
+{
+  try {
+    // backpressure: nothing beyond the buffers is accepted until the writer hands some back
+    {
+      auto [fd, name] = temp_file();
+      fd.write( "header:" ); // the sink appends from the current offset
+      FileSink sink { move( fd ), 5000, 2 };
+      expect( sink.buffer_size() == 8192, "buffer size rounded up to whole pages" );
+      expect( sink.available_capacity() == 2 * 8192, "initial capacity" );
+
+      const string first = pattern( 3 * 8192, 'a' );
+      const size_t accepted = sink.push( first );
+      expect( accepted == 2 * 8192, "push takes only what fits" );
+
+      while ( sink.buffers_in_flight() > 0 ) {
+        usleep( 1000 );
+      }
+      expect( sink.bytes_written() == accepted, "the writer wrote every full buffer" );
+      expect( sink.available_capacity() == 2 * 8192, "buffers come back" );
+
+      const Ref<string> tail { string { "tail" } };
+      expect( sink.push( tail ) == 4, "push a Ref" );
+      sink.close();
+      expect( sink.bytes_written() == accepted + 4, "close writes the partial buffer" );
+      expect( contents( name ) == "header:" + first.substr( 0, accepted ) + "tail", "file contents" );
+      unlink( name.c_str() );
+    }
+
+    // a ByteStream feeding the sink through an EventLoop
+    {
+      auto [fd, name] = temp_file();
+      FileSink sink { move( fd ), 4096, 2 };
+      ByteStream stream { 10000 };
+
+      string expected;
+      size_t chunks_left = 200;
+      EventLoop loop;
+      const size_t category = loop.add_category( "file sink" );
+      loop.add_rule(
+        category,
+        [&] {
+          string chunk = pattern( 1000 + chunks_left * 7, static_cast<char>( 'A' + chunks_left % 26 ) );
+          expected += chunk;
+          stream.writer().push( move( chunk ) );
+          if ( --chunks_left == 0 ) {
+            stream.writer().close();
+          }
+        },
+        [&] { return chunks_left > 0 and stream.writer().available_capacity() >= 3000; } );
+      sink.add_rules( loop, category, stream.reader() );
+
+      while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+
+      expect( stream.reader().is_finished(), "the stream was drained" );
+      expect( sink.bytes_accepted() == expected.size(), "the sink took every byte" );
+      sink.close();
+      expect( contents( name ) == expected, "the file holds the stream" );
+      unlink( name.c_str() );
+    }
+
+    // a write error on the writer thread surfaces on the loop thread
+    {
+      auto [fd, name] = temp_file();
+      FileSink sink { FileDescriptor { CheckSystemCall( "open", open( name.c_str(), O_RDONLY ) ) }, 4096, 1 };
+      unlink( name.c_str() );
+      sink.push( pattern( 4096, 'x' ) );
+      bool threw = false;
+      try {
+        sink.close();
+      } catch ( const unix_error& e ) {
+        threw = e.error_code() == EBADF;
+      }
+      expect( threw, "pwritev's error is rethrown" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
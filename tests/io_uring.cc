@@ -0,0 +1,168 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "io_uring.hh"
+#include "socket.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace std;
+
+// submit everything queued and collect `count` completions by tag
+map<uint64_t, int32_t> complete( IoUring& ring, size_t count )
+{
+  map<uint64_t, int32_t> results;
+  while ( results.size() < count ) {
+    ring.submit( 1, 1000 );
+    while ( const auto c = ring.next_completion() ) {
+      results[c->user_data] = c->result;
+    }
+  }
+  return results;
+}
+
+void read_and_writev()
+{
+  IoUring ring { 8 };
+  auto [read_end, write_end] = make_pipe();
+
+  const string hello = "hello, ";
+  const string world = "world";
+  const array<iovec, 2> iov { { { const_cast<char*>( hello.data() ), hello.size() },   // NOLINT(*-const-cast)
+                                { const_cast<char*>( world.data() ), world.size() } } }; // NOLINT(*-const-cast)
+  string buf( 64, '\0' );
+
+  ring.prepare_writev( write_end, iov, 1 );
+  ring.prepare_read( read_end, buf, 2 );
+  expect( ring.queued() == 2, "two operations queued" );
+
+  auto results = complete( ring, 2 );
+  expect( results.at( 1 ) == 12, "writev wrote both buffers" );
+  expect( results.at( 2 ) == 12 and buf.substr( 0, 12 ) == "hello, world", "read got the data" );
+}
+
+void fixed_files_and_buffers()
+{
+  IoUring ring { 8 };
+  auto [read_end, write_end] = make_pipe();
+
+  string buf( 64, '\0' );
+  const array<int, 2> files { read_end.fd_num(), write_end.fd_num() };
+  const array<iovec, 1> buffers { { { buf.data(), buf.size() } } };
+  ring.register_files( files );
+  ring.register_buffers( buffers );
+
+  const string data = "registered";
+  const array<iovec, 1> iov { { { const_cast<char*>( data.data() ), data.size() } } }; // NOLINT(*-const-cast)
+  ring.prepare_writev( IoUring::File::registered( 1 ), iov, 1 );
+  complete( ring, 1 );
+
+  ring.prepare_read_fixed( IoUring::File::registered( 0 ), buf, 0, 2 );
+  const auto results = complete( ring, 1 );
+  expect( results.at( 2 ) == 10 and buf.substr( 0, 10 ) == "registered", "read into a registered buffer" );
+}
+
+void accept_and_connect()
+{
+  IoUring ring { 8 };
+  TCPSocket listener;
+  listener.set_reuseaddr();
+  listener.bind( Address { "127.0.0.1", 0 } );
+  listener.listen();
+
+  TCPSocket client;
+  const Address server_address = listener.local_address();
+  ring.prepare_accept( listener, 1 );
+  ring.prepare_connect( client, server_address, 2 );
+
+  const auto results = complete( ring, 2 );
+  expect( results.at( 2 ) == 0, "connect succeeded" );
+  expect( results.at( 1 ) >= 0, "accept returned a descriptor" );
+
+  FileDescriptor accepted { results.at( 1 ) };
+  client.write( "ping" );
+  string buf;
+  accepted.read( buf );
+  expect( buf == "ping", "accepted connection carries data" );
+}
+
+// more completions than the completion queue holds: none lost, and nothing left unsubmitted
+void completion_overflow()
+{
+  IoUring ring { 2 }; // a completion queue of 4
+  auto [read_end, write_end] = make_pipe();
+
+  constexpr uint64_t operations = 32;
+  for ( uint64_t tag = 1; tag <= operations; ++tag ) {
+    ring.prepare_poll_add( write_end, POLLOUT, tag ); // completes at once
+    ring.submit();
+  }
+  expect( ring.queued() == 0, "every operation handed to the kernel" );
+
+  const auto results = complete( ring, operations );
+  expect( results.size() == operations and results.rbegin()->first == operations, "every completion came back" );
+}
+
+void eventloop_backend()
+{
+  EventLoop loop { EventLoop::Backend::IoUring };
+  expect( loop.backend() == EventLoop::Backend::IoUring, "io_uring backend selected" );
+
+  auto [read_end, write_end] = make_pipe();
+  string received;
+  bool want_read = true;
+  bool cancelled = false;
+  loop.add_rule(
+    "reader",
+    read_end,
+    Direction::In,
+    [&] {
+      string buf;
+      read_end.read( buf );
+      received += buf;
+    },
+    [&] { return want_read; },
+    [&] { cancelled = true; } );
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "nothing to read yet" );
+
+  write_end.write( "abc" );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abc", "rule fired" );
+
+  want_read = false;
+  write_end.write( "def" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "uninterested rule leaves nothing to wait for" );
+  want_read = true;
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and received == "abcdef",
+          "interest change re-arms the request" );
+
+  write_end.close();
+  while ( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit ) {}
+  expect( cancelled, "rule cancelled at hangup" );
+}
+
+int main()
+{
+  try {
+    if ( not IoUring::supported() ) {
+      const EventLoop loop { EventLoop::Backend::IoUring };
+      expect( loop.backend() == EventLoop::Backend::Poll, "falls back to poll without io_uring" );
+      cerr << "io_uring not supported here; only the fallback was tested\n";
+      return EXIT_SUCCESS;
+    }
+
+    read_and_writev();
+    fixed_files_and_buffers();
+    accept_and_connect();
+    completion_overflow();
+    eventloop_backend();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#include "expect.hh"
+#include "mapped_file.hh"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// an unlinked temporary file holding `contents`, open for reading
+FileDescriptor temp_file( string_view contents )
+{
+  string name = "/tmp/mapped_file_test.XXXXXX";
+  FileDescriptor fd { mkstemp( name.data() ) };
+  unlink( name.c_str() );
+  fd.write( contents );
+  return fd;
+}
+
+int main()
+{
+  try {
+    string contents;
+    for ( uint32_t i = 0; i < 5000; ++i ) {
+      contents += static_cast<char>( i >> 24 );
+      contents += static_cast<char>( i >> 16 );
+      contents += static_cast<char>( i >> 8 );
+      contents += static_cast<char>( i );
+    }
+
+    MappedFile file { temp_file( contents ) };
+    expect( file.size() == contents.size() and file.view() == contents, "the mapping shows the file" );
+    expect( file.window( 4, 8 ) == contents.substr( 4, 8 ), "window" );
+    expect( file.window( contents.size() - 2, 100 ).size() == 2, "window clipped at the end" );
+    expect( file.window( contents.size() + 10, 5 ).empty(), "window past the end" );
+
+    const auto windows = file.windows( 4096 );
+    expect( windows.size() == 5 and windows.back().size() == contents.size() - 4 * 4096, "windows" );
+    expect( windows.front().data() == file.view().data(), "windows point into the mapping" );
+    file.prefetch( 4096, 8192 );
+
+    // parse in place
+    Parser parser = file.parser( 400 );
+    for ( uint32_t i = 100; i < 200; ++i ) {
+      uint32_t x {};
+      parser.integer( x );
+      expect( x == i, "parsed from the mapping" );
+    }
+    parser.truncate( 8 );
+    vector<Ref<string>> rest;
+    parser.all_remaining( rest );
+    expect( rest.size() == 1 and rest.front().get() == contents.substr( 800, 8 ), "remaining bytes are copied out" );
+
+    // to the socket write path, with no copy of our own
+    auto [read_end, write_end] = make_pipe();
+    expect( write_end.write( file.window( 0, 1000 ) ) == 1000, "write a window" );
+    string received;
+    read_end.read( received );
+    expect( received == contents.substr( 0, 1000 ), "window arrives" );
+
+    const MappedFile moved = move( file );
+    expect( moved.view() == contents and file.view().empty(), "move transfers the mapping" ); // NOLINT
+
+    const MappedFile empty { temp_file( "" ) };
+    expect( empty.size() == 0 and empty.view().empty() and empty.windows( 10 ).empty(), "empty file" );
+
+    // owned input to a Parser still trims what was parsed or truncated away
+    Parser owned { vector<string> { "abcdef", "ghij" } };
+    owned.remove_prefix( 2 );
+    owned.truncate( 6 );
+    owned.all_remaining( rest );
+    expect( rest.size() == 2 and rest[0].get() == "cdef" and rest[1].get() == "gh", "owned buffers trimmed" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
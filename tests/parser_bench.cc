@@ -0,0 +1,99 @@
+#include "bench.hh"
+#include "parser.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// an input split across several buffers, like a datagram assembled from fragments
+vector<Ref<string>> make_input( size_t total_size, size_t segment_size )
+{
+  vector<Ref<string>> ret;
+  for ( size_t i = 0; i < total_size; i += segment_size ) {
+    ret.emplace_back( string( min( segment_size, total_size - i ), '\x5a' ) );
+  }
+  return ret;
+}
+
+void program_body()
+{
+  BenchmarkSuite suite { "Parser/Serializer" };
+
+  suite.add(
+    "Serializer: 20 x uint32_t + finish",
+    []( uint64_t iterations ) {
+      for ( uint64_t i = 0; i < iterations; ++i ) {
+        Serializer s;
+        for ( uint32_t j = 0; j < 20; ++j ) {
+          s.integer( j );
+        }
+        auto out = s.finish();
+        do_not_optimize( out );
+      }
+    },
+    80 );
+
+  suite.add(
+    "Serializer: header + 1400-byte Ref payload",
+    []( uint64_t iterations ) {
+      const string payload( 1400, 'p' );
+      for ( uint64_t i = 0; i < iterations; ++i ) {
+        Serializer s;
+        s.integer( uint16_t { 0x0800 } );
+        s.integer( uint32_t { 0x12345678 } );
+        s.buffer( borrow( payload ) );
+        auto out = s.finish();
+        do_not_optimize( out );
+      }
+    },
+    1406 );
+
+  for ( const size_t segment_size : { 1500, 7 } ) {
+    suite.add(
+      "Parser: 375 x uint32_t, " + to_string( segment_size ) + "-byte segments",
+      [segment_size]( uint64_t iterations ) {
+        for ( uint64_t i = 0; i < iterations; ++i ) {
+          clobber_memory();
+          Parser p { make_input( 1500, segment_size ) };
+          uint32_t sum = 0;
+          for ( size_t j = 0; j < 375; ++j ) {
+            uint32_t x {};
+            p.integer( x );
+            sum += x;
+          }
+          do_not_optimize( sum );
+        }
+      },
+      1500 );
+  }
+
+  suite.add(
+    "Parser: string() of 1400 bytes across 3 segments",
+    []( uint64_t iterations ) {
+      string out( 1400, '\0' );
+      for ( uint64_t i = 0; i < iterations; ++i ) {
+        Parser p { make_input( 1500, 500 ) };
+        p.remove_prefix( 100 );
+        p.string( out );
+        do_not_optimize( out );
+      }
+    },
+    1400 );
+
+  suite.run();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+#include "perf_counters.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+static int open_counter( uint32_t type, uint64_t config )
+{
+  perf_event_attr attr {};
+  attr.size = sizeof( attr );
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1; // allowed at perf_event_paranoid <= 2
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING; // NOLINT(*-signed-bitwise)
+
+  // this thread, any CPU, no group
+  return static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) ); // NOLINT(*-vararg)
+}
+
+static uint64_t cache_miss_config( uint64_t cache )
+{
+  return cache | ( PERF_COUNT_HW_CACHE_OP_READ << 8U ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16U );
+}
+
+PerfCounters::PerfCounters()
+{
+  const array<pair<uint32_t, uint64_t>, EventCount> configs { {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, cache_miss_config( PERF_COUNT_HW_CACHE_L1D ) },
+    { PERF_TYPE_HW_CACHE, cache_miss_config( PERF_COUNT_HW_CACHE_LL ) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+  } };
+
+  for ( size_t i = 0; i < configs.size(); ++i ) {
+    const int fd = open_counter( configs.at( i ).first, configs.at( i ).second );
+    if ( fd >= 0 ) {
+      counters_.at( i ).emplace( fd );
+    }
+    // otherwise (ENOENT, EOPNOTSUPP, EACCES, ENOSYS under seccomp...) leave this counter out
+  }
+}
+
+bool PerfCounters::available() const
+{
+  return any_of( counters_.begin(), counters_.end(), []( const auto& c ) { return c.has_value(); } );
+}
+
+bool PerfCounters::has_hardware_counters() const
+{
+  return counters_.at( Cycles ).has_value() and counters_.at( Instructions ).has_value();
+}
+
+void PerfCounters::start()
+{
+  for ( auto& c : counters_ ) {
+    if ( c ) {
+      CheckSystemCall( "ioctl(PERF_EVENT_IOC_RESET)", ioctl( c->fd_num(), PERF_EVENT_IOC_RESET, 0 ) );
+      CheckSystemCall( "ioctl(PERF_EVENT_IOC_ENABLE)", ioctl( c->fd_num(), PERF_EVENT_IOC_ENABLE, 0 ) );
+    }
+  }
+}
+
+void PerfCounters::stop()
+{
+  for ( auto& c : counters_ ) {
+    if ( c ) {
+      CheckSystemCall( "ioctl(PERF_EVENT_IOC_DISABLE)", ioctl( c->fd_num(), PERF_EVENT_IOC_DISABLE, 0 ) );
+    }
+  }
+}
+
+optional<double> PerfCounters::read( Event event ) const
+{
+  const auto& c = counters_.at( event );
+  if ( not c ) {
+    return {};
+  }
+
+  struct
+  {
+    uint64_t value, time_enabled, time_running;
+  } result {};
+
+  if ( CheckSystemCall( "read(perf_event)", static_cast<int>( ::read( c->fd_num(), &result, sizeof( result ) ) ) )
+       != sizeof( result ) ) {
+    throw runtime_error( "short read from perf_event counter" );
+  }
+
+  if ( result.time_running == 0 ) {
+    return {}; // never got scheduled onto the PMU
+  }
+
+  return static_cast<double>( result.value ) * static_cast<double>( result.time_enabled )
+         / static_cast<double>( result.time_running );
+}
+
+PerfReading PerfCounters::reading() const
+{
+  return { read( Cycles ),
+           read( Instructions ),
+           read( L1DMisses ),
+           read( LLCMisses ),
+           read( BranchMisses ),
+           read( TaskClock ),
+           read( PageFaults ),
+           read( ContextSwitches ) };
+}
+
+bool PerfCounters::requested()
+{
+  return getenv( "BENCH_COUNTERS" ) != nullptr;
+}
+
+string PerfReading::describe( double count, string_view unit ) const
+{
+  ostringstream ss;
+  ss << fixed;
+
+  const auto per_unit = [&]( string_view name, const optional<double>& value, int precision ) {
+    if ( value ) {
+      ss << name << "/" << unit << " " << setprecision( precision ) << *value / count << "  ";
+    }
+  };
+
+  per_unit( "cycles", cycles, 2 );
+  per_unit( "instr", instructions, 2 );
+  if ( cycles and instructions and *cycles > 0 ) {
+    ss << "IPC " << setprecision( 2 ) << *instructions / *cycles << "  ";
+  }
+  per_unit( "L1D-miss", l1d_misses, 4 );
+  per_unit( "LLC-miss", llc_misses, 4 );
+  per_unit( "br-miss", branch_misses, 4 );
+
+  if ( not cycles ) {
+    // no PMU access: fall back to what the kernel can count in software
+    per_unit( "task-clock-ns", task_clock_ns, 2 );
+    if ( page_faults ) {
+      ss << "page-faults " << setprecision( 0 ) << *page_faults << "  ";
+    }
+    if ( context_switches ) {
+      ss << "ctx-switches " << setprecision( 0 ) << *context_switches << "  ";
+    }
+  }
+
+  string ret = ss.str();
+  if ( ret.empty() ) {
+    return "no counters available";
+  }
+  ret.resize( ret.size() - 2 );
+  return ret;
+}
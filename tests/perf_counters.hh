@@ -0,0 +1,67 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Totals from a PerfCounters measurement. A field is empty if its counter couldn't be opened.
+struct PerfReading
+{
+  std::optional<double> cycles {};
+  std::optional<double> instructions {};
+  std::optional<double> l1d_misses {};
+  std::optional<double> llc_misses {};
+  std::optional<double> branch_misses {};
+  std::optional<double> task_clock_ns {};
+  std::optional<double> page_faults {};
+  std::optional<double> context_switches {};
+
+  // e.g. "cycles/B 0.41  instr/B 1.20  IPC 2.93  L1D-miss/B 0.002  LLC-miss/B 0.000  br-miss/B 0.001"
+  // (`unit` names what `count` counts, such as "B" for bytes or "op" for iterations)
+  std::string describe( double count, std::string_view unit ) const;
+};
+
+// Per-thread event counters via perf_event_open(2). Hardware counters (cycles, instructions, cache and
+// branch misses) are opened individually, so one that the CPU or VM lacks doesn't take the others down;
+// software counters (task-clock, page-faults, context-switches) are always attempted as a fallback for
+// containers without access to the PMU. If perf_event_open is unavailable altogether, available() is false.
+class PerfCounters
+{
+public:
+  enum Event : uint8_t
+  {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    TaskClock,
+    PageFaults,
+    ContextSwitches,
+    EventCount
+  };
+
+private:
+  std::array<std::optional<FileDescriptor>, EventCount> counters_ {};
+
+  std::optional<double> read( Event event ) const;
+
+public:
+  PerfCounters();
+
+  bool available() const;
+  bool has_hardware_counters() const;
+
+  void start(); // reset and enable all counters
+  void stop();  // disable all counters
+
+  // counts between start() and stop(), scaled up if the kernel had to multiplex the counters
+  PerfReading reading() const;
+
+  // true if the BENCH_COUNTERS environment variable is set (counters are opt-in)
+  static bool requested();
+};
@@ -0,0 +1,205 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+vector<TimerWheel::Timer*> advance_to( TimerWheel& wheel, uint64_t now )
+{
+  vector<TimerWheel::Timer*> expired;
+  wheel.advance( now, expired );
+  return expired;
+}
+
+void wheel_basics()
+{
+  TimerWheel wheel { 1000 };
+  expect( not wheel.next_wakeup(), "empty wheel has no wakeup" );
+
+  TimerWheel::Timer soon;
+  TimerWheel::Timer later;
+  TimerWheel::Timer cancelled;
+  wheel.arm( soon, 1010 );
+  wheel.arm( later, 1050 );
+  wheel.arm( cancelled, 1020 );
+  expect( wheel.size() == 3 and soon.armed(), "armed" );
+  expect( wheel.next_wakeup() == 1010, "wakes for the earliest deadline" );
+
+  wheel.cancel( cancelled );
+  expect( wheel.size() == 2 and not cancelled.armed(), "cancelled" );
+
+  expect( advance_to( wheel, 1009 ).empty(), "nothing expires early" );
+  const auto first = advance_to( wheel, 1030 );
+  expect( first.size() == 1 and first[0] == &soon and not soon.armed(), "first timer expires" );
+  expect( wheel.now() == 1030, "clock moved" );
+
+  wheel.arm( soon, 1000 );
+  expect( wheel.next_wakeup() == 1030, "a deadline already passed is due now" );
+  const auto second = advance_to( wheel, 2000 );
+  expect( second.size() == 2 and second[0] == &soon and second[1] == &later, "expired in order of deadline" );
+  expect( wheel.size() == 0, "wheel empty" );
+}
+
+// deadlines spread over every level, including past the top one, all expire on their tick and in order
+void wheel_cascades()
+{
+  const uint64_t start = 123'456;
+  TimerWheel wheel { start };
+  mt19937_64 rng { 42 };
+
+  vector<TimerWheel::Timer> timers( 3000 );
+  vector<uint64_t> deadlines;
+  for ( size_t i = 0; i < timers.size(); ++i ) {
+    const unsigned int bits = 1 + i % 40; // up to 2^40 ticks: beyond the top level's range
+    const uint64_t deadline = start + 1 + rng() % ( uint64_t { 1 } << bits );
+    wheel.arm( timers[i], deadline );
+    deadlines.push_back( deadline );
+  }
+  ranges::sort( deadlines );
+
+  // step from wakeup to wakeup: every expiry happens exactly at its deadline
+  size_t expired = 0;
+  uint64_t last = 0;
+  while ( const auto wakeup = wheel.next_wakeup() ) {
+    for ( auto* const timer : advance_to( wheel, *wakeup ) ) {
+      expect( timer->deadline() == *wakeup, "expired on its deadline" );
+      expect( timer->deadline() >= last, "expired in order" );
+      expect( timer->deadline() == deadlines.at( expired ), "every deadline expires once" );
+      last = timer->deadline();
+      ++expired;
+    }
+  }
+  expect( expired == timers.size() and wheel.size() == 0, "all timers expired" );
+}
+
+// one large jump expires everything due, in order, and leaves the rest
+void wheel_jump()
+{
+  TimerWheel wheel { 0 };
+  vector<TimerWheel::Timer> timers( 1000 );
+  for ( size_t i = 0; i < timers.size(); ++i ) {
+    wheel.arm( timers[i], ( i + 1 ) * 1000 );
+  }
+
+  const auto expired = advance_to( wheel, 500'000 );
+  expect( expired.size() == 500, "due timers expired" );
+  expect( ranges::is_sorted( expired, {}, &TimerWheel::Timer::deadline ), "in order" );
+  expect( wheel.size() == 500 and wheel.next_wakeup() <= 501'000, "the rest still armed" );
+
+  for ( auto& timer : timers ) {
+    wheel.cancel( timer );
+  }
+  expect( wheel.size() == 0 and not wheel.next_wakeup(), "all cancelled" );
+}
+
+void loop_timers( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  const size_t category = loop.add_category( "timers" );
+
+  const auto start = steady_clock::now();
+  steady_clock::time_point fired_at {};
+  loop.add_timer( category, 20ms, [&] { fired_at = steady_clock::now(); } );
+
+  unsigned int ticks = 0;
+  auto periodic = loop.add_timer( category, 5ms, [&] { ++ticks; }, 5ms );
+
+  unsigned int never = 0;
+  auto cancelled = loop.add_timer( category, 10ms, [&] { ++never; } );
+  cancelled.cancel();
+  expect( loop.timers_armed() == 2, "cancelling takes the timer out at once" );
+
+  while ( fired_at == steady_clock::time_point {} ) {
+    loop.wait_next_event( -1 );
+  }
+  expect( fired_at - start >= 20ms, "one-shot timer didn't fire early" );
+  expect( fired_at - start < 1s, "one-shot timer fired" );
+  expect( ticks >= 2, "periodic timer fired repeatedly" );
+
+  periodic.cancel();
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, "nothing left after the timers are done" );
+  expect( never == 0, "cancelled timer never fired" );
+}
+
+// a timer shortens the wait for fds, and a callback can re-arm and cancel timers
+void loop_timers_with_fds( EventLoop::Backend backend )
+{
+  EventLoop loop { backend };
+  auto [read_end, write_end] = make_pipe();
+  loop.add_rule( "reader", read_end, Direction::In, [&] {
+    string buf;
+    read_end.read( buf );
+  } );
+
+  bool fired = false;
+  loop.add_timer( "timer", 10ms, [&] { fired = true; } );
+  const auto start = steady_clock::now();
+  expect( loop.wait_next_event( 10'000 ) == EventLoop::Result::Success and fired, "timer woke up the wait" );
+  expect( steady_clock::now() - start < 5s, "wait cut short" );
+
+  unsigned int count = 0;
+  optional<EventLoop::RuleHandle> self;
+  self = loop.add_timer(
+    "self-cancelling",
+    1ms,
+    [&] {
+      if ( ++count == 3 ) {
+        self->cancel();
+      }
+    },
+    1ms );
+  while ( loop.timers_armed() ) {
+    loop.wait_next_event( 1000 );
+  }
+  expect( count == 3, "callback cancelled its own periodic timer" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "fd rule still waiting" );
+}
+
+void many_loop_timers()
+{
+  EventLoop loop;
+  loop.set_dispatch( EventLoop::Dispatch::AllReady );
+  const size_t category = loop.add_category( "many" );
+
+  constexpr unsigned int count = 10'000;
+  unsigned int fired = 0;
+  vector<EventLoop::RuleHandle> handles;
+  for ( unsigned int i = 0; i < count; ++i ) {
+    handles.push_back( loop.add_timer( category, milliseconds { i % 50 }, [&] { ++fired; } ) );
+  }
+  for ( unsigned int i = 0; i < count; i += 2 ) {
+    handles[i].cancel();
+  }
+
+  while ( loop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+  expect( fired == count / 2, "every uncancelled timer fired once" );
+}
+
+int main()
+{
+  try {
+    wheel_basics();
+    wheel_cascades();
+    wheel_jump();
+    for ( const auto backend : { EventLoop::Backend::Poll, EventLoop::Backend::Epoll, EventLoop::Backend::IoUring } ) {
+      loop_timers( backend );
+      loop_timers_with_fds( backend );
+    }
+    many_loop_timers();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "eventloop.hh"
+#include "expect.hh"
+#include "socket.hh"
+#include "zerocopy.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+pair<TCPSocket, TCPSocket> connected_pair()
+{
+  TCPSocket server;
+  server.set_reuseaddr();
+  server.bind( Address { "127.0.0.1", 0 } );
+  server.listen();
+
+  TCPSocket client;
+  client.connect( server.local_address() );
+  return { move( client ), server.accept() };
+}
+
+string pattern( size_t size, char seed )
+{
+  string ret( size, 0 );
+  for ( size_t i = 0; i < size; ++i ) {
+    ret[i] = static_cast<char>( seed + i % 61 );
+  }
+  return ret;
+}
+
+void send_and_reap( EventLoop::Backend backend )
+{
+  auto [sender_socket, receiver] = connected_pair();
+  sender_socket.set_blocking( false );
+  receiver.set_blocking( false );
+
+  ZeroCopySender sender { sender_socket, 4096 };
+
+  string expected;
+  for ( const auto& [size, seed] : { pair { 100, 'a' }, { 300000, 'b' }, { 50, 'c' }, { 1000000, 'd' } } ) {
+    string payload = pattern( size, seed );
+    expected += payload;
+    sender.push( move( payload ) );
+  }
+  for ( char seed = 'e'; seed < 'm'; ++seed ) {
+    string payload = pattern( 1 << 20, seed ); // enough to fill the socket buffer
+    expected += payload;
+    sender.push( move( payload ) );
+  }
+  const string small = "borrowed";
+  sender.push( borrow( small ) );
+  expected += small;
+  expect( sender.buffered_bytes() == expected.size(), "everything is buffered" );
+
+  EventLoop loop { backend };
+  sender.add_rules( loop, loop.add_category( "zerocopy" ) );
+
+  // the sending socket also has an ordinary rule, which must survive the POLLERR of each completion
+  bool got_reply = false;
+  string reply;
+  loop.add_rule( "reply", sender_socket, Direction::In, [&] {
+    sender_socket.read( reply );
+    got_reply = reply == "done";
+  } );
+
+  string received;
+  loop.add_rule( "receive", receiver, Direction::In, [&] {
+    string buf;
+    receiver.read( buf );
+    received += buf;
+    if ( received.size() == expected.size() ) {
+      receiver.write( "done" );
+    }
+  } );
+
+  for ( int i = 0; i < 10000 and not( got_reply and sender.sends_in_flight() == 0 ); ++i ) {
+    expect( loop.wait_next_event( 1000 ) != EventLoop::Result::Exit, "loop still has work" );
+  }
+
+  expect( received == expected, "data arrives intact and in order" );
+  expect( got_reply, "rule on the same socket as the reaper still works" );
+  expect( sender.buffered_bytes() == 0 and sender.sends_in_flight() == 0, "all sent and completed" );
+  expect( sender.buffers_held() == 0, "every buffer released" );
+
+  if ( sender.zerocopy_sends() > 0 ) {
+    // over loopback the kernel copies zerocopy sends, after which the sender stops using MSG_ZEROCOPY
+    expect( sender.copied_by_kernel() == 0 or not sender.zerocopy(), "gives up after a copied completion" );
+  } else {
+    cerr << "note: MSG_ZEROCOPY unavailable here; only copying sends were tested\n";
+  }
+  expect( sender.zerocopy_sends() + sender.copying_sends() > 1, "partial sends resume where they left off" );
+}
+
+int main()
+{
+  try {
+    send_and_reap( EventLoop::Backend::Poll );
+    send_and_reap( EventLoop::Backend::Epoll );
+
+    // below the threshold, sends copy and nothing waits for a completion
+    auto [a, b] = connected_pair();
+    ZeroCopySender small_sender { a, 1 << 20 };
+    small_sender.push( string( 1000, 'x' ) );
+    expect( small_sender.flush() == 1000, "small send" );
+    expect( small_sender.zerocopy_sends() == 0 and small_sender.copying_sends() == 1, "copied below threshold" );
+    expect( small_sender.buffers_held() == 0, "copied buffers are released straight away" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "async_fd.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+AsyncFD::AsyncFD( EventLoop& loop, FileDescriptor& fd ) : AsyncFD( loop, fd, loop.task_category() ) {}
+
+AsyncFD::AsyncFD( EventLoop& loop, FileDescriptor& fd, const size_t category_id )
+  : loop_( &loop ), fd_( fd.duplicate() ), category_id_( category_id )
+{}
+
+AsyncFD::~AsyncFD()
+{
+  try {
+    for ( auto* const waiter : { &reader_, &writer_ } ) {
+      if ( waiter->rule ) {
+        waiter->rule->cancel();
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing AsyncFD: " << e.what() << "\n";
+  }
+}
+
+bool AsyncFD::Wait::await_ready() const
+{
+  if ( direction_ == Direction::In ) {
+    return fd_->reader_.gone or fd_->fd_.eof() or fd_->fd_.closed();
+  }
+  return fd_->writer_.gone or fd_->fd_.closed();
+}
+
+void AsyncFD::Wait::await_suspend( const Task::Handle task ) const
+{
+  fd_->wait( direction_ == Direction::In ? fd_->reader_ : fd_->writer_, direction_, task );
+}
+
+void AsyncFD::wait( Waiter& waiter, const Direction direction, const Task::Handle task )
+{
+  if ( waiter.task ) {
+    throw runtime_error( "AsyncFD: a coroutine is already waiting in this direction" );
+  }
+
+  if ( not waiter.rule ) {
+    waiter.rule = loop_->add_rule(
+      category_id_,
+      fd_,
+      direction,
+      [&waiter] { wake( waiter ); },
+      [] { return true; }, // never asked: interest is explicit
+      [&waiter] {
+        waiter.gone = true;
+        if ( waiter.task ) {
+          Task::resume( exchange( waiter.task, {} ) );
+        }
+      } );
+  }
+
+  waiter.task = task;
+  waiter.rule->set_interest( true );
+}
+
+// Nothing of the waiter is touched once the coroutine runs: it may finish and destroy the AsyncFD.
+void AsyncFD::wake( Waiter& waiter )
+{
+  waiter.rule->set_interest( false );
+  if ( waiter.task ) {
+    Task::resume( exchange( waiter.task, {} ) );
+  }
+}
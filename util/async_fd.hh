@@ -0,0 +1,67 @@
+#pragma once
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "task.hh"
+
+#include <optional>
+
+// Lets a Task wait for a file descriptor: `co_await conn.readable()` and `co_await conn.writable()` suspend the
+// coroutine until the fd is ready, and the loop resumes it straight from the rule's callback.
+// 让协程等待文件描述符可读/可写，由EventLoop在规则回调中直接恢复
+//
+// Each direction gets one fd rule on first use, kept for the object's lifetime with its interest switched on
+// only while a coroutine waits (see EventLoop::RuleHandle::set_interest), so a wait adds no rule and allocates
+// nothing. Once a direction's rule is gone (EOF, hangup or error), waiting on it no longer suspends: the next
+// read or write reports what happened. One coroutine at a time may wait in each direction.
+class AsyncFD
+{
+  struct Waiter
+  {
+    std::optional<EventLoop::RuleHandle> rule {};
+    Task::Handle task {};
+    bool gone {}; // the rule was cancelled by the loop
+  };
+
+  EventLoop* loop_;
+  FileDescriptor fd_; // shares the caller's fd (and its EOF and counters)
+  size_t category_id_;
+  Waiter reader_ {};
+  Waiter writer_ {};
+
+  void wait( Waiter& waiter, Direction direction, Task::Handle task );
+  static void wake( Waiter& waiter );
+
+public:
+  //! Awaitable for AsyncFD::readable and AsyncFD::writable.
+  class Wait
+  {
+    AsyncFD* fd_;
+    Direction direction_;
+
+  public:
+    Wait( AsyncFD* fd, Direction direction ) : fd_( fd ), direction_( direction ) {}
+
+    bool await_ready() const;
+    void await_suspend( Task::Handle task ) const;
+    void await_resume() const {}
+  };
+
+  //! Rules go in `loop`'s task category (see EventLoop::task_category).
+  AsyncFD( EventLoop& loop, FileDescriptor& fd );
+  AsyncFD( EventLoop& loop, FileDescriptor& fd, size_t category_id );
+  ~AsyncFD(); // cancels the rules
+
+  // the rules' callbacks refer to the object
+  AsyncFD( const AsyncFD& other ) = delete;
+  AsyncFD& operator=( const AsyncFD& other ) = delete;
+  AsyncFD( AsyncFD&& other ) = delete;
+  AsyncFD& operator=( AsyncFD&& other ) = delete;
+
+  Wait readable() { return { this, Direction::In }; }
+  Wait writable() { return { this, Direction::Out }; }
+
+  //! Whether the direction's rule has been cancelled by the loop (EOF, hangup or error), so waiting on it no
+  //! longer suspends.
+  bool gone( Direction direction ) const { return direction == Direction::In ? reader_.gone : writer_.gone; }
+};
@@ -0,0 +1,113 @@
+#include "buffer_pool.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+PooledBuffer::PooledBuffer( Slab* slab ) : slab_( slab )
+{
+  ++slab_->refs;
+}
+
+PooledBuffer::PooledBuffer( const PooledBuffer& other ) : slab_( other.slab_ )
+{
+  if ( slab_ ) {
+    ++slab_->refs;
+  }
+}
+
+PooledBuffer& PooledBuffer::operator=( const PooledBuffer& other )
+{
+  Slab* const slab = other.slab_;
+  if ( slab ) {
+    ++slab->refs; // before release(), in case of self-assignment
+  }
+  release();
+  slab_ = slab;
+  return *this;
+}
+
+PooledBuffer::PooledBuffer( PooledBuffer&& other ) noexcept : slab_( exchange( other.slab_, nullptr ) ) {}
+
+PooledBuffer& PooledBuffer::operator=( PooledBuffer&& other ) noexcept
+{
+  if ( this != &other ) {
+    release();
+    slab_ = exchange( other.slab_, nullptr );
+  }
+  return *this;
+}
+
+void PooledBuffer::release()
+{
+  if ( not slab_ ) {
+    return;
+  }
+
+  Slab* const slab = exchange( slab_, nullptr );
+  if ( --slab->refs > 0 ) {
+    return;
+  }
+
+  if ( slab->pool ) {
+    slab->pool->recycle( slab );
+  } else {
+    delete slab; // orphaned by its pool's destructor
+  }
+}
+
+void PooledBuffer::resize( size_t new_size )
+{
+  if ( new_size > capacity() ) {
+    throw runtime_error( "PooledBuffer::resize() beyond capacity" );
+  }
+  if ( slab_ ) {
+    slab_->size = new_size;
+  }
+}
+
+BufferPool::BufferPool( size_t slab_size, size_t max_free ) : slab_size_( slab_size ), max_free_( max_free )
+{
+  if ( slab_size == 0 ) {
+    throw runtime_error( "BufferPool slab size must be positive" );
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  for ( auto* slab : all_ ) {
+    if ( slab->refs == 0 ) {
+      delete slab;
+    } else {
+      slab->pool = nullptr; // the last handle will free it
+    }
+  }
+}
+
+PooledBuffer BufferPool::acquire()
+{
+  if ( free_.empty() ) {
+    // make_unique_for_overwrite leaves the bytes uninitialized (no zero-fill)
+    all_.push_back(
+      new PooledBuffer::Slab { make_unique_for_overwrite<char[]>( slab_size_ ), slab_size_, 0, 0, this } );
+    free_.push_back( all_.back() );
+  }
+
+  auto* slab = free_.back();
+  free_.pop_back();
+  slab->size = 0;
+  return PooledBuffer { slab };
+}
+
+void BufferPool::recycle( PooledBuffer::Slab* slab )
+{
+  if ( free_.size() < max_free_ ) {
+    free_.push_back( slab );
+    return;
+  }
+
+  all_.erase( find( all_.begin(), all_.end(), slab ) );
+  delete slab;
+}
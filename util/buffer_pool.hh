@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class BufferPool;
+
+// A reference-counted handle to a fixed-capacity slab of bytes from a BufferPool.
+// 来自BufferPool的固定容量内存块的引用计数句柄
+// Copies share the slab; when the last handle is dropped, the slab goes back on its pool's freelist.
+// The count is not atomic: handles to one slab must stay on one thread.
+class PooledBuffer
+{
+  friend class BufferPool;
+
+  struct Slab
+  {
+    std::unique_ptr<char[]> bytes; // NOLINT(*-avoid-c-arrays)
+    size_t capacity;
+    size_t size = 0;
+    unsigned int refs = 0;
+    BufferPool* pool; // nullptr once the pool has been destroyed
+  };
+
+  Slab* slab_ = nullptr;
+
+  explicit PooledBuffer( Slab* slab );
+  void release();
+
+public:
+  PooledBuffer() = default; // empty, with no slab
+  ~PooledBuffer() { release(); }
+
+  PooledBuffer( const PooledBuffer& other );
+  PooledBuffer& operator=( const PooledBuffer& other );
+  PooledBuffer( PooledBuffer&& other ) noexcept;
+  PooledBuffer& operator=( PooledBuffer&& other ) noexcept;
+
+  // Bytes in use. Contents are not initialized: resize() only moves the end marker, up to capacity().
+  // 已使用的字节数（内容不会被清零）
+  size_t size() const { return slab_ ? slab_->size : 0; }
+  size_t capacity() const { return slab_ ? slab_->capacity : 0; }
+  bool empty() const { return size() == 0; }
+  void resize( size_t new_size );
+
+  char* data() { return slab_ ? slab_->bytes.get() : nullptr; }
+  const char* data() const { return slab_ ? slab_->bytes.get() : nullptr; }
+
+  std::string_view view() const { return { data(), size() }; }
+  operator std::string_view() const { return view(); } // NOLINT(*-explicit-*)
+
+  // number of handles sharing this slab (0 if empty)
+  unsigned int use_count() const { return slab_ ? slab_->refs : 0; }
+};
+
+// A freelist of equally sized slabs. acquire() only allocates when the freelist is empty, so a steady-state
+// read loop that drops each buffer before reading the next one does not touch the allocator.
+// 等大小内存块的空闲链表：只有空闲链表为空时才分配内存
+// Buffers may outlive the pool; their slabs are then freed instead of recycled.
+class BufferPool
+{
+  friend class PooledBuffer;
+
+  size_t slab_size_;
+  size_t max_free_;
+  std::vector<PooledBuffer::Slab*> all_ {};  // every slab this pool owns, in use or free
+  std::vector<PooledBuffer::Slab*> free_ {}; // slabs ready to be handed out
+
+  void recycle( PooledBuffer::Slab* slab );
+
+public:
+  // Slabs beyond `max_free` idle ones are freed when they come back, rather than kept.
+  explicit BufferPool( size_t slab_size, size_t max_free = 64 );
+  ~BufferPool();
+
+  BufferPool( const BufferPool& other ) = delete;
+  BufferPool& operator=( const BufferPool& other ) = delete;
+  BufferPool( BufferPool&& other ) = delete;
+  BufferPool& operator=( BufferPool&& other ) = delete;
+
+  // An empty (size 0) buffer with capacity slab_size().
+  PooledBuffer acquire();
+
+  size_t slab_size() const { return slab_size_; }
+  size_t allocated() const { return all_.size(); } // slabs in use or on the freelist
+  size_t available() const { return free_.size(); }
+};
@@ -0,0 +1,173 @@
+#include "core_runtime.hh"
+
+#include "exception.hh"
+
+#include <cerrno>
+#include <iostream>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+// the CPUs this process may run on
+static vector<int> allowed_cpus()
+{
+  cpu_set_t set;
+  CPU_ZERO( &set ); // NOLINT(*-isolate-declaration)
+  CheckSystemCall( "sched_getaffinity", sched_getaffinity( 0, sizeof( set ), &set ) );
+
+  vector<int> cpus;
+  for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+    if ( CPU_ISSET( cpu, &set ) ) { // NOLINT(*-bitwise)
+      cpus.push_back( cpu );
+    }
+  }
+  return cpus;
+}
+
+CoreRuntime::Worker::Worker( TCPSocket&& s_listener, int s_cpu )
+  : listener( move( s_listener ) )
+  , stop( CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
+  , cpu( s_cpu )
+{}
+
+CoreRuntime::CoreRuntime( const Address& address, HandlerT handler, size_t threads, EventLoop::Backend backend )
+  : handler_( move( handler ) ), backend_( backend )
+{
+  const vector<int> cpus = allowed_cpus();
+  if ( threads == 0 ) {
+    threads = cpus.size();
+  }
+
+  optional<Address> bound;
+  for ( size_t i = 0; i < threads; ++i ) {
+    TCPSocket listener;
+    listener.set_reuseaddr();
+    listener.set_reuseport();
+    listener.bind( bound.value_or( address ) );
+    listener.listen( 1024 );
+    listener.set_blocking( false );
+    if ( not bound ) {
+      bound = listener.local_address();
+    }
+
+    workers_.push_back( make_unique<Worker>( move( listener ), cpus.at( i % cpus.size() ) ) );
+  }
+}
+
+CoreRuntime::~CoreRuntime()
+{
+  try {
+    stop();
+    for ( auto& worker : workers_ ) {
+      if ( worker->thread.joinable() ) {
+        worker->thread.join();
+      }
+    }
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    cerr << "Exception destructing CoreRuntime: " << e.what() << "\n";
+  }
+}
+
+void CoreRuntime::run()
+{
+  for ( auto& worker : workers_ ) {
+    worker->thread = thread { [this, &worker = *worker] {
+      try {
+        run_worker( worker );
+      } catch ( ... ) {
+        {
+          const lock_guard lock { error_mutex_ };
+          if ( not error_ ) {
+            error_ = current_exception();
+          }
+        }
+        stop();
+      }
+    } };
+  }
+
+  for ( auto& worker : workers_ ) {
+    worker->thread.join();
+  }
+
+  if ( error_ ) {
+    rethrow_exception( error_ );
+  }
+}
+
+void CoreRuntime::stop()
+{
+  const uint64_t one = 1;
+  for ( const auto& worker : workers_ ) {
+    // nonblocking: fails only when the counter is already (nearly) full, which stops the worker just the same
+    if ( ::write( worker->stop.fd_num(), &one, sizeof( one ) ) < 0 and errno != EAGAIN ) {
+      throw unix_error { "write (eventfd)" };
+    }
+  }
+}
+
+Address CoreRuntime::address() const
+{
+  return workers_.at( 0 )->listener.local_address();
+}
+
+uint64_t CoreRuntime::connections( const size_t index ) const
+{
+  return workers_.at( index )->connections.load( memory_order_relaxed );
+}
+
+void CoreRuntime::run_worker( Worker& worker )
+{
+  cpu_set_t set;
+  CPU_ZERO( &set ); // NOLINT(*-isolate-declaration)
+  CPU_SET( worker.cpu, &set ); // NOLINT(*-bitwise)
+  if ( const int error = pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) ) {
+    throw unix_error { "pthread_setaffinity_np", error };
+  }
+
+  // the loop lives on this thread, along with every connection it accepts
+  EventLoop loop { backend_ };
+  bool stopping = false;
+
+  loop.add_rule(
+    "stop",
+    worker.stop,
+    Direction::In,
+    [&] {
+      string count;
+      worker.stop.read( count );
+      stopping = true;
+    },
+    [&] { return not stopping; } );
+
+  loop.add_rule(
+    "accept",
+    worker.listener,
+    Direction::In,
+    [&] {
+      // take everything queued: one wakeup may stand for many connections
+      optional<TCPSocket> connection;
+      while ( true ) {
+        const IOResult result = worker.listener.try_accept( connection );
+        if ( result.would_block() ) {
+          return;
+        }
+        if ( result.error() == ECONNABORTED or result.error() == EINTR ) {
+          continue;
+        }
+        result.throw_if_error( "accept" );
+
+        worker.connections.fetch_add( 1, memory_order_relaxed );
+        handler_( loop, move( *connection ) );
+        connection.reset();
+      }
+    },
+    [&] { return not stopping; } );
+
+  while ( loop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "socket.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A thread-per-core TCP server: one EventLoop per worker thread, each thread pinned to its own CPU and
+// accepting on its own listening socket.
+// 每核一线程的TCP服务器：每个工作线程拥有自己的EventLoop和监听套接字，并绑定到一个CPU上
+//
+// The listening sockets all bind the same address with SO_REUSEPORT, so the kernel shards incoming
+// connections across the workers. Each connection is handed to the handler on the thread that accepted it,
+// and lives on that thread's loop from then on: nothing is shared between workers.
+//
+// stop() (from any thread) makes every worker stop accepting; a worker's run ends once the connections on its
+// loop have finished, as with any EventLoop.
+class CoreRuntime
+{
+public:
+  //! Called on a worker's thread for each connection it accepts; adds whatever rules serve the connection to
+  //! that worker's loop. The socket is blocking, as returned by accept().
+  using HandlerT = std::function<void( EventLoop&, TCPSocket&& )>;
+
+private:
+  struct Worker
+  {
+    TCPSocket listener;
+    FileDescriptor stop; // eventfd, written by stop()
+    int cpu;
+    std::atomic<uint64_t> connections { 0 };
+    std::thread thread {};
+
+    Worker( TCPSocket&& s_listener, int s_cpu );
+  };
+
+  HandlerT handler_;
+  EventLoop::Backend backend_;
+  std::vector<std::unique_ptr<Worker>> workers_ {};
+
+  std::mutex error_mutex_ {};
+  std::exception_ptr error_ {}; // the first exception a worker died of
+
+  void run_worker( Worker& worker );
+
+public:
+  //! Binds `threads` listening sockets (0: one per CPU this process may run on) to `address`. With port 0, the
+  //! first gets an ephemeral port and the rest share it.
+  CoreRuntime( const Address& address,
+               HandlerT handler,
+               size_t threads = 0,
+               EventLoop::Backend backend = EventLoop::Backend::Epoll );
+
+  //! Stops and joins the workers, if running; an error is printed rather than thrown.
+  ~CoreRuntime();
+
+  CoreRuntime( const CoreRuntime& other ) = delete;
+  CoreRuntime& operator=( const CoreRuntime& other ) = delete;
+  CoreRuntime( CoreRuntime&& other ) = delete;
+  CoreRuntime& operator=( CoreRuntime&& other ) = delete;
+
+  //! Starts the workers and waits for all of them to finish. Rethrows the first exception a worker died of
+  //! (which stops the others).
+  //! 启动所有工作线程并等待它们结束
+  void run();
+
+  //! Stops accepting new connections; each worker finishes once its connections have. Safe from any thread.
+  void stop();
+
+  //! The address the listening sockets are bound to.
+  Address address() const;
+
+  size_t threads() const { return workers_.size(); }
+
+  //! Connections accepted so far by worker `index`.
+  uint64_t connections( size_t index ) const;
+};
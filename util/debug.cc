@@ -9,9 +9,10 @@ void default_debug_handler( void* /*unused*/, std::string_view message )
   cerr << "DEBUG: " << message << "\n";
 }
 
+// The handler is per-thread, so tests running in several threads each collect their own debug output.
 // NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
-static void ( *debug_handler )( void*, std::string_view ) = default_debug_handler;
-static void* debug_arg = nullptr;
+static thread_local void ( *debug_handler )( void*, std::string_view ) = default_debug_handler;
+static thread_local void* debug_arg = nullptr;
 // NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
 
 void debug_str( string_view message )
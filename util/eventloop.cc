@@ -1,15 +1,120 @@
 #include "eventloop.hh"
 #include "exception.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <span>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+// epoll(7) reports readiness with the same bits as poll(2), so rules' events and results are shared
+static_assert( EPOLLIN == POLLIN and EPOLLOUT == POLLOUT and EPOLLERR == POLLERR and EPOLLHUP == POLLHUP );
 
 using namespace std;
 
 unsigned int EventLoop::FDRule::service_count() const
 {
-  return direction == Direction::In ? fd.read_count() : fd.write_count();
+  return direction == Direction::Out ? fd.write_count() : fd.read_count();
+}
+
+EventLoop::EventLoop( Backend backend )
+  : _timers( timer_now() )
+  , _profiling( getenv( "MINNOW_LOOP_STATS" ) != nullptr )
+  , _post_wakeup( CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
+  , _post_wakeup_fd( _post_wakeup.fd_num() )
+{
+  _rule_categories.reserve( 64 );
+
+  if ( backend == Backend::IoUring and IoUring::supported() ) {
+    _uring = make_unique<IoUring>();
+  }
+
+  if ( backend == Backend::Epoll ) {
+    _epoll.emplace( CheckSystemCall( "epoll_create1", epoll_create1( EPOLL_CLOEXEC ) ) );
+    _epoll_events.resize( 256 );
+  }
+
+  // in its own category, outside the table, so that the user's categories are numbered from 0
+  _fd_rules
+    .emplace_back( BasicRule { kPostedCategory, [] { return true; }, [this] { run_posted(); } },
+                   _post_wakeup.duplicate(),
+                   Direction::In,
+                   [] {},
+                   [] {} )
+    ->internal = true;
+}
+
+void EventLoop::post( CallbackT closure )
+{
+  if ( _posted.push( move( closure ) ) ) {
+    wake();
+  }
+}
+
+void EventLoop::wake() const
+{
+  const uint64_t one = 1;
+  // nonblocking: fails only when the counter is already (nearly) full, which wakes the loop just the same
+  if ( ::write( _post_wakeup_fd, &one, sizeof( one ) ) < 0 and errno != EAGAIN ) {
+    throw unix_error { "write (eventfd)" };
+  }
+}
+
+void EventLoop::run_posted()
+{
+  _post_wakeup.read( _post_wakeup_buffer ); // first: a closure posted from now on wakes the loop again
+  try {
+    _posted.drain( []( const CallbackT& closure ) { closure(); } );
+  } catch ( ... ) {
+    wake(); // for the closures after the one that threw, which are still queued
+    throw;
+  }
+}
+
+EventLoop::KeepAlive::KeepAlive( EventLoop* loop ) : loop_( loop )
+{
+  loop_->_keep_alives.fetch_add( 1, memory_order_relaxed );
+}
+
+EventLoop::KeepAlive::KeepAlive( KeepAlive&& other ) noexcept : loop_( exchange( other.loop_, nullptr ) ) {}
+
+EventLoop::KeepAlive& EventLoop::KeepAlive::operator=( KeepAlive&& other ) noexcept
+{
+  if ( this != &other ) {
+    reset();
+    loop_ = exchange( other.loop_, nullptr );
+  }
+  return *this;
+}
+
+EventLoop::KeepAlive::~KeepAlive()
+{
+  reset();
+}
+
+void EventLoop::KeepAlive::reset()
+{
+  if ( not loop_ ) {
+    return;
+  }
+  // the last one wakes the loop, which may be waiting only for posts, to see that it can exit
+  EventLoop* const loop = exchange( loop_, nullptr );
+  if ( loop->_keep_alives.fetch_sub( 1, memory_order_acq_rel ) == 1 ) {
+    try {
+      loop->wake();
+    } catch ( const exception& e ) {
+      cerr << "Exception destructing KeepAlive: " << e.what() << "\n";
+    }
+  }
 }
 
 size_t EventLoop::add_category( const string& name )
@@ -41,71 +146,347 @@ EventLoop::FDRule::FDRule( BasicRule&& base,
 EventLoop::RuleHandle EventLoop::add_rule( size_t category_id,
                                            FileDescriptor& fd,
                                            Direction direction,
-                                           const CallbackT& callback,
-                                           const InterestT& interest,
-                                           const CallbackT& cancel, // NOLINT(*-easily-swappable-*)
-                                           const CallbackT& error )
+                                           CallbackT callback,
+                                           InterestT interest,
+                                           CallbackT cancel, // NOLINT(*-easily-swappable-*)
+                                           CallbackT error )
+{
+  if ( category_id >= _rule_categories.size() ) {
+    throw out_of_range( "bad category_id" );
+  }
+
+  const auto it = _fd_rules.emplace_back( BasicRule { category_id, move( interest ), move( callback ) },
+                                          fd.duplicate(),
+                                          direction,
+                                          move( cancel ),
+                                          move( error ) );
+
+  return { this, RuleKind::FD, _fd_rules.handle( it ) };
+}
+
+EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id, CallbackT callback, InterestT interest )
 {
   if ( category_id >= _rule_categories.size() ) {
     throw out_of_range( "bad category_id" );
   }
 
-  _fd_rules.emplace_back( make_shared<FDRule>(
-    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, error ) );
+  const auto it = _non_fd_rules.emplace_back( category_id, move( interest ), move( callback ) );
 
-  return RuleHandle { _fd_rules.back() };
+  return { this, RuleKind::NonFD, _non_fd_rules.handle( it ) };
 }
 
-EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
-                                           const CallbackT& callback,
-                                           const InterestT& interest )
+EventLoop::TimerRule::TimerRule( BasicRule&& base, uint64_t s_period ) : BasicRule( move( base ) ), period( s_period )
+{}
+
+EventLoop::RuleHandle EventLoop::add_timer( const size_t category_id,
+                                            const chrono::milliseconds delay,
+                                            CallbackT callback,
+                                            const chrono::milliseconds period )
 {
   if ( category_id >= _rule_categories.size() ) {
     throw out_of_range( "bad category_id" );
   }
+  if ( delay.count() < 0 or period.count() < 0 ) {
+    throw out_of_range( "negative timer delay or period" );
+  }
+
+  // round up to whole ticks: a timer never fires early
+  const auto ticks = [&]( const chrono::nanoseconds duration ) {
+    return static_cast<uint64_t>( ( duration + _timer_resolution - chrono::nanoseconds { 1 } ) / _timer_resolution );
+  };
+
+  const auto it
+    = _timer_rules.emplace_back( BasicRule { category_id, [] { return true; }, move( callback ) }, ticks( period ) );
+  it->position = it;
+  _timers.arm( *it, ticks( chrono::steady_clock::now().time_since_epoch() + delay ) );
 
-  _non_fd_rules.emplace_back( make_shared<BasicRule>( category_id, interest, callback ) );
+  return { this, RuleKind::Timer, _timer_rules.handle( it ) };
+}
 
-  return RuleHandle { _non_fd_rules.back() };
+void EventLoop::set_timer_resolution( const chrono::milliseconds resolution )
+{
+  if ( resolution.count() <= 0 ) {
+    throw out_of_range( "timer resolution must be positive" );
+  }
+  if ( _timers.size() ) {
+    throw runtime_error( "EventLoop: can't change the timer resolution with timers armed" );
+  }
+  _timer_resolution = resolution;
+  _timers = TimerWheel { timer_now() };
+}
+
+uint64_t EventLoop::timer_now() const
+{
+  return chrono::steady_clock::now().time_since_epoch() / _timer_resolution;
+}
+
+int EventLoop::timer_timeout( const int timeout_ms ) const
+{
+  const auto wakeup = _timers.next_wakeup();
+  if ( not wakeup ) {
+    return timeout_ms;
+  }
+
+  const chrono::steady_clock::time_point due { *wakeup * _timer_resolution };
+  const auto until = max( chrono::ceil<chrono::milliseconds>( due - chrono::steady_clock::now() ).count(),
+                          chrono::milliseconds::rep { 0 } );
+  return timeout_ms < 0 ? static_cast<int>( min<chrono::milliseconds::rep>( until, INT_MAX ) )
+                        : static_cast<int>( min<chrono::milliseconds::rep>( until, timeout_ms ) );
+}
+
+size_t EventLoop::fire_timers()
+{
+  if ( not _timers.size() ) {
+    return 0;
+  }
+
+  _expired_timers.clear();
+  _timers.advance( timer_now(), _expired_timers );
+
+  size_t fired = 0;
+  for ( TimerWheel::Timer* const timer : _expired_timers ) {
+    // a timer cancelled while it fires (by its own callback, or an earlier one in the batch) stays until here
+    auto& rule = static_cast<TimerRule&>( *timer );
+    if ( not rule.cancel_requested ) {
+      call( rule );
+      ++fired;
+    }
+
+    if ( rule.period and not rule.cancel_requested ) {
+      // keep to the original schedule, unless whole periods were missed
+      const uint64_t next = rule.deadline() + rule.period;
+      _timers.arm( rule, next > _timers.now() ? next : _timers.now() + rule.period );
+    } else {
+      _timer_rules.erase( rule.position );
+    }
+  }
+  _expired_timers.clear();
+
+  return fired;
+}
+
+void EventLoop::cancel_timer( TimerRule& rule )
+{
+  rule.cancel_requested = true;
+  // a timer that isn't armed is being fired right now; fire_timers() drops it when done
+  if ( rule.armed() ) {
+    _timers.cancel( rule );
+    _timer_rules.erase( rule.position );
+  }
+}
+
+void EventLoop::cancel_rule( const RuleKind kind, const SlabHandle handle )
+{
+  switch ( kind ) {
+    case RuleKind::FD:
+      if ( auto* const rule = _fd_rules.find( handle ) ) {
+        rule->cancel_requested = true;
+        if ( _epoll and rule->explicit_interest and not exchange( rule->rescan_queued, true ) ) {
+          _fd_rules_to_rescan.push_back( handle ); // not in the scan: erased when rescanned
+        }
+      }
+      break;
+    case RuleKind::NonFD:
+      if ( auto* const rule = _non_fd_rules.find( handle ) ) {
+        rule->cancel_requested = true;
+      }
+      break;
+    case RuleKind::Timer:
+      if ( auto* const rule = _timer_rules.find( handle ) ) {
+        cancel_timer( *rule );
+      }
+      break;
+  }
 }
 
 void EventLoop::RuleHandle::cancel()
 {
-  const shared_ptr<BasicRule> rule_shared_ptr = rule_weak_ptr_.lock();
-  if ( rule_shared_ptr ) {
-    rule_shared_ptr->cancel_requested = true;
+  loop_->cancel_rule( kind_, rule_ );
+}
+
+void EventLoop::set_rule_interest( const RuleKind kind, const SlabHandle handle, const bool interested )
+{
+  switch ( kind ) {
+    case RuleKind::NonFD:
+      if ( auto* const rule = _non_fd_rules.find( handle ) ) {
+        rule->explicit_interest = true;
+        rule->interested = interested;
+      }
+      break;
+
+    case RuleKind::FD: {
+      const auto it = _fd_rules.locate( handle );
+      if ( it == _fd_rules.end() ) {
+        break;
+      }
+      if ( not it->explicit_interest ) {
+        it->explicit_interest = true;
+        it->interested = false;
+        if ( _epoll ) {
+          _fd_rules.detach( it ); // from now on, it's only looked at when queued
+        }
+      }
+      if ( it->interested != interested ) {
+        it->interested = interested;
+        _explicit_interested_fd_rules += interested ? 1 : -1;
+      }
+      if ( _epoll and not exchange( it->rescan_queued, true ) ) {
+        _fd_rules_to_rescan.push_back( handle );
+      }
+      break;
+    }
+
+    case RuleKind::Timer:
+      throw runtime_error( "EventLoop: set_interest is not for timers" );
   }
 }
 
+void EventLoop::RuleHandle::set_interest( const bool interested )
+{
+  loop_->set_rule_interest( kind_, rule_, interested );
+}
+
+void EventLoop::queue_rescan( const int fd )
+{
+  const auto found = _epoll_fds.find( fd );
+  if ( found == _epoll_fds.end() ) {
+    return;
+  }
+  for ( const auto& rule : found->second.rules ) {
+    if ( rule->explicit_interest and not exchange( rule->rescan_queued, true ) ) {
+      _fd_rules_to_rescan.push_back( _fd_rules.handle( rule ) );
+    }
+  }
+}
+
+void EventLoop::rescan_explicit_rules()
+{
+  // by index: a cancel callback may queue more
+  for ( size_t i = 0; i < _fd_rules_to_rescan.size(); ++i ) {
+    auto it = _fd_rules.locate( _fd_rules_to_rescan[i] );
+    if ( it == _fd_rules.end() ) {
+      continue; // erased since
+    }
+    it->rescan_queued = false;
+    count_scanned( *it );
+    if ( not retire_if_finished( it ) ) {
+      epoll_track( it, wanted_events( *it ) );
+    }
+  }
+  _fd_rules_to_rescan.clear();
+}
+
+// POLLERR is always reported; asking for it is how an ErrorQueue rule marks itself interested.
+// An uninterested rule asks for nothing, but its fd is still polled -- we still want errors.
+int16_t EventLoop::wanted_events( const FDRule& rule )
+{
+  if ( not rule.wants_service() ) {
+    return 0;
+  }
+  return rule.direction == Direction::In ? POLLIN : rule.direction == Direction::Out ? POLLOUT : POLLERR;
+}
+
+bool EventLoop::retire_if_finished( FDRuleIterator& it )
+{
+  auto& rule = *it;
+
+  if ( rule.cancel_requested ) {
+    //      rule.cancel();
+    //      if rule is cancelled externally, no need to call the cancellation callback
+    //      this makes it easier to cancel rules and delete captured objects right away
+    it = erase_fd_rule( it );
+    return true;
+  }
+
+  // no more reading on this rule once it has reached eof, and nothing more at all once its fd is closed
+  if ( ( rule.direction == Direction::In and rule.fd.eof() ) or rule.fd.closed() ) {
+    rule.cancel();
+    it = erase_fd_rule( it );
+    return true;
+  }
+
+  return false;
+}
+
+size_t EventLoop::task_category()
+{
+  if ( not _task_category ) {
+    _task_category = add_category( "tasks" );
+  }
+  return *_task_category;
+}
+
+void EventLoop::spawn( Task task )
+{
+  move( task ).start( _tasks );
+}
+
+void EventLoop::Sleep::await_suspend( const Task::Handle task ) const
+{
+  loop_->add_timer( loop_->task_category(), delay_, [task] { Task::resume( task ); } );
+}
+
 // NOLINTBEGIN(*-cognitive-complexity)
 // NOLINTBEGIN(*-signed-bitwise)
 EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 {
-  // first, handle the non-file-descriptor-related rules
-  {
+  ++_call_count;
+  const IterationTimer iteration_timer { this };
+  const bool all_ready = _dispatch == Dispatch::AllReady;
+  if ( all_ready ) {
+    for_each_category( []( RuleCategory& category ) { category.served = 0; } );
+    _served_fd_rules.clear();
+    _served_non_fd_rules.clear();
+    _bulk_served = 0;
+  }
+  bool served_any = false;
+
+  // timers that have come due go first, all together
+  if ( fire_timers() ) {
+    if ( not all_ready ) {
+      return Result::Success;
+    }
+    served_any = true;
+  }
+
+  // then the non-file-descriptor-related rules: High ones first, if there are any
+  for ( const bool high_pass : { true, false } ) {
+    if ( high_pass and not _high_categories ) {
+      continue;
+    }
     for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
-      auto& this_rule = **it;
+      auto& this_rule = *it;
       bool rule_fired = false;
 
       if ( this_rule.cancel_requested ) {
         it = _non_fd_rules.erase( it );
         continue;
       }
+      if ( _high_categories
+           and high_pass != ( category_of( this_rule.category_id ).priority == Priority::High ) ) {
+        ++it;
+        continue;
+      }
+      count_scanned( this_rule );
 
       uint8_t iterations = 0;
-      while ( this_rule.interest() ) {
+      while ( within_budget( this_rule.category_id ) and this_rule.wants_service() ) {
         if ( iterations++ >= 128 ) {
           throw runtime_error( "EventLoop: busy wait detected: rule \""
-                               + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
+                               + category_of( this_rule.category_id ).name + "\" is still interested after "
                                + to_string( iterations ) + " iterations" );
         }
 
         rule_fired = true;
-        this_rule.callback();
+        call( this_rule );
+        count_served( it, _served_non_fd_rules );
       }
 
       if ( rule_fired ) {
-        return Result::Success; /* only serve one rule on each iteration */
+        if ( not all_ready ) {
+          return Result::Success; /* only serve one rule on each iteration */
+        }
+        served_any = true;
       }
 
       ++it;
@@ -113,115 +494,712 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
   }
 
   // now the file-descriptor-related rules. poll any "interested" file descriptors
-  vector<pollfd> pollfds {};
-  pollfds.reserve( _fd_rules.size() );
+  auto& pollfds = _pollfds;
+  pollfds.clear();
   bool something_to_poll = false;
+  auto& error_queue_fds = _error_queue_fds;
+  error_queue_fds.clear();
+
+  // rules with explicit interest aren't in the scan below (epoll backend): check the ones that changed
+  if ( _epoll ) {
+    rescan_explicit_rules();
+    something_to_poll = _explicit_interested_fd_rules > 0;
+  }
 
   // set up the pollfd for each rule
   for ( auto it = _fd_rules.begin(); it != _fd_rules.end(); ) { // NOTE: it gets erased or incremented in loop body
-    auto& this_rule = **it;
-
-    if ( this_rule.cancel_requested ) {
-      //      this_rule.cancel();
-      //      if rule is cancelled externally, no need to call the cancellation callback
-      //      this makes it easier to cancel rules and delete captured objects right away
-      it = _fd_rules.erase( it );
+    if ( retire_if_finished( it ) ) {
       continue;
     }
+    auto& this_rule = *it;
+    count_scanned( this_rule );
 
-    if ( this_rule.direction == Direction::In && this_rule.fd.eof() ) {
-      // no more reading on this rule, it's reached eof
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
-      continue;
+    if ( this_rule.direction == Direction::ErrorQueue and not _epoll ) {
+      error_queue_fds.push_back( this_rule.fd.fd_num() );
+    }
+
+    const int16_t events = wanted_events( this_rule );
+    something_to_poll |= events != 0 and not this_rule.internal;
+
+    if ( _epoll ) {
+      epoll_track( it, events );
+    } else {
+      pollfds.push_back( { this_rule.fd.fd_num(), events, 0 } );
+    }
+    ++it;
+  }
+
+  // quit if there is nothing left to poll or wait for (posts are only waited for when expected)
+  if ( not something_to_poll and _keep_alives.load( memory_order_acquire ) == 0 and _posted.empty() ) {
+    rotate_served();
+    if ( served_any ) {
+      return Result::Success;
+    }
+    if ( not _timers.size() ) {
+      return Result::Exit;
+    }
+    // only timers: sleep until the next one
+    {
+      const BlockedTimer blocked { this };
+      if ( ::poll( nullptr, 0, timer_timeout( timeout_ms ) ) < 0 and errno != EINTR ) {
+        throw unix_error( "poll" );
+      }
+    }
+    return fire_timers() ? Result::Success : Result::Timeout;
+  }
+
+  // with work already done this call, only collect what is ready now; otherwise, wake up for the next timer
+  const int fd_timeout_ms = served_any ? 0 : timer_timeout( timeout_ms );
+
+  // wait until one of the fds satisfies one of the rules (writeable/readable), and gather the rules with events
+  _ready_rules.clear();
+  if ( _epoll ) {
+    if ( not wait_epoll( fd_timeout_ms ) ) {
+      rotate_served();
+      served_any |= fire_timers() > 0;
+      return served_any ? Result::Success : Result::Timeout;
+    }
+  } else {
+    if ( 0 == wait_for_fds( pollfds, fd_timeout_ms ) ) {
+      rotate_served();
+      served_any |= fire_timers() > 0;
+      return served_any ? Result::Success : Result::Timeout;
+    }
+
+    // (only as far as the rules that were polled: callbacks may add more)
+    auto it = _fd_rules.begin();
+    for ( const auto& this_pollfd : pollfds ) {
+      if ( this_pollfd.revents ) {
+        const bool has_error_queue_rule
+          = ranges::find( error_queue_fds, it->fd.fd_num() ) != error_queue_fds.end();
+        _ready_rules.push_back( { it, this_pollfd.events, this_pollfd.revents, has_error_queue_rule } );
+      }
+      ++it;
     }
+  }
+
+  served_any |= dispatch_ready_rules();
+  rotate_served();
+  if ( _epoll ) {
+    served_any |= fire_timers() > 0;
+    return served_any ? Result::Success : Result::Timeout;
+  }
+  return Result::Success;
+}
+
+void EventLoop::set_category_priority( const size_t category_id, const Priority priority, const unsigned int weight )
+{
+  if ( weight == 0 ) {
+    throw out_of_range( "category weight must be positive" );
+  }
+  auto& category = _rule_categories.at( category_id );
+  _high_categories -= category.priority == Priority::High;
+  _high_categories += priority == Priority::High;
+  category.priority = priority;
+  category.weight = weight;
 
-    if ( this_rule.fd.closed() ) {
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
+  update_bulk_weighted();
+}
+
+void EventLoop::set_bulk_budget( const unsigned int callbacks )
+{
+  _bulk_budget = callbacks;
+  update_bulk_weighted();
+}
+
+void EventLoop::update_bulk_weighted()
+{
+  _bulk_weighted = _bulk_budget > 0 or ranges::any_of( _rule_categories, []( const RuleCategory& c ) {
+                     return c.priority == Priority::Bulk and c.weight != 1;
+                   } );
+}
+
+// Weighted fair order for Bulk rules: each rule gets a tag, its category's virtual time advanced by one callback's
+// worth (1/weight) for each of the category's rules ahead of it (those that have waited longer), and rules are
+// served by tag. A category's time starts no earlier than that of the latest Bulk rule served, so one that was
+// idle can't claim a backlog of turns; one whose rules were left over by the budget keeps its early tags and goes
+// first next time.
+bool EventLoop::order_ready_rules()
+{
+  constexpr uint64_t kWeightScale = 1 << 20;
+
+  bool any_budget = false;
+  bool any_high = false;
+  for ( const auto& ready : _ready_rules ) {
+    const auto& category = category_of( ready.rule->category_id );
+    any_budget |= category.budget > 0;
+    any_high |= category.priority == Priority::High;
+  }
+
+  const bool all_ready = _dispatch == Dispatch::AllReady;
+  const bool weighted = all_ready and _bulk_weighted;
+  // epoll reports ready fds in the same order call after call, so to share out budgets, serve the rules that
+  // have waited longest first
+  const bool by_wait = all_ready and any_budget;
+  if ( not any_high and not weighted and not by_wait ) {
+    return false; // in the order gathered
+  }
+
+  if ( weighted or by_wait ) {
+    ranges::stable_sort( _ready_rules, {}, []( const ReadyRule& ready ) { return ready.rule->served_call; } );
+  }
+  if ( weighted ) {
+    for_each_category( []( RuleCategory& category ) { category.round_ready = 0; } );
+  }
+  for ( auto& ready : _ready_rules ) {
+    auto& category = category_of( ready.rule->category_id );
+    ready.high = category.priority == Priority::High;
+    ready.order = weighted and not ready.high ? max( category.virtual_time, _bulk_virtual_time )
+                                                  + ++category.round_ready * ( kWeightScale / category.weight )
+                                              : 0;
+  }
+
+  ranges::stable_sort(
+    _ready_rules, {}, []( const ReadyRule& ready ) { return pair { not ready.high, ready.order }; } );
+  return weighted;
+}
+
+bool EventLoop::dispatch_ready_rules()
+{
+  const bool weighted = order_ready_rules();
+
+  _socket_errors.clear();
+  bool served_any = false;
+  for ( size_t i = 0; i < _ready_rules.size(); ++i ) {
+    const auto& ready = _ready_rules[i];
+    auto it = ready.rule; // (moved on if the rule is erased)
+    // (with epoll, what the rule asks for now: an earlier callback may have changed its interest)
+    const int16_t events = _epoll ? it->epoll_events : ready.events;
+    if ( handle_poll_result( it, events, ready.revents, ready.has_error_queue_rule ) != PollOutcome::Served ) {
       continue;
     }
+    served_any = true;
+
+    auto& rule = *ready.rule;
+    if ( rule.deferred_call ) {
+      auto& stats = _priority_stats[static_cast<size_t>( category_of( rule.category_id ).priority )];
+      stats.max_wait = max( stats.max_wait, _call_count - exchange( rule.deferred_call, 0 ) );
+    }
+    if ( weighted and not ready.high ) {
+      category_of( rule.category_id ).virtual_time = ready.order;
+      _bulk_virtual_time = ready.order;
+    }
+    if ( _epoll ) {
+      queue_rescan( rule.fd.fd_num() ); // the callback may have read to EOF or closed the fd
+    }
+
+    if ( _dispatch == Dispatch::OneRule ) {
+      // only serve one rule on each iteration: the rest wait for the next
+      for ( size_t j = i + 1; j < _ready_rules.size(); ++j ) {
+        if ( _ready_rules[j].revents & _ready_rules[j].events and not _ready_rules[j].rule->cancel_requested ) {
+          defer( *_ready_rules[j].rule );
+        }
+      }
+      return true;
+    }
+    count_served( ready.rule, _served_fd_rules );
+  }
+
+  return served_any;
+}
+
+void EventLoop::defer( FDRule& rule )
+{
+  ++_priority_stats[static_cast<size_t>( category_of( rule.category_id ).priority )].deferred;
+  if ( not rule.deferred_call ) {
+    rule.deferred_call = _call_count;
+  }
+}
+
+void EventLoop::set_category_budget( const size_t category_id, const unsigned int callbacks )
+{
+  _rule_categories.at( category_id ).budget = callbacks;
+}
+
+bool EventLoop::within_budget( const size_t category_id ) const
+{
+  const auto& category = category_of( category_id );
+  return _dispatch == Dispatch::OneRule
+         or ( ( category.budget == 0 or category.served < category.budget )
+              and ( category.priority == Priority::High or _bulk_budget == 0 or _bulk_served < _bulk_budget ) );
+}
+
+template<class Iterator>
+void EventLoop::count_served( const Iterator& it, vector<Iterator>& served )
+{
+  auto& category = category_of( it->category_id );
+  ++category.served;
+  _bulk_served += category.priority == Priority::Bulk;
+  if ( category.budget and ( served.empty() or served.back() != it ) ) {
+    served.push_back( it );
+  }
+}
+
+void EventLoop::rotate_served()
+{
+  const auto exhausted = [&]( const auto& rule ) {
+    const auto& category = category_of( rule->category_id );
+    return category.served >= category.budget;
+  };
+
+  // moving keeps iterators valid, including those held by the epoll registrations
+  for ( const auto& it : _served_fd_rules ) {
+    if ( exhausted( it ) ) {
+      _fd_rules.move_to_back( it );
+    }
+  }
+  for ( const auto& it : _served_non_fd_rules ) {
+    if ( exhausted( it ) ) {
+      _non_fd_rules.move_to_back( it );
+    }
+  }
+}
+
+EventLoop::PollOutcome EventLoop::handle_poll_result( FDRuleIterator& it,
+                                                      const int16_t events,
+                                                      const int16_t revents,
+                                                      const bool has_error_queue_rule )
+{
+  auto& this_rule = *it;
+
+  if ( this_rule.cancel_requested ) {
+    return PollOutcome::Idle; // cancelled by a callback earlier in this call (Dispatch::AllReady): erased later
+  }
+
+  if ( this_rule.fd.closed() ) {
+    // closed by a callback earlier in this call (Dispatch::AllReady)
+    this_rule.cancel();
+    it = erase_fd_rule( it );
+    return PollOutcome::Cancelled;
+  }
+
+  const auto poll_error = static_cast<bool>( revents & ( POLLERR | POLLNVAL ) );
+  const auto error_queue_only = [&] {
+    return not( revents & POLLNVAL ) and has_error_queue_rule and socket_error( this_rule ) == 0;
+  };
+  if ( poll_error and not error_queue_only() ) {
+    // see if fd is a socket, and report its error
+    socket_error( this_rule );
+
+    this_rule.error();
+    this_rule.cancel();
+    it = erase_fd_rule( it );
+    return PollOutcome::Cancelled;
+  }
+
+  const auto poll_ready = static_cast<bool>( revents & events );
+  const auto poll_hup = static_cast<bool>( revents & POLLHUP );
+  if ( poll_hup && ( ( events && !poll_ready ) or ( this_rule.direction == Direction::Out ) ) ) {
+    // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
+    //   - if it was POLLIN and nothing is readable, no more will ever be readable
+    //   - if it was POLLOUT, it will not be writable again
+    // additionally, consider FD defunct if rule will only query for Direction::Out
+    this_rule.cancel();
+    it = erase_fd_rule( it );
+    return PollOutcome::Cancelled;
+  }
+
+  if ( not poll_ready ) {
+    return PollOutcome::Idle;
+  }
 
-    if ( this_rule.interest() ) {
-      pollfds.push_back( { this_rule.fd.fd_num(),
-                           static_cast<int16_t>( this_rule.direction == Direction::In ? POLLIN : POLLOUT ),
-                           0 } );
-      something_to_poll = true;
+  if ( not within_budget( this_rule.category_id ) ) {
+    defer( this_rule );
+    return PollOutcome::Idle;
+  }
+  this_rule.served_call = _call_count;
+
+  // we only want to call callback if revents includes the event we asked for
+  const auto count_before = this_rule.service_count();
+  call( this_rule );
+
+  if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.wants_service() ) {
+    throw runtime_error( "EventLoop: busy wait detected: rule \""
+                         + category_of( this_rule.category_id ).name
+                         + "\" did not read/write fd and is still interested" );
+  }
+
+  return PollOutcome::Served;
+}
+
+int EventLoop::socket_error( const FDRule& rule )
+{
+  const int fd = rule.fd.fd_num();
+  for ( const auto& [error_fd, error] : _socket_errors ) {
+    if ( error_fd == fd ) {
+      return error;
+    }
+  }
+
+  int error = 0;
+  socklen_t optlen = sizeof( error );
+  const int ret = getsockopt( fd, SOL_SOCKET, SO_ERROR, &error, &optlen );
+  if ( ret == -1 and errno == ENOTSOCK ) {
+    cerr << "error on polled file descriptor for rule \"" << category_of( rule.category_id ).name
+         << "\"\n";
+    error = -1;
+  } else if ( ret == -1 ) {
+    throw unix_error( "getsockopt" );
+  } else if ( optlen != sizeof( error ) ) {
+    throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
+  } else if ( error ) {
+    cerr << "error on polled socket for rule \"" << category_of( rule.category_id ).name
+         << "\": " << strerror( error ) << "\n";
+  }
+  _socket_errors.emplace_back( fd, error );
+  return error;
+}
+// NOLINTEND(*-signed-bitwise)
+// NOLINTEND(*-cognitive-complexity)
+
+EventLoop::FDRuleIterator EventLoop::erase_fd_rule( FDRuleIterator it )
+{
+  auto& rule = *it;
+  if ( rule.explicit_interest and rule.interested ) {
+    --_explicit_interested_fd_rules;
+  }
+
+  if ( rule.poll_token ) {
+    _uring->prepare_poll_remove( rule.poll_token, 0 ); // submitted with the next wait
+  }
+
+  if ( rule.epoll_registered ) {
+    const int fd = rule.fd.fd_num();
+    auto& registration = _epoll_fds.at( fd );
+    erase( registration.rules, it );
+    if ( not registration.rules.empty() ) {
+      if ( not exchange( registration.dirty, true ) ) {
+        _epoll_dirty.push_back( fd );
+      }
     } else {
-      pollfds.push_back( { this_rule.fd.fd_num(), 0, 0 } ); // placeholder --- we still want errors
+      // A closed fd has already left the epoll set (and its number may belong to someone else by now).
+      if ( registration.added and not rule.fd.closed() ) {
+        epoll_ctl( _epoll->fd_num(), EPOLL_CTL_DEL, fd, nullptr );
+      }
+      _epoll_fds.erase( fd );
     }
-    ++it;
   }
 
-  // quit if there is nothing left to poll
-  if ( not something_to_poll ) {
-    return Result::Exit;
+  return _fd_rules.erase( it );
+}
+
+void EventLoop::epoll_track( const FDRuleIterator& it, const int16_t events )
+{
+  auto& rule = *it;
+  if ( rule.epoll_registered and rule.epoll_events == events ) {
+    return;
   }
 
-  // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
-    return Result::Timeout;
+  const int fd = rule.fd.fd_num();
+  auto& registration = _epoll_fds[fd];
+  if ( not rule.epoll_registered ) {
+    registration.rules.push_back( it );
+    rule.epoll_registered = true;
+  }
+  rule.epoll_events = events;
+  if ( not exchange( registration.dirty, true ) ) {
+    _epoll_dirty.push_back( fd );
   }
+}
 
-  // go through the poll results
-  for ( auto [it, idx] = make_pair( _fd_rules.begin(), static_cast<size_t>( 0 ) ); it != _fd_rules.end(); ++idx ) {
-    const auto& this_pollfd = pollfds.at( idx );
-    auto& this_rule = **it;
+// An fd is registered with the union of the events its rules ask for. Like poll(2), epoll(7) always reports
+// EPOLLERR and EPOLLHUP, so an fd whose rules are all uninterested stays registered (with no events) to catch
+// errors. Registrations are level-triggered, so nothing is lost between calls.
+void EventLoop::epoll_update()
+{
+  for ( const int fd : _epoll_dirty ) {
+    const auto found = _epoll_fds.find( fd );
+    if ( found == _epoll_fds.end() ) {
+      continue; // every rule on it has gone
+    }
+    auto& registration = found->second;
+    registration.dirty = false;
 
-    const auto poll_error = static_cast<bool>( this_pollfd.revents & ( POLLERR | POLLNVAL ) );
-    if ( poll_error ) {
-      /* see if fd is a socket */
-      int socket_error = 0;
-      socklen_t optlen = sizeof( socket_error );
-      const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
-      if ( ret == -1 and errno == ENOTSOCK ) {
-        cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\"\n";
-      } else if ( ret == -1 ) {
-        throw unix_error( "getsockopt" );
-      } else if ( optlen != sizeof( socket_error ) ) {
-        throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
-      } else if ( socket_error ) {
-        cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\": " << strerror( socket_error ) << "\n";
+    uint32_t events = 0;
+    for ( const auto& rule : registration.rules ) {
+      events |= static_cast<uint16_t>( rule->epoll_events );
+    }
+    if ( registration.added and events == registration.events ) {
+      continue;
+    }
+
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd;
+    int op = registration.added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if ( epoll_ctl( _epoll->fd_num(), op, fd, &event ) < 0 ) {
+      // The fd number was closed and reused (MOD: ENOENT), or is already in the set under that number (ADD:
+      // EEXIST); either way, the other operation applies.
+      if ( errno != ( op == EPOLL_CTL_MOD ? ENOENT : EEXIST ) ) {
+        throw unix_error( "epoll_ctl" );
       }
+      op = op == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+      CheckSystemCall( "epoll_ctl", epoll_ctl( _epoll->fd_num(), op, fd, &event ) );
+    }
+    registration.added = true;
+    registration.events = events;
+  }
+  _epoll_dirty.clear();
+}
+
+// Only the rules on fds that epoll_wait(2) reported are gathered, in the order reported.
+bool EventLoop::wait_epoll( const int timeout_ms )
+{
+  epoll_update();
+
+  int ready = 0;
+  {
+    const BlockedTimer blocked { this };
+    ready = epoll_wait( _epoll->fd_num(), _epoll_events.data(), static_cast<int>( _epoll_events.size() ), timeout_ms );
+  }
+  if ( ready < 0 and errno != EINTR ) {
+    throw unix_error( "epoll_wait" );
+  }
+  if ( ready <= 0 ) {
+    return false; // a signal (see EventLoop::dump_stats_on_signal) counts as a timeout
+  }
 
-      this_rule.error();
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
+  // gather first: handling a rule can erase it (and with the last rule, the fd's registration)
+  for ( const auto& event : span( _epoll_events ).first( ready ) ) {
+    const auto found = _epoll_fds.find( event.data.fd );
+    if ( found == _epoll_fds.end() ) {
       continue;
     }
+    const auto& rules = found->second.rules;
+    const bool has_error_queue_rule = ranges::any_of(
+      rules, []( const FDRuleIterator& rule ) { return rule->direction == Direction::ErrorQueue; } );
+    for ( const auto& rule : rules ) {
+      _ready_rules.push_back( { rule, rule->epoll_events, static_cast<int16_t>( event.events ), has_error_queue_rule } );
+    }
+  }
+
+  return true;
+}
 
-    const auto poll_ready = static_cast<bool>( this_pollfd.revents & this_pollfd.events );
-    const auto poll_hup = static_cast<bool>( this_pollfd.revents & POLLHUP );
-    if ( poll_hup && ( ( this_pollfd.events && !poll_ready ) or ( this_rule.direction == Direction::Out ) ) ) {
-      // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
-      //   - if it was POLLIN and nothing is readable, no more will ever be readable
-      //   - if it was POLLOUT, it will not be writable again
-      // additionally, consider FD defunct if rule will only query for Direction::Out
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
+size_t EventLoop::wait_for_fds( vector<pollfd>& pollfds, const int timeout_ms )
+{
+  const BlockedTimer blocked { this };
+  if ( _uring ) {
+    return wait_for_fds_uring( pollfds, timeout_ms );
+  }
+  const int ready = ::poll( pollfds.data(), pollfds.size(), timeout_ms );
+  if ( ready < 0 and errno != EINTR ) {
+    throw unix_error( "poll" );
+  }
+  return max( ready, 0 ); // a signal (see EventLoop::dump_stats_on_signal) counts as a timeout
+}
+
+// Each fd rule keeps one one-shot poll request outstanding. A request is only (re)submitted when the rule has
+// none (it completed, or the rule is new) or wants different events, so an idle rule costs nothing per call.
+// Readiness is level-triggered as with poll(2): a request submitted for an fd that is already ready completes
+// straight away.
+//
+// A request's token is the rule's slot index (plus one) in the high half and a serial number in the low half,
+// so a completion finds its rule directly, and one for a request since withdrawn doesn't match the token the
+// rule (or the slot's next rule) holds now.
+size_t EventLoop::wait_for_fds_uring( vector<pollfd>& pollfds, const int timeout_ms )
+{
+  auto pfd = pollfds.begin();
+  for ( auto it = _fd_rules.begin(); it != _fd_rules.end(); ++it ) {
+    auto& rule = *it;
+    const auto events = ( pfd++ )->events;
+    if ( rule.poll_token and rule.poll_events == events ) {
       continue;
     }
+    if ( rule.poll_token ) {
+      _uring->prepare_poll_remove( rule.poll_token, 0 );
+    }
+    rule.poll_token = ( uint64_t { it.index() } + 1 ) << 32U | _poll_serial++;
+    rule.poll_events = events;
+    _uring->prepare_poll_add( rule.fd, static_cast<uint16_t>( events ), rule.poll_token );
+  }
 
-    if ( poll_ready ) {
-      // we only want to call callback if revents includes the event we asked for
-      const auto count_before = this_rule.service_count();
-      this_rule.callback();
+  _uring->submit( 1, timeout_ms );
 
-      if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
-        throw runtime_error( "EventLoop: busy wait detected: rule \""
-                             + _rule_categories.at( this_rule.category_id ).name
-                             + "\" did not read/write fd and is still interested" );
-      }
+  while ( const auto completion = _uring->next_completion() ) {
+    const uint64_t token = completion->user_data;
+    FDRule* const found = token >> 32U ? _fd_rules.at_index( static_cast<uint32_t>( ( token >> 32U ) - 1 ) ) : nullptr;
+    if ( not found or found->poll_token != token ) {
+      continue; // a withdrawn request (-ECANCELED), or a poll_remove
+    }
+    auto& rule = *found;
+    rule.poll_token = 0;
+    rule.revents = static_cast<int16_t>( completion->result >= 0            ? completion->result
+                                         : completion->result == -EBADF ? POLLNVAL
+                                                                        : POLLERR );
+  }
+
+  size_t ready = 0;
+  pfd = pollfds.begin();
+  for ( auto& rule : _fd_rules ) {
+    auto& this_pollfd = *pfd++;
+    this_pollfd.revents = exchange( rule.revents, 0 );
+    ready += this_pollfd.revents != 0;
+  }
+  return ready;
+}
+
+void EventLoop::call( const BasicRule& rule )
+{
+  ++_priority_stats[static_cast<size_t>( category_of( rule.category_id ).priority )].callbacks;
+  if ( not _profiling ) {
+    rule.callback();
+    return;
+  }
+
+  const size_t category_id = rule.category_id; // the callback may cancel the rule
+  const auto start = chrono::steady_clock::now();
+  rule.callback();
+  const chrono::nanoseconds elapsed = chrono::steady_clock::now() - start;
 
-      return Result::Success; /* only serve one rule on each iteration */
+  auto& stats = category_of( category_id ).stats;
+  ++stats.callbacks;
+  stats.callback_time += elapsed;
+  stats.max_callback_time = max( stats.max_callback_time, elapsed );
+}
+
+// A count of requests, so that each loop (on whatever thread) can tell whether it has acted on the latest.
+static atomic<uint64_t> stats_dumps_requested { 0 }; // NOLINT(*-avoid-non-const-global-variables)
+static_assert( atomic<uint64_t>::is_always_lock_free, "updated from a signal handler" );
+
+static void request_stats_dump( int /* signal */ )
+{
+  stats_dumps_requested.fetch_add( 1, memory_order_relaxed );
+}
+
+void EventLoop::dump_stats_on_signal( const int signal )
+{
+  struct sigaction action {};
+  action.sa_handler = request_stats_dump; // NOLINT(*-union-access)
+  CheckSystemCall( "sigemptyset", sigemptyset( &action.sa_mask ) );
+  action.sa_flags = SA_RESTART;
+  CheckSystemCall( "sigaction", sigaction( signal, &action, nullptr ) );
+}
+
+EventLoop::IterationTimer::IterationTimer( EventLoop* loop ) : loop_( loop )
+{
+  if ( not loop_->_profiling ) {
+    return;
+  }
+
+  const uint64_t requested = stats_dumps_requested.load( memory_order_relaxed );
+  if ( requested != loop_->_dumps_requested ) {
+    loop_->_dumps_requested = requested;
+    loop_->dump_stats( cerr );
+  }
+
+  start_ = chrono::steady_clock::now();
+  blocked_before_ = loop_->_loop_stats.blocked_time;
+}
+
+EventLoop::IterationTimer::~IterationTimer()
+{
+  if ( not loop_->_profiling or start_ == chrono::steady_clock::time_point {} ) {
+    return; // (profiling was turned on during the call)
+  }
+  auto& stats = loop_->_loop_stats;
+  ++stats.iterations;
+  stats.iteration_latency.record( chrono::steady_clock::now() - start_ - ( stats.blocked_time - blocked_before_ ) );
+}
+
+EventLoop::BlockedTimer::BlockedTimer( EventLoop* loop ) : loop_( loop )
+{
+  if ( loop_->_profiling ) {
+    start_ = chrono::steady_clock::now();
+  }
+}
+
+EventLoop::BlockedTimer::~BlockedTimer()
+{
+  if ( loop_->_profiling ) {
+    loop_->_loop_stats.blocked_time += chrono::steady_clock::now() - start_;
+  }
+}
+
+void EventLoop::set_profiling( const bool on )
+{
+  if ( on and not _profiling ) {
+    for_each_category( []( RuleCategory& category ) { category.stats = {}; } );
+    _loop_stats.iterations = 0;
+    _loop_stats.blocked_time = {};
+    _loop_stats.iteration_latency.clear();
+  }
+  _profiling = on;
+  _dumps_requested = stats_dumps_requested.load( memory_order_relaxed );
+}
+
+// (names are written as JSON strings)
+static string json_string( const string_view s )
+{
+  string ret = "\"";
+  for ( const char c : s ) {
+    if ( c == '"' or c == '\\' ) {
+      ret += '\\';
+      ret += c;
+    } else if ( static_cast<unsigned char>( c ) < 0x20 ) {
+      array<char, 8> escaped {};
+      snprintf( escaped.data(), escaped.size(), "\\u%04x", c ); // NOLINT(*-vararg)
+      ret += escaped.data();
+    } else {
+      ret += c;
     }
+  }
+  return ret + '"';
+}
+
+void EventLoop::dump_stats( ostream& out, const StatsFormat format ) const
+{
+  static constexpr array<const char*, 2> priority_names { "high", "bulk" };
+  const auto us = []( const chrono::nanoseconds ns ) { return chrono::duration<double, micro>( ns ).count(); };
+  const auto& latency = _loop_stats.iteration_latency;
+  const auto iterations = static_cast<double>( max<uint64_t>( _loop_stats.iterations, 1 ) );
+
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << fixed << setprecision( 1 );
 
-    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+  if ( format == StatsFormat::Json ) {
+    out << "{\"iterations\":" << _loop_stats.iterations << ",\"blocked_us\":" << us( _loop_stats.blocked_time )
+        << ",\"iteration_latency_us\":{\"p50\":" << us( latency.quantile( 0.5 ) )
+        << ",\"p90\":" << us( latency.quantile( 0.9 ) ) << ",\"p99\":" << us( latency.quantile( 0.99 ) )
+        << ",\"max\":" << us( latency.quantile( 1 ) ) << "},\"categories\":[";
+    bool first = true;
+    for_each_category( [&]( const RuleCategory& category ) {
+      const auto& [name, stats, priority] = tie( category.name, category.stats, category.priority );
+      out << ( first ? "" : "," ) << "{\"name\":" << json_string( name ) << ",\"callbacks\":" << stats.callbacks
+          << ",\"total_us\":" << us( stats.callback_time ) << ",\"max_us\":" << us( stats.max_callback_time )
+          << ",\"scanned\":" << stats.scanned << ",\"priority\":\"" << priority_names[static_cast<size_t>( priority )]
+          << "\"}";
+      first = false;
+    } );
+    out << "],\"priorities\":{";
+    for ( size_t i = 0; i < _priority_stats.size(); ++i ) {
+      const auto& stats = _priority_stats[i];
+      out << ( i ? "," : "" ) << "\"" << priority_names[i] << "\":{\"callbacks\":" << stats.callbacks
+          << ",\"deferred\":" << stats.deferred << ",\"max_wait\":" << stats.max_wait << "}";
+    }
+    out << "}}\n";
+  } else {
+    out << "event loop stats: " << _loop_stats.iterations << " iterations, " << us( _loop_stats.blocked_time )
+        << " us blocked, busy time per iteration p50/p99/max " << us( latency.quantile( 0.5 ) ) << "/"
+        << us( latency.quantile( 0.99 ) ) << "/" << us( latency.quantile( 1 ) ) << " us\n";
+    out << left << setw( 40 ) << "category" << right << setw( 12 ) << "callbacks" << setw( 14 ) << "total us"
+        << setw( 12 ) << "mean us" << setw( 12 ) << "max us" << setw( 14 ) << "scanned/iter" << "\n";
+    for_each_category( [&]( const RuleCategory& category ) {
+      const auto& [name, stats] = tie( category.name, category.stats );
+      const double mean = stats.callbacks ? us( stats.callback_time ) / static_cast<double>( stats.callbacks ) : 0;
+      out << left << setw( 40 ) << name.substr( 0, 39 ) << right << setw( 12 ) << stats.callbacks << setw( 14 )
+          << us( stats.callback_time ) << setw( 12 ) << mean << setw( 12 ) << us( stats.max_callback_time )
+          << setw( 14 ) << static_cast<double>( stats.scanned ) / iterations << "\n";
+    } );
+    for ( size_t i = 0; i < _priority_stats.size(); ++i ) {
+      const auto& stats = _priority_stats[i];
+      out << priority_names[i] << ": " << stats.callbacks << " callbacks, " << stats.deferred
+          << " deferred, longest wait " << stats.max_wait << " calls\n";
+    }
+    out << "(latency is the upper bound of a power-of-two bucket)\n";
   }
 
-  return Result::Success;
+  out.flags( flags );
+  out.precision( precision );
 }
-// NOLINTEND(*-signed-bitwise)
-// NOLINTEND(*-cognitive-complexity)
@@ -1,30 +1,123 @@
 #pragma once
 
-#include <functional>
-#include <list>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <memory>
+#include <ostream>
+#include <optional>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
 
+#include "fd_stats.hh"
 #include "file_descriptor.hh"
+#include "inline_function.hh"
+#include "io_uring.hh"
+#include "mpsc_queue.hh"
+#include "slab_list.hh"
+#include "task.hh"
+#include "timer_wheel.hh"
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop
 {
 public:
-  //! Indicates interest in reading (In) or writing (Out) a polled fd.
-  enum class Direction : bool
+  //! Indicates interest in reading (In) or writing (Out) a polled fd, or in its error queue (ErrorQueue).
+  enum class Direction : uint8_t
   {
-    In, // Callback will be triggered when Rule::fd is readable.
-    Out // Callback will be triggered when Rule::fd is writable.
+    In,        // Callback will be triggered when Rule::fd is readable.
+    Out,       // Callback will be triggered when Rule::fd is writable.
+    ErrorQueue // Callback will be triggered when Rule::fd (a socket) has messages on its error queue, such as
+               // MSG_ZEROCOPY completions. While such a rule exists, POLLERR on the socket with no pending
+               // socket error (SO_ERROR) is left to it instead of cancelling the fd's other rules.
+  };
+
+  //! How EventLoop::wait_next_event waits for file descriptors.
+  enum class Backend : uint8_t
+  {
+    Poll,    //!< One [poll(2)](\ref man2::poll) over every fd rule per call.
+    IoUring, //!< One-shot poll requests on an io_uring, re-armed only for rules that fired or changed interest,
+             //!< so each call is a single io_uring_enter(2) that submits and waits together.
+    Epoll    //!< Each fd is registered once with [epoll(7)](\ref man7::epoll) and updated with epoll_ctl(2) only
+             //!< when its rules' interest changes; only the rules on ready fds are looked at after the wait.
+  };
+
+  //! How many rules EventLoop::wait_next_event serves per call.
+  enum class Dispatch : uint8_t
+  {
+    OneRule, //!< Return after the first rule whose callback runs (a non-fd rule is drained while interested).
+    AllReady //!< Serve every interested non-fd rule and every ready fd rule from a single wait, each fd rule's
+             //!< callback once, within each category's budget (see EventLoop::set_category_budget).
+  };
+
+  //! Returned by each call to EventLoop::wait_next_event.
+  enum class Result : uint8_t
+  {
+    Success, //!< At least one Rule was triggered.
+    Timeout, //!< No rules were triggered before timeout.
+    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
+             //!< EventLoop::wait_next_event.
+  };
+
+  //! Dispatch order of a category's rules (see EventLoop::set_category_priority).
+  enum class Priority : uint8_t
+  {
+    High, //!< latency-sensitive: ready rules are served before any Bulk ones
+    Bulk  //!< the default: ready rules share what High ones leave, in proportion to their categories' weights
+  };
+
+  //! A priority class's counters, always kept, to show whether a class is being starved.
+  struct PriorityStats
+  {
+    uint64_t callbacks {}; //!< rule and timer callbacks called
+    uint64_t deferred {};  //!< times a ready fd rule was left for a later call (over budget, or with
+                           //!< Dispatch::OneRule, behind the rule that was served)
+    uint64_t max_wait {};  //!< the most calls a ready fd rule has waited for its callback
+  };
+
+  //! A category's counters, kept while profiling (see EventLoop::set_profiling).
+  struct CategoryStats
+  {
+    uint64_t callbacks {};                            //!< rule and timer callbacks called
+    std::chrono::nanoseconds callback_time {};       //!< spent in them, in total
+    std::chrono::nanoseconds max_callback_time {};   //!< the longest one
+    uint64_t scanned {}; //!< rules looked at by the per-call scans (interest checked, or events chosen)
+  };
+
+  //! The loop's own counters, kept while profiling.
+  struct LoopStats
+  {
+    uint64_t iterations {};                  //!< calls to wait_next_event
+    std::chrono::nanoseconds blocked_time {}; //!< spent waiting in poll(2), epoll_wait(2) or io_uring_enter(2)
+    LatencyHistogram iteration_latency {};    //!< each call's time, less the time it was blocked
+  };
+
+  //! Output formats for EventLoop::dump_stats.
+  enum class StatsFormat : uint8_t
+  {
+    Table,
+    Json
   };
 
 private:
-  using CallbackT = std::function<void( void )>;
-  using InterestT = std::function<bool( void )>;
+  // held inline in the rule: no allocation for lambdas with up to 56 bytes of captures
+  using CallbackT = InlineFunction<void( void )>;
+  using InterestT = InlineFunction<bool( void )>;
 
   struct RuleCategory
   {
     std::string name;
+    unsigned int budget {}; //!< Dispatch::AllReady: most callbacks per call (0 for no limit)
+    unsigned int served {}; //!< callbacks so far in the current call
+    CategoryStats stats {};
+    Priority priority { Priority::Bulk };
+    unsigned int weight { 1 };     //!< Bulk: share of the callbacks, relative to other Bulk categories
+    uint64_t virtual_time {};      //!< Bulk, weighted: tag of the category's latest served rule
+    unsigned int round_ready {};   //!< Bulk, weighted: ready rules tagged so far in the current call
   };
 
   struct BasicRule
@@ -33,8 +126,12 @@ private:
     InterestT interest;
     CallbackT callback;
     bool cancel_requested {};
+    bool explicit_interest {}; //!< set by RuleHandle::set_interest: `interested` is used instead of interest()
+    bool interested {};
 
     BasicRule( size_t s_category_id, InterestT s_interest, CallbackT s_callback );
+
+    bool wants_service() const { return explicit_interest ? interested : interest(); }
   };
 
   struct FDRule : public BasicRule
@@ -46,54 +143,360 @@ private:
 
     FDRule( BasicRule&& base, FileDescriptor&& s_fd, Direction s_direction, CallbackT s_cancel, CallbackT s_error );
 
-    //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
+    // io_uring backend: the rule's outstanding poll request, if any
+    uint64_t poll_token {}; //!< user_data of the outstanding request (0 if none): slot index + 1, and a serial
+    int16_t poll_events {}; //!< events it was submitted with
+    int16_t revents {};     //!< result delivered by its completion, until wait_next_event consumes it
+
+    // epoll backend
+    int16_t epoll_events {};   //!< events the rule asked for on the latest call (0 if it wasn't interested)
+    bool epoll_registered {}; //!< whether the rule is in its fd's EpollFD::rules
+
+    uint64_t served_call {}; //!< Dispatch::AllReady: the call (counting from 1) that last served it
+
+    bool rescan_queued {}; //!< epoll backend, explicit interest: whether it is in _fd_rules_to_rescan
+
+    bool internal {}; //!< the loop's own wakeup rule (see EventLoop::post): doesn't keep the loop from exiting
+
+    uint64_t deferred_call {}; //!< the call that first left it waiting while ready (0 if it isn't waiting)
+
+    //! Returns the number of times fd has been read or written, depending on the value of Rule::direction
+    //! (reading the error queue counts as a read).
     //! \details This function is used internally by EventLoop; you will not need to call it
     unsigned int service_count() const;
   };
 
+  struct TimerRule
+    : public BasicRule
+    , public TimerWheel::Timer
+  {
+    uint64_t period;                                  //!< ticks between firings (0 for a one-shot timer)
+    SlabList<TimerRule>::iterator position {}; //!< in EventLoop::_timer_rules
+
+    TimerRule( BasicRule&& base, uint64_t s_period );
+  };
+
+  using FDRuleIterator = SlabList<FDRule>::iterator;
+
+  //! epoll backend: the registration of one fd number, shared by every rule on it
+  struct EpollFD
+  {
+    uint32_t events {};                 //!< events currently registered with epoll_ctl(2)
+    bool added {};                      //!< whether the fd has been added to the epoll instance
+    bool dirty {};                      //!< whether it is in _epoll_dirty
+    std::vector<FDRuleIterator> rules {}; //!< the rules on this fd, in _fd_rules order
+  };
+
+  using NonFDRuleIterator = SlabList<BasicRule>::iterator;
+
+  // Rules are owned by the loop, in slabs: adding one allocates nothing once the slab has grown to fit.
   std::vector<RuleCategory> _rule_categories {};
-  std::list<std::shared_ptr<FDRule>> _fd_rules {};
-  std::list<std::shared_ptr<BasicRule>> _non_fd_rules {};
+  // the category of the loop's own wakeup rule (see EventLoop::post), kept out of _rule_categories
+  static constexpr size_t kPostedCategory = SIZE_MAX;
+  RuleCategory _posted_category { "posted" };
+  SlabList<FDRule> _fd_rules {};
+  SlabList<BasicRule> _non_fd_rules {};
 
-public:
-  EventLoop() { _rule_categories.reserve( 64 ); }
+  // timers, kept in the wheel by deadline (in ticks of _timer_resolution on the steady clock) and owned here
+  std::chrono::milliseconds _timer_resolution { 1 };
+  TimerWheel _timers;
+  SlabList<TimerRule> _timer_rules {};
+  std::vector<TimerWheel::Timer*> _expired_timers {};
 
-  //! Returned by each call to EventLoop::wait_next_event.
-  enum class Result : uint8_t
+  Dispatch _dispatch { Dispatch::OneRule };
+  uint64_t _call_count {};                                  //!< calls to wait_next_event so far
+  std::vector<FDRuleIterator> _served_fd_rules {};         //!< AllReady: served this call, in budgeted categories
+  std::vector<NonFDRuleIterator> _served_non_fd_rules {}; //!< (the same, for non-fd rules)
+
+  // Explicit interest: the number of fd rules with `interested` set. With the epoll backend, fd rules with
+  // explicit interest are detached from _fd_rules, so the per-call scan doesn't visit them; instead they are
+  // queued for a rescan when their interest changes, they are cancelled, or a callback on their fd runs.
+  size_t _explicit_interested_fd_rules {};
+  std::vector<SlabHandle> _fd_rules_to_rescan {};
+
+  // poll and io_uring backends: kept from call to call, so waiting allocates nothing
+  std::vector<pollfd> _pollfds {};        //!< one per fd rule, in _fd_rules order
+  std::vector<int> _error_queue_fds {}; //!< fds with an ErrorQueue rule
+
+  // io_uring backend state
+  std::unique_ptr<IoUring> _uring {};
+  uint32_t _poll_serial {}; //!< low half of the next poll token
+
+  // epoll backend state
+  std::optional<FileDescriptor> _epoll {};
+  std::unordered_map<int, EpollFD> _epoll_fds {}; //!< registrations by fd number
+  std::vector<int> _epoll_dirty {};               //!< fds whose rules' events changed since the last epoll_ctl(2)
+  std::vector<epoll_event> _epoll_events {};      //!< epoll_wait(2) results
+
+  //! A rule whose fd reported events, in EventLoop::_ready_rules
+  struct ReadyRule
   {
-    Success, //!< At least one Rule was triggered.
-    Timeout, //!< No rules were triggered before timeout.
-    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
-             //!< EventLoop::wait_next_event.
+    FDRuleIterator rule;
+    int16_t events;  //!< that it asked for
+    int16_t revents; //!< that its fd reported
+    bool has_error_queue_rule;
+    bool high {};       //!< in a Priority::High category
+    uint64_t order {}; //!< dispatch order within its class
+  };
+  std::vector<ReadyRule> _ready_rules {}; //!< rules on the fds that had events, in dispatch order
+
+  // priority classes (see EventLoop::set_category_priority)
+  size_t _high_categories {};
+  unsigned int _bulk_budget {};  //!< Dispatch::AllReady: most Bulk callbacks per call (0 for no limit)
+  unsigned int _bulk_served {};  //!< Bulk callbacks so far in the current call
+  bool _bulk_weighted {};        //!< whether Bulk rules are ordered by weight (some weight isn't 1, or a budget)
+  uint64_t _bulk_virtual_time {}; //!< tag of the latest Bulk rule served in weighted order
+  std::array<PriorityStats, 2> _priority_stats {};
+
+  //! Recomputes _bulk_weighted after a category's priority or weight, or the Bulk budget, changes.
+  void update_bulk_weighted();
+
+  std::vector<std::pair<int, int>> _socket_errors {}; //!< SO_ERROR per fd, read at most once per call
+
+  // profiling (see EventLoop::set_profiling)
+  bool _profiling;
+  LoopStats _loop_stats {};
+  uint64_t _dumps_requested {}; //!< dump requests (see EventLoop::dump_stats_on_signal) already acted on
+
+  //! A rule's category: one of _rule_categories, or _posted_category.
+  RuleCategory& category_of( size_t category_id )
+  {
+    return category_id == kPostedCategory ? _posted_category : _rule_categories[category_id];
+  }
+  const RuleCategory& category_of( size_t category_id ) const
+  {
+    return category_id == kPostedCategory ? _posted_category : _rule_categories[category_id];
+  }
+  //! Calls `f` on every category, _posted_category last.
+  template<class F>
+  void for_each_category( F&& f )
+  {
+    for ( auto& category : _rule_categories ) {
+      f( category );
+    }
+    f( _posted_category );
+  }
+  template<class F>
+  void for_each_category( F&& f ) const
+  {
+    for ( const auto& category : _rule_categories ) {
+      f( category );
+    }
+    f( _posted_category );
+  }
+
+  //! Calls a rule's callback, timing it when profiling.
+  void call( const BasicRule& rule );
+  //! Counts a rule looked at by a per-call scan.
+  void count_scanned( const BasicRule& rule )
+  {
+    if ( _profiling ) {
+      ++category_of( rule.category_id ).stats.scanned;
+    }
+  }
+
+  //! Times one call to wait_next_event, from its construction to its destruction, when profiling.
+  class IterationTimer
+  {
+    EventLoop* loop_;
+    std::chrono::steady_clock::time_point start_ {};
+    std::chrono::nanoseconds blocked_before_ {};
+
+  public:
+    explicit IterationTimer( EventLoop* loop );
+    ~IterationTimer();
+    IterationTimer( const IterationTimer& other ) = delete;
+    IterationTimer& operator=( const IterationTimer& other ) = delete;
+    IterationTimer( IterationTimer&& other ) = delete;
+    IterationTimer& operator=( IterationTimer&& other ) = delete;
+  };
+
+  //! Adds the time from its construction to its destruction to the loop's blocked time, when profiling.
+  class BlockedTimer
+  {
+    EventLoop* loop_;
+    std::chrono::steady_clock::time_point start_ {};
+
+  public:
+    explicit BlockedTimer( EventLoop* loop );
+    ~BlockedTimer();
+    BlockedTimer( const BlockedTimer& other ) = delete;
+    BlockedTimer& operator=( const BlockedTimer& other ) = delete;
+    BlockedTimer( BlockedTimer&& other ) = delete;
+    BlockedTimer& operator=( BlockedTimer&& other ) = delete;
+  };
+
+  // closures posted from other threads (see EventLoop::post), run by a rule on an eventfd that post() writes
+  // when it finds the queue empty
+  MPSCQueue<CallbackT> _posted {};
+  FileDescriptor _post_wakeup;
+  int _post_wakeup_fd; //!< (its number, for other threads)
+  std::string _post_wakeup_buffer { std::string( sizeof( uint64_t ), 0 ) };
+  std::atomic<size_t> _keep_alives {};
+
+  //! Runs the closures posted so far.
+  void run_posted();
+  //! Any thread: makes the loop's next (or current) wait return, to run posted closures or to exit.
+  void wake() const;
+
+  // coroutines (see EventLoop::spawn)
+  std::optional<size_t> _task_category {}; //!< of the rules and timers that resume tasks, once one is needed
+  TaskList _tasks {}; //!< last, so that it goes first: destroying a frame may cancel rules of this loop
+
+  //! Fills in pollfds[i].revents for the i-th fd rule; returns the number of fds with events.
+  size_t wait_for_fds( std::vector<pollfd>& pollfds, int timeout_ms );
+  size_t wait_for_fds_uring( std::vector<pollfd>& pollfds, int timeout_ms );
+
+  //! epoll backend: records the events `rule` asks for, registering its fd if this is the rule's first call.
+  void epoll_track( const FDRuleIterator& it, int16_t events );
+  //! epoll backend: brings the registrations of fds whose rules changed up to date.
+  void epoll_update();
+  //! epoll backend: waits, and gathers the rules on the fds that have events. Returns whether any fd had events.
+  bool wait_epoll( int timeout_ms );
+
+  //! Sorts _ready_rules into dispatch order: High before Bulk, and within a class (with Dispatch::AllReady) by
+  //! weighted share or by how long each rule has waited. Returns whether Bulk rules are in weighted order.
+  bool order_ready_rules();
+  //! Acts on _ready_rules in order (with Dispatch::OneRule, until a callback runs). Returns whether one ran.
+  bool dispatch_ready_rules();
+  //! Counts a ready fd rule that is left waiting.
+  void defer( FDRule& rule );
+
+  //! What became of a rule given its poll result.
+  enum class PollOutcome : uint8_t
+  {
+    Idle,      //!< nothing to do for it
+    Cancelled, //!< cancelled (error or hangup) and erased; the iterator has moved to the next rule
+    Served     //!< its callback was called
+  };
+
+  //! Acts on one fd rule's poll result: `events` are those it asked for, `revents` those the fd reported.
+  //! Errors and hangups are always handled; the callback is only called if the rule's category has budget left.
+  PollOutcome handle_poll_result( FDRuleIterator& it, int16_t events, int16_t revents, bool has_error_queue_rule );
+
+  //! Whether a rule in the category may be served now (always true with Dispatch::OneRule): within its category's
+  //! budget and, if Bulk, within the Bulk budget.
+  bool within_budget( size_t category_id ) const;
+  //! Counts a served rule against its category's budget.
+  template<class Iterator>
+  void count_served( const Iterator& it, std::vector<Iterator>& served );
+  //! Dispatch::AllReady: moves rules served in categories that used up their budget to the back of their list,
+  //! so that the rules left waiting go first next time.
+  void rotate_served();
+
+  //! The fd's pending socket error (SO_ERROR, which reading clears), cached for the rest of the call.
+  int socket_error( const FDRule& rule );
+
+  //! The current time, in timer ticks.
+  uint64_t timer_now() const;
+  //! `timeout_ms`, shortened to end when the next timer is due.
+  int timer_timeout( int timeout_ms ) const;
+  //! Calls the callbacks of every timer that is due, re-arming periodic ones. Returns how many were called.
+  size_t fire_timers();
+  //! Disarms and drops a timer rule.
+  void cancel_timer( TimerRule& rule );
+
+  enum class RuleKind : uint8_t
+  {
+    FD,
+    NonFD,
+    Timer
   };
 
+  //! Marks a rule cancelled, if it still exists (see RuleHandle::cancel).
+  void cancel_rule( RuleKind kind, SlabHandle handle );
+  //! Switches a rule to explicit interest, if it still exists (see RuleHandle::set_interest).
+  void set_rule_interest( RuleKind kind, SlabHandle handle, bool interested );
+  //! epoll backend: queues the rules on `fd` that have explicit interest for a rescan on the next call.
+  void queue_rescan( int fd );
+  //! epoll backend: does the per-call checks for the queued rules, which the scan of _fd_rules skips.
+  void rescan_explicit_rules();
+  //! The events an fd rule asks for: none if it isn't interested.
+  static int16_t wanted_events( const FDRule& rule );
+  //! Whether an fd rule is finished (cancelled, or at EOF or closed); if so, it has been erased (and its cancel
+  //! callback called unless cancelled from outside) and `it` has moved on.
+  bool retire_if_finished( FDRuleIterator& it );
+
+  //! Removes a rule, withdrawing its outstanding poll request (io_uring) or its share of the fd's registration
+  //! (epoll).
+  FDRuleIterator erase_fd_rule( FDRuleIterator it );
+
+public:
+  EventLoop() : EventLoop( Backend::Poll ) {}
+
+  //! Backend::IoUring falls back to Backend::Poll if the kernel doesn't support io_uring.
+  explicit EventLoop( Backend backend );
+
+  Backend backend() const { return _uring ? Backend::IoUring : _epoll ? Backend::Epoll : Backend::Poll; }
+
   size_t add_category( const std::string& name );
 
+  Dispatch dispatch() const { return _dispatch; }
+  void set_dispatch( Dispatch dispatch ) { _dispatch = dispatch; }
+
+  //! With Dispatch::AllReady, call at most `callbacks` callbacks of the category's rules per
+  //! EventLoop::wait_next_event (0, the default, for no limit). Rules over the budget stay ready for the next
+  //! call, so one busy connection can't starve the rest. Each callback still reads or writes as it pleases;
+  //! bound the bytes per round by bounding what one callback moves.
+  void set_category_budget( size_t category_id, unsigned int callbacks );
+
+  //! Refers to a rule by slot and generation, so a handle to a rule that has already gone (even if its slot has
+  //! been reused) does nothing. Must not be used after the loop is destroyed.
   class RuleHandle
   {
-    std::weak_ptr<BasicRule> rule_weak_ptr_;
+    EventLoop* loop_;
+    SlabHandle rule_;
+    RuleKind kind_;
 
   public:
-    template<class RuleType>
-    explicit RuleHandle( const std::shared_ptr<RuleType> x ) : rule_weak_ptr_( x )
-    {}
+    RuleHandle( EventLoop* loop, RuleKind kind, SlabHandle rule ) : loop_( loop ), rule_( rule ), kind_( kind ) {}
 
+    RuleHandle( const RuleHandle& other ) = default;
+    RuleHandle& operator=( const RuleHandle& other ) = default;
+    RuleHandle( RuleHandle&& other ) noexcept = default;
+    RuleHandle& operator=( RuleHandle&& other ) noexcept = default;
+    ~RuleHandle() = default;
+
+    //! Cancels the rule. A timer is taken out of the wheel at once.
     void cancel();
+
+    //! Sets whether the rule wants its callback called, instead of the loop asking its interest function
+    //! on every call (which it never does again for this rule). Call it whenever the answer changes.
+    //!
+    //! With the epoll backend, an fd rule with explicit interest costs nothing per call while nothing happens
+    //! on it, so a loop with many idle connections does work in proportion to the active ones. Such a rule is
+    //! only looked at again when its interest changes, when it is cancelled, or when a rule on its fd runs:
+    //! cancel it (or set it uninterested) before closing its fd anywhere else. Not for timers.
+    void set_interest( bool interested );
   };
 
   RuleHandle add_rule(
     size_t category_id,
     FileDescriptor& fd,
     Direction direction,
-    const CallbackT& callback,
-    const InterestT& interest = [] { return true; },
-    const CallbackT& cancel = [] {},
-    const CallbackT& error = [] {} );
+    CallbackT callback,
+    InterestT interest = [] { return true; },
+    CallbackT cancel = [] {},
+    CallbackT error = [] {} );
+
+  RuleHandle add_rule( size_t category_id, CallbackT callback, InterestT interest = [] { return true; } );
+
+  //! Calls `callback` once `delay` has passed, then (if `period` is non-zero) every `period` after that, until
+  //! cancelled through the returned handle. Timers due together fire together, in one batch per
+  //! EventLoop::wait_next_event, and waits are cut short for the nearest deadline.
+  RuleHandle add_timer( size_t category_id,
+                        std::chrono::milliseconds delay,
+                        CallbackT callback,
+                        std::chrono::milliseconds period = std::chrono::milliseconds { 0 } );
+
+  //! Tick length of the timer wheel: deadlines are rounded up to a whole tick, and timers due in the same tick
+  //! fire in the same batch. Only while no timers are armed. (Default: 1 ms.)
+  void set_timer_resolution( std::chrono::milliseconds resolution );
 
-  RuleHandle
-  add_rule( size_t category_id, const CallbackT& callback, const InterestT& interest = [] { return true; } );
+  size_t timers_armed() const { return _timers.size(); }
 
-  //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! Calls [poll(2)](\ref man2::poll) (or waits on the io_uring or epoll instance) and then executes callback
+  //! for the first ready rule, or each ready rule (see EventLoop::Dispatch).
   Result wait_next_event( int timeout_ms );
 
   // convenience function to add category and rule at the same time
@@ -102,6 +505,101 @@ public:
   {
     return add_rule( add_category( name ), std::forward<Targs>( Fargs )... );
   }
+
+  //! Puts the category's rules in a priority class. With either dispatch mode, a ready High rule's callback runs
+  //! before any Bulk one's (among fd rules, and among non-fd rules; timers and non-fd rules still go before fd
+  //! rules). With Dispatch::AllReady, ready Bulk fd rules are served in weighted fair order: each category's
+  //! share of the Bulk callbacks is proportional to `weight`, which matters when EventLoop::set_bulk_budget
+  //! limits them. Rules left over go first next time.
+  //! 规则优先级：High类别的就绪规则总是先于Bulk类别执行；Bulk类别之间按权重公平分配
+  void set_category_priority( size_t category_id, Priority priority, unsigned int weight = 1 );
+
+  //! With Dispatch::AllReady, call at most `callbacks` Bulk callbacks per call (0, the default, for no limit),
+  //! shared among the Bulk categories by weight. High rules are never held back by it.
+  void set_bulk_budget( unsigned int callbacks );
+
+  const PriorityStats& priority_stats( Priority priority ) const
+  {
+    return _priority_stats.at( static_cast<size_t>( priority ) );
+  }
+
+  //! Profiling: counts and times each category's callbacks (see EventLoop::CategoryStats), the time spent
+  //! blocked waiting, and each call's latency (see EventLoop::LoopStats). Off by default, or on if
+  //! $MINNOW_LOOP_STATS is set when the loop is made. Turning it on clears the counters.
+  //! 性能统计：每个类别的回调次数与耗时、阻塞等待时间、每次调用的延迟分布
+  void set_profiling( bool on );
+  bool profiling() const { return _profiling; }
+
+  const CategoryStats& category_stats( size_t category_id ) const { return _rule_categories.at( category_id ).stats; }
+  const LoopStats& loop_stats() const { return _loop_stats; }
+
+  //! Prints the counters: a table per category (callbacks, time, rules scanned per call), or one JSON object.
+  void dump_stats( std::ostream& out, StatsFormat format = StatsFormat::Table ) const;
+
+  //! Installs a handler for `signal` after which every profiling loop in the process dumps its stats to stderr
+  //! (as a table) at the start of its next call to wait_next_event. A wait interrupted by the signal returns
+  //! early, as a timeout.
+  static void dump_stats_on_signal( int signal = SIGUSR1 );
+
+  //! Any thread: queues `closure` to be run on the loop's thread, waking the loop if it is waiting. Closures
+  //! run in the order they were posted, in batches: each wakeup runs every closure posted before it began, so a
+  //! steady stream of posts can't hold the loop in one call. The loop only waits for posts (rather than return
+  //! Result::Exit when it has no other rules) while a KeepAlive exists or a post is pending.
+  //! 任意线程：把闭包投递到事件循环线程执行
+  void post( CallbackT closure );
+
+  //! Keeps the loop from returning Result::Exit for want of rules, so another thread can post to it later
+  //! (e.g. the result of work handed off to it). Movable, and may be dropped on any thread.
+  class KeepAlive
+  {
+    EventLoop* loop_;
+
+  public:
+    explicit KeepAlive( EventLoop* loop );
+    KeepAlive( const KeepAlive& other ) = delete;
+    KeepAlive& operator=( const KeepAlive& other ) = delete;
+    KeepAlive( KeepAlive&& other ) noexcept;
+    KeepAlive& operator=( KeepAlive&& other ) noexcept;
+    ~KeepAlive();
+
+    //! Lets the loop exit (if nothing else holds it), as destruction would.
+    void reset();
+  };
+
+  KeepAlive keep_alive() { return KeepAlive { this }; }
+
+  //! Runs a coroutine on this loop: it starts now, and is resumed by the loop when what it awaits is ready (see
+  //! Task). An exception that escapes it comes out of this call or of EventLoop::wait_next_event.
+  void spawn( Task task );
+
+  //! Coroutines still running on the loop.
+  size_t tasks() const { return _tasks.size(); }
+
+  //! The category of the rules and timers that resume coroutines (added on first use, as "tasks").
+  size_t task_category();
+
+  //! Awaitable for EventLoop::sleep.
+  class Sleep
+  {
+    EventLoop* loop_;
+    std::chrono::milliseconds delay_;
+
+  public:
+    Sleep( EventLoop* loop, std::chrono::milliseconds delay ) : loop_( loop ), delay_( delay ) {}
+
+    bool await_ready() const { return delay_.count() <= 0; }
+    void await_suspend( Task::Handle task ) const;
+    void await_resume() const {}
+  };
+
+  //! In a Task: `co_await loop.sleep( 5ms )` resumes the coroutine from a timer once the delay has passed.
+  Sleep sleep( std::chrono::milliseconds delay ) { return { this, delay }; }
+
+  template<typename... Targs>
+  auto add_timer( const std::string& name, Targs&&... Fargs )
+  {
+    return add_timer( add_category( name ), std::forward<Targs>( Fargs )... );
+  }
 };
 
 using Direction = EventLoop::Direction;
@@ -0,0 +1,235 @@
+#include "fd_handle.hh"
+
+#include "exception.hh"
+
+#include <array>
+#include <atomic>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+// The table is split into fixed-size chunks, allocated the first time an fd in their range is used and never
+// freed or moved, so a Slot& stays valid while other threads touch other fds.
+class FDTable
+{
+public:
+  static constexpr size_t kChunkSize = 1024;
+  static constexpr size_t kChunks = 1024; // fd numbers below 2^20
+
+private:
+  using Chunk = array<FDHandle::Slot, kChunkSize>;
+
+  array<atomic<Chunk*>, kChunks> chunks_ {};
+  mutex grow_lock_ {};
+
+public:
+  FDHandle::Slot& at( int fd )
+  {
+    const auto n = static_cast<size_t>( fd );
+    if ( fd < 0 or n >= kChunkSize * kChunks ) {
+      throw runtime_error( "FDHandle: fd number out of range: " + to_string( fd ) );
+    }
+
+    auto& chunk_ptr = chunks_.at( n / kChunkSize );
+    Chunk* chunk = chunk_ptr.load( memory_order_acquire );
+    if ( not chunk ) {
+      const lock_guard guard { grow_lock_ };
+      chunk = chunk_ptr.load( memory_order_relaxed );
+      if ( not chunk ) {
+        chunk = new Chunk; // NOLINT(*-owning-memory)
+        chunk_ptr.store( chunk, memory_order_release );
+      }
+    }
+    return chunk->at( n % kChunkSize );
+  }
+};
+
+// constant-initialized (no guard on each lookup), and trivially destructible so handles may outlive main()
+static constinit FDTable fd_table;
+
+// Each field has a single writer (the thread that owns the fd), so a relaxed load and store is enough.
+template<typename T>
+static void bump( atomic<T>& counter )
+{
+  counter.store( counter.load( memory_order_relaxed ) + 1, memory_order_relaxed );
+}
+
+void FDHandle::throw_invalid() const
+{
+  if ( not slot_ ) {
+    throw runtime_error( "FDHandle: use of moved-from handle" );
+  }
+  throw runtime_error( "FDHandle: stale handle to fd " + to_string( fd_ ) + " (closed and reused)" );
+}
+
+// fd is the file descriptor number returned by [open(2)](\ref man2::open) or similar
+FDHandle::FDHandle( int fd ) : slot_( &fd_table.at( fd ) ), fd_( fd )
+{
+  Slot& s = *slot_;
+  if ( not s.closed.load( memory_order_relaxed ) ) {
+    throw runtime_error( "FDHandle: fd " + to_string( fd ) + " is already owned by another handle" );
+  }
+
+  const int flags = fcntl( fd, F_GETFL ); // NOLINT(*-vararg)
+  if ( flags < 0 ) {
+    throw unix_error { "fcntl" };
+  }
+
+  // older handles to this number (closed, but still alive, perhaps on another thread) become stale
+  generation_ = s.generation.fetch_add( 1, memory_order_relaxed ) + 1;
+  atomic_thread_fence( memory_order_release ); // a checked() read of the fields below sees the new generation
+  s.refs.store( 1, memory_order_relaxed );
+  s.eof.store( false, memory_order_relaxed );
+  s.non_blocking.store( ( flags & O_NONBLOCK ) != 0, memory_order_relaxed );
+  s.read_count.store( 0, memory_order_relaxed );
+  s.write_count.store( 0, memory_order_relaxed );
+  s.closed.store( false, memory_order_relaxed );
+}
+
+FDHandle::FDHandle( FDHandle&& other ) noexcept
+  : slot_( exchange( other.slot_, nullptr ) ), fd_( exchange( other.fd_, -1 ) ), generation_( other.generation_ )
+{}
+
+FDHandle& FDHandle::operator=( FDHandle&& other ) noexcept
+{
+  if ( this != &other ) {
+    release();
+    slot_ = exchange( other.slot_, nullptr );
+    fd_ = exchange( other.fd_, -1 );
+    generation_ = other.generation_;
+  }
+  return *this;
+}
+
+// called when the last handle to an open fd goes away
+void FDHandle::close_last()
+{
+  slot_->eof.store( true, memory_order_relaxed );
+  slot_->closed.store( true, memory_order_relaxed );
+  if ( ::close( fd_ ) < 0 ) {
+    // don't throw an exception from the destructor
+    cerr << "Exception destructing FDHandle: " << unix_error { "close" }.what() << "\n";
+  }
+}
+
+bool FDHandle::eof() const
+{
+  return checked( &Slot::eof );
+}
+
+bool FDHandle::closed() const
+{
+  return checked( &Slot::closed );
+}
+
+unsigned int FDHandle::read_count() const
+{
+  return checked( &Slot::read_count );
+}
+
+unsigned int FDHandle::write_count() const
+{
+  return checked( &Slot::write_count );
+}
+
+unsigned int FDHandle::use_count() const
+{
+  return checked( &Slot::refs );
+}
+
+void FDHandle::close()
+{
+  Slot& s = slot();
+  if ( s.closed.load( memory_order_relaxed ) ) {
+    return;
+  }
+  s.eof.store( true, memory_order_relaxed );
+  s.closed.store( true, memory_order_relaxed );
+  CheckSystemCall( "close", ::close( fd_ ) );
+}
+
+void FDHandle::set_blocking( bool blocking )
+{
+  Slot& s = slot();
+  int flags = CheckSystemCall( "fcntl", fcntl( fd_, F_GETFL ) ); // NOLINT(*-vararg)
+  if ( blocking ) {
+    flags ^= ( flags & O_NONBLOCK ); // NOLINT(*-bitwise)
+  } else {
+    flags |= O_NONBLOCK; // NOLINT(*-bitwise)
+  }
+  CheckSystemCall( "fcntl", fcntl( fd_, F_SETFL, flags ) ); // NOLINT(*-vararg)
+  s.non_blocking.store( not blocking, memory_order_relaxed );
+}
+
+// buffer is the string to be read into
+void FDHandle::read( string& buffer )
+{
+  Slot& s = slot();
+  if ( buffer.empty() ) {
+    buffer.resize( 16384 );
+  }
+
+  const ssize_t bytes_read = ::read( fd_, buffer.data(), buffer.size() );
+  if ( bytes_read < 0 ) {
+    if ( s.non_blocking.load( memory_order_relaxed ) and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      buffer.clear();
+      return;
+    }
+    throw unix_error { "read" };
+  }
+
+  bump( s.read_count );
+  if ( bytes_read == 0 ) {
+    s.eof.store( true, memory_order_relaxed );
+  }
+  buffer.resize( bytes_read );
+}
+
+size_t FDHandle::write( string_view buffer )
+{
+  Slot& s = slot();
+  const ssize_t bytes_written = ::write( fd_, buffer.data(), buffer.size() );
+  if ( bytes_written < 0 ) {
+    if ( s.non_blocking.load( memory_order_relaxed ) and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      return 0;
+    }
+    throw unix_error { "write" };
+  }
+
+  bump( s.write_count );
+  if ( bytes_written == 0 and not buffer.empty() ) {
+    throw runtime_error( "write returned 0 given non-empty input buffer" );
+  }
+  return bytes_written;
+}
+
+size_t FDHandle::write( const vector<string_view>& buffers )
+{
+  Slot& s = slot();
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  size_t total_size = 0;
+  for ( const auto x : buffers ) {
+    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
+    total_size += x.size();
+  }
+
+  const ssize_t bytes_written = ::writev( fd_, iovecs.data(), static_cast<int>( iovecs.size() ) );
+  if ( bytes_written < 0 ) {
+    if ( s.non_blocking.load( memory_order_relaxed ) and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      return 0;
+    }
+    throw unix_error { "writev" };
+  }
+
+  bump( s.write_count );
+  if ( bytes_written == 0 and total_size != 0 ) {
+    throw runtime_error( "write returned 0 given non-empty input buffer" );
+  }
+  return bytes_written;
+}
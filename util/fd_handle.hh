@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A handle to a file descriptor that, unlike FileDescriptor, never touches the heap.
+// 一个不使用堆内存的文件描述符句柄（与FileDescriptor不同）
+//
+// The descriptor's state (flags, counts and the reference count) lives in a process-wide table indexed by
+// the fd number, so making, duplicating and dropping handles is allocation-free and uses plain (non-atomic)
+// reference counts. Each handle carries the generation of the table slot it was made for: if its fd is closed
+// and the number is reused by a new FDHandle, the old handles become stale and any use of them throws.
+//
+// All handles to one fd must be used from one thread (different fds may live on different threads). Fd numbers
+// are reused across threads, though (e.g. by each CoreRuntime worker's accept()), so a stale handle on one
+// thread may be looked at while another thread's FDHandle takes the number over. Every slot field is therefore
+// a relaxed atomic, written with a plain load and store by the one thread that owns the fd (no locked
+// instructions), and a new FDHandle bumps the generation before it resets the other fields: a read that
+// re-checks the generation afterwards (see checked()) never hands a stale handle the new owner's state.
+class FDHandle
+{
+  friend class FDTable;
+
+  struct Slot
+  {
+    std::atomic<uint32_t> generation = 0; // bumped each time a new FDHandle takes this fd number
+    std::atomic<uint32_t> refs = 0;       // live handles of the current generation, while the fd is open
+    std::atomic<bool> closed = true;
+    std::atomic<bool> eof = false;
+    std::atomic<bool> non_blocking = false;
+    std::atomic<unsigned int> read_count = 0;
+    std::atomic<unsigned int> write_count = 0;
+  };
+
+  Slot* slot_ = nullptr; // table slots never move, so the handle can point straight at its own
+  int fd_ = -1;          // -1 once moved from
+  uint32_t generation_ = 0;
+
+  [[noreturn]] void throw_invalid() const;
+  void close_last();
+
+  // throws if the handle is stale or moved from
+  Slot& slot() const
+  {
+    if ( not valid() ) {
+      throw_invalid();
+    }
+    return *slot_;
+  }
+
+  // reads one of the slot's fields, throwing if the handle is (or became, during the read) stale
+  template<typename T>
+  T checked( std::atomic<T> Slot::*field ) const
+  {
+    const T value = ( slot().*field ).load( std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_acquire ); // pairs with the release fence in FDHandle( int )
+    slot();
+    return value;
+  }
+
+  FDHandle( Slot* slot, int fd, uint32_t generation ) : slot_( slot ), fd_( fd ), generation_( generation ) {}
+
+  // Only an open fd's count matters, and only the thread that owns it can close it. Once it is closed, another
+  // thread may take the number over and reset the count, so leave the count alone.
+  void release()
+  {
+    if ( slot_ ) {
+      const bool closed = slot_->closed.load( std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_acquire ); // as in checked()
+      if ( valid() and not closed ) {
+        const uint32_t refs = slot_->refs.load( std::memory_order_relaxed ) - 1;
+        slot_->refs.store( refs, std::memory_order_relaxed );
+        if ( refs == 0 ) {
+          close_last();
+        }
+      }
+    }
+    slot_ = nullptr;
+    fd_ = -1;
+  }
+
+public:
+  // Take ownership of a file descriptor number returned by the kernel
+  // 接管内核返回的文件描述符编号
+  explicit FDHandle( int fd );
+
+  // The last handle to an fd closes it on destruction
+  ~FDHandle() { release(); }
+
+  // Copy a handle explicitly, increasing the reference count (no allocation)
+  // 显式复制句柄，增加引用计数（不分配内存）
+  FDHandle duplicate() const
+  {
+    Slot& s = slot();
+    s.refs.store( s.refs.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    return { slot_, fd_, generation_ };
+  }
+
+  FDHandle( const FDHandle& other ) = delete;
+  FDHandle& operator=( const FDHandle& other ) = delete;
+  FDHandle( FDHandle&& other ) noexcept;
+  FDHandle& operator=( FDHandle&& other ) noexcept;
+
+  // false if the fd was closed and its number reused by a newer FDHandle (or this handle was moved from)
+  bool valid() const { return slot_ and slot_->generation.load( std::memory_order_relaxed ) == generation_; }
+
+  int fd_num() const
+  {
+    slot();
+    return fd_;
+  }
+
+  bool eof() const;
+  bool closed() const;
+  unsigned int read_count() const;
+  unsigned int write_count() const;
+  unsigned int use_count() const; // handles sharing this fd
+
+  void close();
+  void set_blocking( bool blocking );
+
+  // Same semantics as the FileDescriptor equivalents (an empty `buffer` is read into 16 KiB)
+  void read( std::string& buffer );
+  size_t write( std::string_view buffer );
+  size_t write( const std::vector<std::string_view>& buffers );
+};
@@ -0,0 +1,177 @@
+#include "fd_stats.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Each counter has a single writer, so a relaxed load and store is enough (and cheaper than fetch_add).
+static void bump( atomic<uint64_t>& counter, uint64_t n = 1 )
+{
+  counter.store( counter.load( memory_order_relaxed ) + n, memory_order_relaxed );
+}
+
+void LatencyHistogram::record( nanoseconds duration )
+{
+  const auto ns = static_cast<uint64_t>( max( duration.count(), nanoseconds::rep { 0 } ) );
+  bump( buckets_.at( min<size_t>( bit_width( ns ), kBuckets - 1 ) ) );
+}
+
+void LatencyHistogram::clear()
+{
+  for ( auto& b : buckets_ ) {
+    b.store( 0, memory_order_relaxed );
+  }
+}
+
+uint64_t LatencyHistogram::count() const
+{
+  uint64_t ret = 0;
+  for ( const auto& b : buckets_ ) {
+    ret += b.load( memory_order_relaxed );
+  }
+  return ret;
+}
+
+nanoseconds LatencyHistogram::quantile( double q ) const
+{
+  const uint64_t total = count();
+  if ( total == 0 ) {
+    return {};
+  }
+
+  const auto rank = static_cast<uint64_t>( q * static_cast<double>( total - 1 ) ) + 1;
+  uint64_t seen = 0;
+  for ( size_t i = 0; i < kBuckets; ++i ) {
+    seen += buckets_.at( i ).load( memory_order_relaxed );
+    if ( seen >= rank ) {
+      return nanoseconds { uint64_t { 1 } << i };
+    }
+  }
+  return nanoseconds { uint64_t { 1 } << ( kBuckets - 1 ) };
+}
+
+FDStats::FDStats( int fd_num ) : fd( fd_num )
+{
+  FDStatsRegistry::add( this );
+}
+
+FDStats::~FDStats()
+{
+  FDStatsRegistry::remove( this );
+}
+
+void FDStats::record_read( ssize_t result, nanoseconds duration )
+{
+  if ( result >= 0 ) {
+    bump( reads );
+    bump( bytes_read, result );
+  } else if ( errno == EAGAIN ) {
+    bump( would_block_reads );
+  } else {
+    bump( errors );
+  }
+  read_latency.record( duration );
+}
+
+void FDStats::record_write( ssize_t result, size_t requested, nanoseconds duration )
+{
+  if ( result >= 0 ) {
+    bump( writes );
+    bump( bytes_written, result );
+    if ( static_cast<size_t>( result ) < requested ) {
+      bump( partial_writes );
+    }
+  } else if ( errno == EAGAIN ) {
+    bump( would_block_writes );
+  } else {
+    bump( errors );
+  }
+  write_latency.record( duration );
+}
+
+namespace {
+
+struct Registry
+{
+  mutex lock {};
+  unordered_set<FDStats*> live {};
+  atomic<bool> enabled { getenv( "MINNOW_FD_STATS" ) != nullptr };
+};
+
+} // namespace
+
+static Registry& registry()
+{
+  static Registry* const instance = new Registry; // never destroyed, so descriptors may outlive main()
+  return *instance;
+}
+
+void FDStatsRegistry::add( FDStats* stats )
+{
+  const lock_guard guard { registry().lock };
+  registry().live.insert( stats );
+}
+
+void FDStatsRegistry::remove( FDStats* stats )
+{
+  const lock_guard guard { registry().lock };
+  registry().live.erase( stats );
+}
+
+bool FDStatsRegistry::enabled()
+{
+  return registry().enabled.load( memory_order_relaxed );
+}
+
+void FDStatsRegistry::enable( bool on )
+{
+  registry().enabled.store( on, memory_order_relaxed );
+}
+
+size_t FDStatsRegistry::size()
+{
+  const lock_guard guard { registry().lock };
+  return registry().live.size();
+}
+
+void FDStatsRegistry::dump( ostream& out )
+{
+  const lock_guard guard { registry().lock };
+
+  vector<const FDStats*> sorted { registry().live.begin(), registry().live.end() };
+  sort( sorted.begin(), sorted.end(), []( auto* a, auto* b ) { return a->fd < b->fd; } );
+
+  const auto us = []( nanoseconds ns ) { return duration<double, micro>( ns ).count(); };
+  const auto load = []( const atomic<uint64_t>& x ) { return x.load( memory_order_relaxed ); };
+
+  out << "descriptor stats (" << sorted.size() << " live)\n";
+  out << right << setw( 6 ) << "fd" << setw( 10 ) << "reads" << setw( 14 ) << "bytes in" << setw( 10 )
+      << "EAGAIN" << setw( 10 ) << "writes" << setw( 14 ) << "bytes out" << setw( 10 ) << "EAGAIN" << setw( 10 )
+      << "partial" << setw( 8 ) << "errors" << setw( 22 ) << "read p50/p99 us" << setw( 22 )
+      << "write p50/p99 us" << "\n";
+
+  out << fixed << setprecision( 1 );
+  for ( const auto* s : sorted ) {
+    const auto latency = [&]( const LatencyHistogram& h ) {
+      ostringstream ss;
+      ss << fixed << setprecision( 1 ) << us( h.quantile( 0.5 ) ) << "/" << us( h.quantile( 0.99 ) );
+      return ss.str();
+    };
+    out << setw( 6 ) << ( to_string( s->fd ) + ( s->closed.load( memory_order_relaxed ) ? "*" : "" ) )
+        << setw( 10 ) << load( s->reads ) << setw( 14 ) << load( s->bytes_read ) << setw( 10 )
+        << load( s->would_block_reads ) << setw( 10 ) << load( s->writes ) << setw( 14 )
+        << load( s->bytes_written ) << setw( 10 ) << load( s->would_block_writes ) << setw( 10 )
+        << load( s->partial_writes ) << setw( 8 ) << load( s->errors ) << setw( 22 )
+        << latency( s->read_latency ) << setw( 22 ) << latency( s->write_latency ) << "\n";
+  }
+  out << "(* closed; latency is the upper bound of a power-of-two bucket)\n";
+}
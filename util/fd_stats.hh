@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <sys/types.h>
+
+// A log2-bucketed histogram of durations: bucket i counts durations in [2^(i-1), 2^i) nanoseconds.
+// 按log2分桶的耗时直方图：第i个桶统计耗时在[2^(i-1), 2^i)纳秒之间的次数
+class LatencyHistogram
+{
+public:
+  static constexpr size_t kBuckets = 40; // up to ~9 minutes
+
+private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_ {};
+
+public:
+  void record( std::chrono::nanoseconds duration );
+  void clear();
+
+  uint64_t count() const;
+
+  // upper bound of the bucket containing the given quantile (0 if empty)
+  std::chrono::nanoseconds quantile( double q ) const;
+};
+
+// Counters for one file descriptor, updated around each read/write syscall.
+// 单个文件描述符的统计信息，在每次读写系统调用前后更新
+// Only the thread using the descriptor writes them; FDStatsRegistry::dump() may read them from any thread.
+struct FDStats
+{
+  int fd;
+  std::atomic<bool> closed {};
+
+  std::atomic<uint64_t> reads {};
+  std::atomic<uint64_t> bytes_read {};
+  std::atomic<uint64_t> would_block_reads {}; // EAGAIN
+  std::atomic<uint64_t> writes {};
+  std::atomic<uint64_t> bytes_written {};
+  std::atomic<uint64_t> would_block_writes {}; // EAGAIN
+  std::atomic<uint64_t> partial_writes {};     // wrote some, but less than asked
+  std::atomic<uint64_t> errors {};             // any other failure
+
+  LatencyHistogram read_latency {};
+  LatencyHistogram write_latency {};
+
+  // Registers with FDStatsRegistry until destroyed.
+  explicit FDStats( int fd_num );
+  ~FDStats();
+
+  FDStats( const FDStats& other ) = delete;
+  FDStats& operator=( const FDStats& other ) = delete;
+  FDStats( FDStats&& other ) = delete;
+  FDStats& operator=( FDStats&& other ) = delete;
+
+  // `result` is the syscall's return value (with errno still set if it is negative)
+  void record_read( ssize_t result, std::chrono::nanoseconds duration );
+  void record_write( ssize_t result, size_t requested, std::chrono::nanoseconds duration );
+};
+
+// Times one syscall for FDStats. Without stats (the default), it doesn't even read the clock.
+class SyscallTimer
+{
+  std::chrono::steady_clock::time_point start_ {};
+
+public:
+  explicit SyscallTimer( const FDStats* stats )
+  {
+    if ( stats ) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  std::chrono::nanoseconds elapsed() const { return std::chrono::steady_clock::now() - start_; }
+};
+
+// The process-wide set of live descriptors that have stats.
+// 进程范围内所有带统计信息的存活描述符
+class FDStatsRegistry
+{
+  friend struct FDStats;
+
+  static void add( FDStats* stats );
+  static void remove( FDStats* stats );
+
+public:
+  // Whether descriptors created from now on get stats. Off by default, or on if $MINNOW_FD_STATS is set.
+  // 之后创建的描述符是否带统计信息（默认关闭；设置了环境变量MINNOW_FD_STATS时开启）
+  static bool enabled();
+  static void enable( bool on = true );
+
+  // number of live descriptors with stats
+  static size_t size();
+
+  // Print a table of every live descriptor's stats.
+  static void dump( std::ostream& out );
+};
@@ -2,9 +2,15 @@
 
 #include "exception.hh"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
@@ -34,8 +40,13 @@ T FileDescriptor::CheckSystemCall( string_view s_attempt, T return_value ) const
   return internal_fd_->CheckSystemCall( s_attempt, return_value );
 }
 
+// used by the subclasses (e.g. for recvfrom and sendmsg in socket.cc)
+template int FileDescriptor::CheckSystemCall( string_view s_attempt, int return_value ) const;
+template ssize_t FileDescriptor::CheckSystemCall( string_view s_attempt, ssize_t return_value ) const;
+
 // fd is the file descriptor number returned by [open(2)](\ref man2::open) or similar
-FileDescriptor::FDWrapper::FDWrapper( int fd ) : fd_( fd )
+FileDescriptor::FDWrapper::FDWrapper( int fd )
+  : fd_( fd ), stats_( FDStatsRegistry::enabled() and fd >= 0 ? make_unique<FDStats>( fd ) : nullptr )
 {
   if ( fd < 0 ) {
     throw runtime_error( "invalid fd number:" + to_string( fd ) );
@@ -49,6 +60,9 @@ void FileDescriptor::FDWrapper::close()
 {
   CheckSystemCall( "close", ::close( fd_ ) );
   eof_ = closed_ = true;
+  if ( stats_ ) {
+    stats_->closed = true;
+  }
 }
 
 FileDescriptor::FDWrapper::~FDWrapper()
@@ -64,6 +78,36 @@ FileDescriptor::FDWrapper::~FDWrapper()
   }
 }
 
+size_t FileDescriptor::FDWrapper::next_read_size()
+{
+  // Only ask the kernel after a full read, which suggests more is queued; otherwise the history is
+  // enough and the common case costs no extra syscall.
+  if ( last_read_full_ and fionread_supported_ ) {
+    int queued = 0;
+    if ( ioctl( fd_, FIONREAD, &queued ) < 0 ) { // NOLINT(*-vararg)
+      fionread_supported_ = false;               // e.g. ENOTTY
+      read_size_ = min( read_size_ * 2, kMaxReadSize );
+    } else if ( static_cast<size_t>( queued ) > read_size_ ) {
+      read_size_ = min( bit_ceil( static_cast<size_t>( queued ) ), kMaxReadSize );
+    }
+  }
+  return read_size_;
+}
+
+void FileDescriptor::FDWrapper::record_read( size_t requested, size_t got )
+{
+  read_average_ = ( read_average_ * 7 + got ) / 8; // alpha = 1/8
+  last_read_full_ = got == requested;
+
+  if ( last_read_full_ ) {
+    if ( not fionread_supported_ ) {
+      read_size_ = min( max( read_size_, requested * 2 ), kMaxReadSize ); // no way to ask: just grow
+    }
+  } else {
+    read_size_ = clamp( bit_ceil( max( read_average_, got ) ), kMinReadSize, kMaxReadSize ); // decay
+  }
+}
+
 // fd is the file descriptor number returned by [open(2)](\ref man2::open) or similar
 FileDescriptor::FileDescriptor( int fd ) : internal_fd_( make_shared<FDWrapper>( fd ) ) {}
 
@@ -79,18 +123,30 @@ FileDescriptor FileDescriptor::duplicate() const
 
 // buffer is the string to be read into
 void FileDescriptor::read( string& buffer )
+{
+  const IOResult result = try_read( buffer );
+  if ( not( internal_fd_->non_blocking_ and result.would_block() ) ) {
+    result.throw_if_error( "read" );
+  }
+}
+
+// buffer is the string to be read into (cleared on failure)
+IOResult FileDescriptor::try_read( string& buffer )
 {
   if ( buffer.empty() ) {
-    buffer.resize( kReadBufferSize );
+    buffer.resize( min( internal_fd_->next_read_size(), kReadBufferSize ) ); // zero-filled: keep it small
   }
 
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats };
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
-  if ( bytes_read < 0 ) {
-    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      buffer.clear();
-      return;
-    }
-    throw unix_error { "read" };
+  const IOResult result = IOResult::from_syscall( bytes_read );
+  if ( stats ) {
+    stats->record_read( bytes_read, timer.elapsed() );
+  }
+  if ( not result ) {
+    buffer.clear();
+    return result;
   }
 
   register_read();
@@ -103,17 +159,71 @@ void FileDescriptor::read( string& buffer )
     throw runtime_error( "read() read more than requested" );
   }
 
+  if ( bytes_read > 0 ) {
+    internal_fd_->record_read( buffer.size(), bytes_read );
+  }
+
   buffer.resize( bytes_read );
+  return result;
+}
+
+PooledBuffer FileDescriptor::read( BufferPool& pool )
+{
+  PooledBuffer buffer;
+  const IOResult result = try_read( pool, buffer );
+  if ( not( internal_fd_->non_blocking_ and result.would_block() ) ) {
+    result.throw_if_error( "read" );
+  }
+  return buffer;
+}
+
+// buffer is set to a slab from pool holding what was read (left empty at EOF or on failure)
+IOResult FileDescriptor::try_read( BufferPool& pool, PooledBuffer& buffer )
+{
+  buffer = pool.acquire();
+
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats };
+  const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.capacity() );
+  const IOResult result = IOResult::from_syscall( bytes_read );
+  if ( stats ) {
+    stats->record_read( bytes_read, timer.elapsed() );
+  }
+  if ( not result ) {
+    buffer = {};
+    return result;
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 ) {
+    internal_fd_->eof_ = true;
+    buffer = {};
+    return result;
+  }
+
+  internal_fd_->record_read( buffer.capacity(), bytes_read );
+  buffer.resize( bytes_read );
+  return result;
 }
 
 void FileDescriptor::read( vector<string>& buffers )
+{
+  const IOResult result = try_read( buffers );
+  if ( not( internal_fd_->non_blocking_ and result.would_block() ) ) {
+    result.throw_if_error( "read" );
+  }
+}
+
+// buffers are the strings to be read into, in order (cleared on failure)
+IOResult FileDescriptor::try_read( vector<string>& buffers )
 {
   if ( buffers.empty() ) {
-    return;
+    return IOResult::success( 0 );
   }
 
   buffers.back().clear();
-  buffers.back().resize( kReadBufferSize );
+  buffers.back().resize( internal_fd_->next_read_size() );
 
   vector<iovec> iovecs;
   iovecs.reserve( buffers.size() );
@@ -123,13 +233,16 @@ void FileDescriptor::read( vector<string>& buffers )
     total_size += x.size();
   }
 
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats };
   const ssize_t bytes_read = ::readv( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) );
-  if ( bytes_read < 0 ) {
-    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      buffers.clear();
-      return;
-    }
-    throw unix_error { "read" };
+  const IOResult result = IOResult::from_syscall( bytes_read );
+  if ( stats ) {
+    stats->record_read( bytes_read, timer.elapsed() );
+  }
+  if ( not result ) {
+    buffers.clear();
+    return result;
   }
 
   register_read();
@@ -138,6 +251,10 @@ void FileDescriptor::read( vector<string>& buffers )
     throw runtime_error( "read() read more than requested" );
   }
 
+  if ( bytes_read > 0 ) {
+    internal_fd_->record_read( total_size, bytes_read );
+  }
+
   size_t remaining_size = bytes_read;
   for ( auto& buf : buffers ) {
     if ( remaining_size >= buf.size() ) {
@@ -147,11 +264,49 @@ void FileDescriptor::read( vector<string>& buffers )
       remaining_size = 0;
     }
   }
+  return result;
+}
+
+// The throwing write()s: a non-blocking fd that would block counts as having written nothing.
+static size_t checked_write_count( const IOResult& result,
+                                   bool non_blocking,
+                                   size_t total_size,
+                                   string_view attempt )
+{
+  if ( not( non_blocking and result.would_block() ) ) {
+    result.throw_if_error( attempt );
+  }
+
+  if ( result.bytes() == 0 and total_size != 0 ) {
+    throw runtime_error( "write returned 0 given non-empty input buffer" );
+  }
+
+  return result.bytes();
 }
 
 size_t FileDescriptor::write( string_view buffer )
 {
-  return write( vector<string_view> { buffer } );
+  return checked_write_count( try_write( buffer ), internal_fd_->non_blocking_, buffer.size(), "write" );
+}
+
+IOResult FileDescriptor::try_write( string_view buffer )
+{
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats };
+  const ssize_t bytes_written = ::write( fd_num(), buffer.data(), buffer.size() );
+  const IOResult result = IOResult::from_syscall( bytes_written );
+  if ( stats ) {
+    stats->record_write( bytes_written, buffer.size(), timer.elapsed() );
+  }
+  if ( result or result.would_block() ) {
+    register_write();
+  }
+
+  if ( result.bytes() > buffer.size() ) {
+    throw runtime_error( "write wrote more than length of input buffer" );
+  }
+
+  return result;
 }
 
 size_t FileDescriptor::write( const vector<Ref<string>>& buffers )
@@ -165,6 +320,15 @@ size_t FileDescriptor::write( const vector<Ref<string>>& buffers )
 }
 
 size_t FileDescriptor::write( const vector<string_view>& buffers )
+{
+  size_t total_size = 0;
+  for ( const auto x : buffers ) {
+    total_size += x.size();
+  }
+  return checked_write_count( try_write( buffers ), internal_fd_->non_blocking_, total_size, "writev" );
+}
+
+IOResult FileDescriptor::try_write( const vector<string_view>& buffers )
 {
   vector<iovec> iovecs;
   iovecs.reserve( buffers.size() );
@@ -174,19 +338,87 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
     total_size += x.size();
   }
 
-  const ssize_t bytes_written
-    = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
-  register_write();
-
-  if ( bytes_written == 0 and total_size != 0 ) {
-    throw runtime_error( "write returned 0 given non-empty input buffer" );
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats };
+  const ssize_t bytes_written = ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) );
+  const IOResult result = IOResult::from_syscall( bytes_written );
+  if ( stats ) {
+    stats->record_write( bytes_written, total_size, timer.elapsed() );
+  }
+  if ( result or result.would_block() ) {
+    register_write();
   }
 
-  if ( bytes_written > static_cast<ssize_t>( total_size ) ) {
+  if ( result.bytes() > total_size ) {
     throw runtime_error( "write wrote more than length of input buffer" );
   }
 
-  return bytes_written;
+  return result;
+}
+
+size_t FileDescriptor::splice_to( FileDescriptor& out, size_t len )
+{
+  if ( len == 0 ) {
+    return 0;
+  }
+
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats ? stats : out.internal_fd_->stats_.get() };
+  const ssize_t bytes_moved
+    = ::splice( fd_num(), nullptr, out.fd_num(), nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+  if ( stats ) {
+    stats->record_read( bytes_moved, timer.elapsed() );
+  }
+  if ( out.internal_fd_->stats_ ) {
+    out.internal_fd_->stats_->record_write( bytes_moved, len, timer.elapsed() );
+  }
+  if ( bytes_moved < 0 ) {
+    if ( errno == EAGAIN ) {
+      return 0; // SPLICE_F_NONBLOCK applies to the pipe even if neither fd is non-blocking
+    }
+    throw unix_error { "splice" };
+  }
+
+  if ( bytes_moved == 0 ) {
+    internal_fd_->eof_ = true;
+    return 0;
+  }
+
+  register_read();
+  out.register_write();
+  return bytes_moved;
+}
+
+size_t FileDescriptor::sendfile_to( FileDescriptor& out, size_t len )
+{
+  if ( len == 0 ) {
+    return 0;
+  }
+
+  FDStats* const stats = internal_fd_->stats_.get();
+  const SyscallTimer timer { stats ? stats : out.internal_fd_->stats_.get() };
+  const ssize_t bytes_moved = ::sendfile( out.fd_num(), fd_num(), nullptr, len );
+  if ( stats ) {
+    stats->record_read( bytes_moved, timer.elapsed() );
+  }
+  if ( out.internal_fd_->stats_ ) {
+    out.internal_fd_->stats_->record_write( bytes_moved, len, timer.elapsed() );
+  }
+  if ( bytes_moved < 0 ) {
+    if ( errno == EAGAIN ) {
+      return 0;
+    }
+    throw unix_error { "sendfile" };
+  }
+
+  if ( bytes_moved == 0 ) {
+    internal_fd_->eof_ = true;
+    return 0;
+  }
+
+  register_read();
+  out.register_write();
+  return bytes_moved;
 }
 
 void FileDescriptor::set_blocking( bool blocking )
@@ -202,3 +434,17 @@ void FileDescriptor::set_blocking( bool blocking )
 
   internal_fd_->non_blocking_ = not blocking;
 }
+
+off_t FileDescriptor::size() const
+{
+  struct stat st {};
+  CheckSystemCall( "fstat", fstat( fd_num(), &st ) );
+  return st.st_size;
+}
+
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "pipe", ::pipe( fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "buffer_pool.hh"
+#include "fd_stats.hh"
+#include "io_result.hh"
 #include "ref.hh"
 #include <cstddef>
 #include <memory>
+#include <utility>
 #include <vector>
 
 /*
@@ -91,6 +95,16 @@ class FileDescriptor
     unsigned read_count_ = 0;   // The number of times FDWrapper::fd_ has been read / 文件描述符被读取的次数统计
     unsigned write_count_ = 0;  // The numberof times FDWrapper::fd_ has been written / 文件描述符被写入的次数统计
 
+    // Adaptive read sizing / 自适应读取大小
+    size_t read_size_ = kReadBufferSize;    // size chosen for the next read / 下一次读取选择的大小
+    size_t read_average_ = kReadBufferSize; // EWMA of bytes returned per read / 每次读取字节数的指数加权平均
+    bool last_read_full_ = false;           // whether the last read filled its buffer / 上次读取是否填满了缓冲区
+    bool fionread_supported_ = true;        // cleared if ioctl(FIONREAD) fails on this fd / FIONREAD失败后清除
+
+    // Syscall statistics, if FDStatsRegistry was enabled when the fd was wrapped (null otherwise)
+    // 系统调用统计信息（仅当创建时FDStatsRegistry已启用，否则为空）
+    std::unique_ptr<FDStats> stats_;
+
     /*
      * 🛠️ C++知识体系3：RAII设计模式
      * 
@@ -123,6 +137,14 @@ class FileDescriptor
     // 调用系统函数close(2)关闭文件描述符
     void close();
 
+    // Size for the next read: after a read that filled its buffer, what FIONREAD says is queued
+    // (if more than the current choice); otherwise read_size_.
+    // 下一次读取的大小：上次读取填满缓冲区时参考FIONREAD报告的排队字节数，否则使用read_size_
+    size_t next_read_size();
+    // Update the history with a read of `got` bytes into a buffer of `requested` bytes
+    // 用一次读取的结果（请求`requested`字节，实际读到`got`字节）更新历史
+    void record_read( size_t requested, size_t got );
+
     /*
      * 🔧 C++知识体系4：模板编程基础
      * 
@@ -253,10 +275,16 @@ protected:
    * - 考虑因素：CPU缓存大小、内存页大小、网络MTU
    */
   
-  // size of buffer to allocate for read()
-  // 为read()操作分配的缓冲区大小（16KB）
+  // initial size of buffer to allocate for read()
+  // 为read()操作分配的初始缓冲区大小（16KB）
   static constexpr size_t kReadBufferSize = 16384;
 
+  // Bounds on the adaptive read size: a descriptor that keeps filling its buffer grows toward kMaxReadSize,
+  // one that only ever sees small reads shrinks toward kMinReadSize.
+  // 自适应读取大小的上下限：持续读满缓冲区时增长到1MiB，一直只读到少量数据时缩小到512字节
+  static constexpr size_t kMinReadSize = 512;
+  static constexpr size_t kMaxReadSize = 1048576;
+
   void set_eof() { internal_fd_->eof_ = true; }
   void register_read() { ++internal_fd_->read_count_; }   // increment read count / 增加读取次数计数
   void register_write() { ++internal_fd_->write_count_; } // increment write count / 增加写入次数计数
@@ -344,9 +372,18 @@ public:
   
   // Read into `buffer`
   // 读取数据到缓冲区
+  // An empty `buffer` is sized adaptively for this descriptor (see read_size()), but never beyond kReadBufferSize:
+  // resizing a string zero-fills it, so larger reads are left to the pool and vector overloads.
+  // 空的`buffer`会按该描述符的历史自适应调整大小（见read_size()），但不超过kReadBufferSize：
+  // 字符串扩容会清零填充，更大的读取交给BufferPool和vector版本
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read into a recycled slab from `pool`, without allocating or zero-filling once the pool is warm.
+  // 读取到从`pool`回收的内存块中（内存池预热后无需分配内存，也不清零）
+  // Returns an empty buffer at EOF, or if a non-blocking fd has nothing to read.
+  PooledBuffer read( BufferPool& pool );
+
   // Attempt to write a buffer
   // 尝试写入缓冲区数据
   // returns number of bytes written
@@ -355,6 +392,24 @@ public:
   size_t write( const std::vector<std::string_view>& buffers );
   size_t write( const std::vector<Ref<std::string>>& buffers );
 
+  // Like read()/write(), but a failed syscall is returned as its errno instead of thrown (read() and
+  // write() are built on these). A read at EOF succeeds with 0 bytes and sets eof().
+  // 与read()/write()相同，但系统调用失败时返回errno而不是抛出异常（read()和write()基于它们实现）
+  IOResult try_read( std::string& buffer );
+  IOResult try_read( std::vector<std::string>& buffers );
+  IOResult try_read( BufferPool& pool, PooledBuffer& buffer ); // `buffer` is left empty at EOF or on failure
+  IOResult try_write( std::string_view buffer );
+  IOResult try_write( const std::vector<std::string_view>& buffers );
+
+  // Move up to `len` bytes from this fd to `out` inside the kernel, without copying through user space.
+  // 在内核中把最多`len`字节从本描述符移动到`out`，数据不经过用户空间
+  // splice_to: one of the two must be a pipe (see [splice(2)](\ref man2::splice)).
+  // sendfile_to: this fd must support mmap, e.g. a regular file (see [sendfile(2)](\ref man2::sendfile)).
+  // Both return the number of bytes moved. 0 means either EOF on this fd (eof() is set) or that one side
+  // would block.
+  size_t splice_to( FileDescriptor& out, size_t len );
+  size_t sendfile_to( FileDescriptor& out, size_t len );
+
   /*
    * 🔧 C++知识体系10：方法设计和const正确性
    * 
@@ -393,6 +448,9 @@ public:
   bool closed() const { return internal_fd_->closed_; }                   // closed flag state / 关闭标志状态
   unsigned int read_count() const { return internal_fd_->read_count_; }   // number of reads / 读取次数
   unsigned int write_count() const { return internal_fd_->write_count_; } // number of writes / 写入次数
+  size_t read_size() const { return internal_fd_->read_size_; }           // chosen read size / 当前选择的读取大小
+  size_t read_average() const { return internal_fd_->read_average_; }     // EWMA of bytes per read / 平均读取字节数
+  const FDStats* stats() const { return internal_fd_->stats_.get(); }       // null unless stats enabled / 未启用时为空
 
   /*
    * 🌐 计算机网络知识体系6：现代C++移动语义详解
@@ -439,6 +497,10 @@ public:
   FileDescriptor& operator=( FileDescriptor&& other ) = default;     // move assignment is allowed / 允许移动赋值
 };
 
+// Create a pipe: returns { read end, write end }
+// 创建管道：返回 { 读端, 写端 }
+std::pair<FileDescriptor, FileDescriptor> make_pipe();
+
 /*
  * 🎓 总结：这个FileDescriptor类的设计精髓
  * 
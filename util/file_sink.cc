@@ -0,0 +1,228 @@
+#include "file_sink.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+void FileSink::AlignedFree::operator()( char* p ) const
+{
+  ::operator delete[]( p, align_val_t { kPageSize } );
+}
+
+FileSink::FileSink( FileDescriptor file, size_t buffer_size, size_t buffer_count )
+  : file_( move( file ) )
+  , buffer_size_( max( ( buffer_size + kPageSize - 1 ) / kPageSize, size_t { 1 } ) * kPageSize )
+  , full_( max( buffer_count, size_t { 1 } ) + 1 ) // room for every buffer, plus the exit request
+  , spare_( max( buffer_count, size_t { 1 } ) )
+  , wakeup_( CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
+  , wakeup_fd_( wakeup_.fd_num() )
+{
+  const off_t offset = lseek( file_.fd_num(), 0, SEEK_CUR );
+  if ( offset < 0 ) {
+    throw unix_error { "lseek" };
+  }
+  next_offset_ = offset;
+
+  for ( size_t i = 0; i < max( buffer_count, size_t { 1 } ); ++i ) {
+    buffers_.emplace_back( static_cast<char*>( ::operator new[]( buffer_size_, align_val_t { kPageSize } ) ) );
+    spare_.push( buffers_.back().get() );
+  }
+
+  writer_ = thread { [this] { write_loop(); } };
+}
+
+FileSink::~FileSink()
+{
+  try {
+    close();
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    cerr << "Exception destructing FileSink: " << e.what() << "\n";
+  }
+}
+
+void FileSink::check_error() const
+{
+  if ( failed_.load( memory_order_acquire ) ) {
+    rethrow_exception( error_ );
+  }
+}
+
+size_t FileSink::push( string_view data )
+{
+  check_error();
+  if ( closed_ ) {
+    throw runtime_error( "FileSink::push() after close()" );
+  }
+
+  size_t accepted = 0;
+  while ( not data.empty() ) {
+    if ( not fill_ ) {
+      const auto spare = spare_.pop();
+      if ( not spare ) {
+        break; // every buffer is full or being written
+      }
+      fill_ = *spare;
+    }
+
+    const size_t n = min( data.size(), buffer_size_ - fill_size_ );
+    memcpy( fill_ + fill_size_, data.data(), n );
+    fill_size_ += n;
+    data.remove_prefix( n );
+    accepted += n;
+
+    if ( fill_size_ == buffer_size_ ) {
+      hand_off();
+    }
+  }
+
+  bytes_accepted_ += accepted;
+  return accepted;
+}
+
+void FileSink::hand_off()
+{
+  Chunk chunk { fill_, fill_size_, next_offset_ };
+  next_offset_ += fill_size_;
+  fill_ = nullptr;
+  fill_size_ = 0;
+  full_.push( chunk ); // can't fail: the queue has room for every buffer
+}
+
+void FileSink::flush()
+{
+  check_error();
+  if ( fill_size_ > 0 ) {
+    hand_off();
+  }
+}
+
+void FileSink::close()
+{
+  if ( closed_ ) {
+    return;
+  }
+  closed_ = true;
+
+  if ( fill_size_ > 0 ) {
+    hand_off();
+  }
+  full_.push( Chunk {} );
+  writer_.join();
+  check_error();
+}
+
+size_t FileSink::available_capacity() const
+{
+  if ( closed_ ) {
+    return 0;
+  }
+  return ( fill_ ? buffer_size_ - fill_size_ : 0 ) + spare_.size() * buffer_size_;
+}
+
+size_t FileSink::buffers_in_flight() const
+{
+  return buffers_.size() - spare_.size() - ( fill_ ? 1 : 0 );
+}
+
+// writer thread
+void FileSink::write_loop()
+{
+  vector<Chunk> batch;
+  vector<iovec> iovecs;
+  batch.reserve( kMaxBuffersPerWrite );
+  iovecs.reserve( kMaxBuffersPerWrite );
+
+  while ( true ) {
+    full_.wait();
+
+    bool exit = false;
+    batch.clear();
+    while ( batch.size() < kMaxBuffersPerWrite ) {
+      auto chunk = full_.pop();
+      if ( not chunk ) {
+        break;
+      }
+      if ( not chunk->data ) {
+        exit = true;
+        break;
+      }
+      batch.push_back( *chunk );
+    }
+
+    // after a failure, keep handing buffers back (unwritten) so the loop thread sees the error, not a stall
+    if ( not failed_.load( memory_order_relaxed ) ) {
+      try {
+        write_batch( batch, iovecs );
+      } catch ( ... ) {
+        error_ = current_exception();
+        failed_.store( true, memory_order_release );
+      }
+    }
+
+    for ( const Chunk& chunk : batch ) {
+      spare_.push( chunk.data );
+    }
+    if ( not batch.empty() ) {
+      const uint64_t one = 1;
+      if ( ::write( wakeup_fd_, &one, sizeof( one ) ) < 0 and errno != EAGAIN ) {
+        cerr << "FileSink: eventfd write: " << strerror( errno ) << "\n";
+      }
+    }
+
+    if ( exit ) {
+      return;
+    }
+  }
+}
+
+// writer thread: the chunks are consecutive in the file (each starts where the previous one ended)
+void FileSink::write_batch( vector<Chunk>& batch, vector<iovec>& iovecs )
+{
+  if ( batch.empty() ) {
+    return;
+  }
+
+  iovecs.clear();
+  for ( const Chunk& chunk : batch ) {
+    iovecs.push_back( { chunk.data, chunk.size } );
+  }
+
+  uint64_t offset = batch.front().offset;
+  size_t first = 0;
+  while ( first < iovecs.size() ) {
+    const ssize_t written = pwritev( file_.fd_num(),
+                                     &iovecs[first],
+                                     static_cast<int>( iovecs.size() - first ),
+                                     static_cast<off_t>( offset ) );
+    if ( written < 0 ) {
+      if ( errno == EINTR ) {
+        continue;
+      }
+      throw unix_error { "pwritev" };
+    }
+    if ( written == 0 ) {
+      throw runtime_error( "pwritev wrote nothing" );
+    }
+
+    offset += written;
+    bytes_written_.fetch_add( written, memory_order_release );
+    for ( auto remaining = static_cast<size_t>( written ); remaining > 0; ) {
+      iovec& iov = iovecs[first];
+      if ( remaining < iov.iov_len ) {
+        iov.iov_base = static_cast<char*>( iov.iov_base ) + remaining;
+        iov.iov_len -= remaining;
+        break;
+      }
+      remaining -= iov.iov_len;
+      ++first;
+    }
+  }
+}
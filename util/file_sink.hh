@@ -0,0 +1,169 @@
+#pragma once
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "ref.hh"
+#include "spsc_queue.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+// Appends a stream of bytes to a file without ever blocking the event loop on the disk.
+// 将字节流追加写入文件，事件循环永远不会因磁盘而阻塞
+//
+// Bytes pushed on the loop thread are copied into one of a fixed set of large, page-aligned buffers. Each
+// full buffer is handed to a background writer thread through an SPSCQueue, and the writer writes whatever
+// buffers are waiting with a single [pwritev(2)](\ref man2::pwritev) before handing them back. Buffers are
+// a multiple of the page size, so every write starts on a page boundary until a partial buffer is flushed.
+//
+// When every buffer is full or being written, the sink accepts nothing more: push() and pump() take only what
+// fits, which leaves the rest in the caller's ByteStream and so pushes back on whatever feeds it.
+//
+// All methods are for the loop thread. An error from the writer thread is rethrown by the next call.
+class FileSink
+{
+public:
+  static constexpr size_t kDefaultBufferSize = 1 << 20;
+  static constexpr size_t kDefaultBufferCount = 4;
+
+private:
+  static constexpr size_t kPageSize = 4096;
+  static constexpr size_t kMaxBuffersPerWrite = 64;
+
+  struct AlignedFree
+  {
+    void operator()( char* p ) const;
+  };
+
+  struct Chunk
+  {
+    char* data = nullptr; // nullptr tells the writer thread to exit
+    size_t size = 0;
+    uint64_t offset = 0;
+  };
+
+  FileDescriptor file_;
+  size_t buffer_size_;
+  std::vector<std::unique_ptr<char, AlignedFree>> buffers_ {};
+
+  SPSCQueue<Chunk> full_;  // loop thread -> writer thread
+  SPSCQueue<char*> spare_; // writer thread -> loop thread
+
+  FileDescriptor wakeup_; // eventfd, written by the writer thread each time it hands buffers back
+  int wakeup_fd_;         // the same, for the writer thread
+
+  char* fill_ = nullptr; // buffer being filled on the loop thread, if any
+  size_t fill_size_ = 0;
+  uint64_t next_offset_ = 0; // file offset of fill_[0]
+  uint64_t bytes_accepted_ = 0;
+  bool closed_ = false;
+
+  std::atomic<uint64_t> bytes_written_ { 0 };
+  std::atomic<bool> failed_ { false };
+  std::exception_ptr error_ {}; // written by the writer thread before it sets failed_
+
+  std::thread writer_ {};
+
+  void write_loop();
+  void write_batch( std::vector<Chunk>& batch, std::vector<iovec>& iovecs );
+  void hand_off();
+  void check_error() const;
+
+public:
+  // Appends to `file` (a regular file open for writing) from its current offset.
+  // 从`file`（以写方式打开的普通文件）的当前偏移量开始追加写入
+  explicit FileSink( FileDescriptor file,
+                     size_t buffer_size = kDefaultBufferSize,
+                     size_t buffer_count = kDefaultBufferCount );
+
+  // Closes the sink (see close()); an error is printed rather than thrown.
+  ~FileSink();
+
+  FileSink( const FileSink& other ) = delete;
+  FileSink& operator=( const FileSink& other ) = delete;
+  FileSink( FileSink&& other ) = delete;
+  FileSink& operator=( FileSink&& other ) = delete;
+
+  // Copy as much of `data` as there is buffer space for. Returns the number of bytes accepted.
+  // 拷贝缓冲区能容纳的部分数据，返回接受的字节数
+  size_t push( std::string_view data );
+  size_t push( const std::string& data ) { return push( std::string_view { data } ); }
+  size_t push( const Ref<std::string>& data ) { return push( data.get() ); }
+
+  // Move as many bytes as fit out of a ByteStream Reader. Returns the number of bytes moved.
+  template<class Reader>
+  size_t pump( Reader& source );
+
+  // Hand a partly filled buffer to the writer now instead of waiting for it to fill. Writes after a flush no
+  // longer start on page boundaries.
+  void flush();
+
+  // Flush, then wait for the writer thread to write everything and exit. Rethrows its error, if any.
+  void close();
+
+  // Drive the sink from `loop`: pump `source` whenever it has data and there is buffer space, and flush once
+  // it has finished. An fd rule on the sink's eventfd wakes the loop when the writer returns buffers.
+  template<class Reader>
+  void add_rules( EventLoop& loop, size_t category_id, Reader& source );
+
+  // Bytes push() could take right now.
+  size_t available_capacity() const;
+
+  // Buffers handed to the writer thread and not yet back.
+  size_t buffers_in_flight() const;
+
+  uint64_t bytes_accepted() const { return bytes_accepted_; }
+  uint64_t bytes_written() const { return bytes_written_.load( std::memory_order_acquire ); }
+  size_t buffer_size() const { return buffer_size_; }
+};
+
+template<class Reader>
+size_t FileSink::pump( Reader& source )
+{
+  size_t moved = 0;
+  while ( source.bytes_buffered() > 0 ) {
+    const std::string_view data = source.peek();
+    const size_t accepted = push( data );
+    source.pop( accepted );
+    moved += accepted;
+    if ( accepted < data.size() ) {
+      break;
+    }
+  }
+  return moved;
+}
+
+template<class Reader>
+void FileSink::add_rules( EventLoop& loop, size_t category_id, Reader& source )
+{
+  loop.add_rule(
+    category_id,
+    wakeup_,
+    Direction::In,
+    [this] {
+      std::string count( sizeof( uint64_t ), 0 );
+      wakeup_.try_read( count );
+      check_error();
+    },
+    [this] { return buffers_in_flight() > 0; } );
+
+  loop.add_rule(
+    category_id,
+    [this, &source] {
+      pump( source );
+      if ( source.is_finished() ) {
+        flush();
+      }
+    },
+    [this, &source] {
+      return ( source.bytes_buffered() > 0 and available_capacity() > 0 )
+             or ( source.is_finished() and fill_size_ > 0 );
+    } );
+}
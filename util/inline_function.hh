@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature, size_t Capacity = 56>
+class InlineFunction;
+
+// A copyable callable wrapper like std::function, but with room for `Capacity` bytes of captures inside the
+// object itself, so wrapping a typical lambda (a few references, a shared_ptr or two) never allocates.
+// 类似std::function的可复制函数包装器，但对象内部可容纳`Capacity`字节的捕获，常见lambda无需堆分配
+//
+// A callable that is too big, over-aligned or not nothrow-movable is kept on the heap instead, as
+// std::function would. With the default capacity, the wrapper fills one 64-byte cache line.
+template<typename R, typename... Args, size_t Capacity>
+class InlineFunction<R( Args... ), Capacity>
+{
+  struct Ops
+  {
+    R ( *invoke )( void* target, Args&&... args );
+    void ( *copy )( const void* from, void* to );
+    void ( *move )( void* from, void* to ); // leaves `from` destroyed
+    void ( *destroy )( void* target );
+  };
+
+  template<typename F>
+  static constexpr bool fits_inline = sizeof( F ) <= Capacity and alignof( F ) <= alignof( std::max_align_t )
+                                      and std::is_nothrow_move_constructible_v<F>;
+
+  template<typename F>
+  static constexpr Ops inline_ops {
+    []( void* target, Args&&... args ) -> R {
+      return std::invoke( *static_cast<F*>( target ), std::forward<Args>( args )... );
+    },
+    []( const void* from, void* to ) { new ( to ) F( *static_cast<const F*>( from ) ); },
+    []( void* from, void* to ) {
+      new ( to ) F( std::move( *static_cast<F*>( from ) ) );
+      static_cast<F*>( from )->~F();
+    },
+    []( void* target ) { static_cast<F*>( target )->~F(); } };
+
+  template<typename F>
+  static constexpr Ops heap_ops {
+    []( void* target, Args&&... args ) -> R {
+      return std::invoke( **static_cast<F**>( target ), std::forward<Args>( args )... );
+    },
+    []( const void* from, void* to ) { new ( to ) F*( new F( **static_cast<F* const*>( from ) ) ); },
+    []( void* from, void* to ) { new ( to ) F*( *static_cast<F**>( from ) ); },
+    []( void* target ) { delete *static_cast<F**>( target ); } };
+
+  alignas( std::max_align_t ) std::byte storage_[Capacity] {};
+  const Ops* ops_ {};
+
+public:
+  InlineFunction() = default;
+
+  template<typename F>
+    requires( not std::is_same_v<std::remove_cvref_t<F>, InlineFunction>
+              and std::is_invocable_r_v<R, std::remove_cvref_t<F>&, Args...> )
+  InlineFunction( F&& f ) // NOLINT(*-explicit-*)
+  {
+    using Target = std::remove_cvref_t<F>;
+    if constexpr ( fits_inline<Target> ) {
+      new ( storage_ ) Target( std::forward<F>( f ) );
+      ops_ = &inline_ops<Target>;
+    } else {
+      new ( storage_ ) Target*( new Target( std::forward<F>( f ) ) );
+      ops_ = &heap_ops<Target>;
+    }
+  }
+
+  InlineFunction( const InlineFunction& other ) : ops_( other.ops_ )
+  {
+    if ( ops_ ) {
+      ops_->copy( other.storage_, storage_ );
+    }
+  }
+
+  InlineFunction( InlineFunction&& other ) noexcept : ops_( std::exchange( other.ops_, nullptr ) )
+  {
+    if ( ops_ ) {
+      ops_->move( other.storage_, storage_ );
+    }
+  }
+
+  InlineFunction& operator=( const InlineFunction& other )
+  {
+    if ( this != &other ) {
+      InlineFunction copy { other };
+      *this = std::move( copy );
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=( InlineFunction&& other ) noexcept
+  {
+    if ( this != &other ) {
+      reset();
+      ops_ = std::exchange( other.ops_, nullptr );
+      if ( ops_ ) {
+        ops_->move( other.storage_, storage_ );
+      }
+    }
+    return *this;
+  }
+
+  ~InlineFunction() { reset(); }
+
+  void reset()
+  {
+    if ( ops_ ) {
+      std::exchange( ops_, nullptr )->destroy( storage_ );
+    }
+  }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  // Like std::function, calls the target as non-const even through a const wrapper.
+  R operator()( Args... args ) const
+  {
+    if ( not ops_ ) {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke( const_cast<std::byte*>( storage_ ), std::forward<Args>( args )... ); // NOLINT(*-const-cast)
+  }
+
+  // Whether a callable of type F is kept inside the wrapper (no allocation).
+  template<typename F>
+  static constexpr bool stores_inline()
+  {
+    return fits_inline<F>;
+  }
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "exception.hh"
+
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+
+// The outcome of an I/O call that reports failure instead of throwing it: the number of bytes transferred,
+// or the errno the call failed with.
+// 不抛出异常的I/O调用的结果：成功时为传输的字节数，失败时为errno
+//
+// Meant for hot loops, where routine failures (EAGAIN, or ECONNRESET and EPIPE from a peer that went away)
+// would otherwise each cost a trip through the exception unwinder.
+class IOResult
+{
+  size_t bytes_ = 0;
+  int error_ = 0;
+
+  IOResult( size_t bytes, int error ) : bytes_( bytes ), error_( error ) {}
+
+public:
+  static IOResult success( size_t bytes ) { return { bytes, 0 }; }
+  static IOResult failure( int error ) { return { 0, error }; }
+
+  // from a syscall's return value, reading errno if it failed
+  static IOResult from_syscall( ssize_t return_value )
+  {
+    return return_value >= 0 ? success( return_value ) : failure( errno );
+  }
+
+  bool ok() const { return error_ == 0; }
+  explicit operator bool() const { return ok(); }
+
+  size_t bytes() const { return bytes_; }
+  int error() const { return error_; }
+
+  // EAGAIN: a non-blocking descriptor isn't ready
+  bool would_block() const { return error_ == EAGAIN or error_ == EWOULDBLOCK or error_ == EINPROGRESS; }
+
+  // the other end of a connection has gone away
+  bool peer_closed() const { return error_ == ECONNRESET or error_ == EPIPE; }
+
+  // The throwing APIs are built on this: throws unix_error for a failure.
+  void throw_if_error( std::string_view attempt ) const
+  {
+    if ( error_ ) {
+      throw unix_error { attempt, error_ };
+    }
+  }
+};
@@ -0,0 +1,302 @@
+#include "io_uring.hh"
+#include "exception.hh"
+
+#include <atomic>
+#include <csignal>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+int io_uring_setup( unsigned int entries, io_uring_params& params )
+{
+  return static_cast<int>( syscall( __NR_io_uring_setup, entries, &params ) ); // NOLINT(*-vararg)
+}
+
+int io_uring_enter( int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags, void* arg, size_t argsz )
+{
+  return static_cast<int>(
+    syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz ) ); // NOLINT(*-vararg)
+}
+
+int io_uring_register( int fd, unsigned int opcode, const void* arg, unsigned int nr_args )
+{
+  return static_cast<int>( syscall( __NR_io_uring_register, fd, opcode, arg, nr_args ) ); // NOLINT(*-vararg)
+}
+
+void* map_ring( int ring_fd, size_t length, off_t offset )
+{
+  void* addr = mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset );
+  if ( addr == MAP_FAILED ) { // NOLINT(*-cstyle-cast, *-int-to-ptr)
+    throw unix_error { "mmap(io_uring)" };
+  }
+  return addr;
+}
+
+template<typename T>
+T* at_offset( void* base, uint32_t offset )
+{
+  return reinterpret_cast<T*>( static_cast<char*>( base ) + offset ); // NOLINT(*-reinterpret-cast)
+}
+
+} // namespace
+
+IoUring::File IoUring::File::registered( unsigned int index )
+{
+  File ret { static_cast<int>( index ) };
+  ret.fixed = true;
+  return ret;
+}
+
+int IoUring::setup( unsigned int entries, io_uring_params& params )
+{
+  return CheckSystemCall( "io_uring_setup", io_uring_setup( entries, params ) );
+}
+
+IoUring::IoUring( unsigned int entries ) : ring_fd_( setup( entries, params_ ) )
+{
+  // EXT_ARG (Linux 5.11) is needed for timed waits; NODROP (5.5) means completions are never lost
+  if ( not( params_.features & IORING_FEAT_EXT_ARG ) or not( params_.features & IORING_FEAT_NODROP ) ) {
+    throw runtime_error( "io_uring: kernel lacks IORING_FEAT_EXT_ARG or IORING_FEAT_NODROP" );
+  }
+
+  sq_ring_.length = params_.sq_off.array + params_.sq_entries * sizeof( unsigned );
+  cq_ring_.length = params_.cq_off.cqes + params_.cq_entries * sizeof( io_uring_cqe );
+  sqes_.length = params_.sq_entries * sizeof( io_uring_sqe );
+
+  const bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+  if ( single_mmap ) {
+    sq_ring_.length = cq_ring_.length = max( sq_ring_.length, cq_ring_.length );
+  }
+
+  try {
+    sq_ring_.addr = map_ring( ring_fd_.fd_num(), sq_ring_.length, IORING_OFF_SQ_RING );
+    cq_ring_.addr = single_mmap ? sq_ring_.addr : map_ring( ring_fd_.fd_num(), cq_ring_.length, IORING_OFF_CQ_RING );
+    sqes_.addr = map_ring( ring_fd_.fd_num(), sqes_.length, IORING_OFF_SQES );
+  } catch ( ... ) {
+    unmap();
+    throw;
+  }
+
+  sq_head_ = at_offset<unsigned>( sq_ring_.addr, params_.sq_off.head );
+  sq_tail_ = at_offset<unsigned>( sq_ring_.addr, params_.sq_off.tail );
+  sq_array_ = at_offset<unsigned>( sq_ring_.addr, params_.sq_off.array );
+  sq_mask_ = *at_offset<unsigned>( sq_ring_.addr, params_.sq_off.ring_mask );
+  sq_entries_ = *at_offset<unsigned>( sq_ring_.addr, params_.sq_off.ring_entries );
+  sqe_array_ = static_cast<io_uring_sqe*>( sqes_.addr );
+
+  cq_head_ = at_offset<unsigned>( cq_ring_.addr, params_.cq_off.head );
+  cq_tail_ = at_offset<unsigned>( cq_ring_.addr, params_.cq_off.tail );
+  cq_mask_ = *at_offset<unsigned>( cq_ring_.addr, params_.cq_off.ring_mask );
+  cqe_array_ = at_offset<io_uring_cqe>( cq_ring_.addr, params_.cq_off.cqes );
+
+  local_tail_ = *sq_tail_;
+}
+
+void IoUring::unmap()
+{
+  for ( auto* m : { &sqes_, &cq_ring_, &sq_ring_ } ) {
+    if ( m->addr and ( m == &sq_ring_ or m->addr != sq_ring_.addr ) ) {
+      munmap( m->addr, m->length );
+    }
+    m->addr = nullptr;
+  }
+}
+
+IoUring::~IoUring()
+{
+  unmap(); // the kernel cancels anything still in flight when ring_fd_ is closed
+}
+
+bool IoUring::supported()
+{
+  static const bool ret = [] {
+    try {
+      const IoUring ring { 2 };
+      return true;
+    } catch ( const exception& ) {
+      return false;
+    }
+  }();
+  return ret;
+}
+
+io_uring_sqe& IoUring::next_sqe( uint8_t opcode, File file, uint64_t user_data )
+{
+  if ( queued() >= sq_entries_ ) {
+    submit(); // full: hand what we have to the kernel
+    if ( queued() >= sq_entries_ ) {
+      throw runtime_error( "io_uring: submission queue full and the kernel is taking no entries" );
+    }
+  }
+
+  const unsigned index = local_tail_ & sq_mask_;
+  sq_array_[index] = index; // NOLINT(*-pointer-arithmetic)
+  ++local_tail_;
+
+  io_uring_sqe& sqe = sqe_array_[index]; // NOLINT(*-pointer-arithmetic)
+  sqe = {};
+  sqe.opcode = opcode;
+  sqe.fd = file.fd;
+  sqe.flags = file.fixed ? IOSQE_FIXED_FILE : 0;
+  sqe.user_data = user_data;
+  return sqe;
+}
+
+void IoUring::prepare_read( File file, span<char> buffer, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_READ, file, user_data );
+  sqe.addr = reinterpret_cast<uint64_t>( buffer.data() ); // NOLINT(*-reinterpret-cast)
+  sqe.len = buffer.size();
+  sqe.off = -1; // current file position (or none, for pipes and sockets)
+}
+
+void IoUring::prepare_read_fixed( File file, span<char> buffer, unsigned int buffer_index, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_READ_FIXED, file, user_data );
+  sqe.addr = reinterpret_cast<uint64_t>( buffer.data() ); // NOLINT(*-reinterpret-cast)
+  sqe.len = buffer.size();
+  sqe.off = -1;
+  sqe.buf_index = buffer_index;
+}
+
+void IoUring::prepare_writev( File file, span<const iovec> buffers, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_WRITEV, file, user_data );
+  sqe.addr = reinterpret_cast<uint64_t>( buffers.data() ); // NOLINT(*-reinterpret-cast)
+  sqe.len = buffers.size();
+  sqe.off = -1;
+}
+
+void IoUring::prepare_accept( File file, uint64_t user_data )
+{
+  next_sqe( IORING_OP_ACCEPT, file, user_data ); // peer address not requested
+}
+
+void IoUring::prepare_connect( File file, const Address& address, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_CONNECT, file, user_data );
+  sqe.addr = reinterpret_cast<uint64_t>( static_cast<const sockaddr*>( address.raw() ) ); // NOLINT(*-reinterpret-cast)
+  sqe.off = address.size();
+}
+
+void IoUring::prepare_poll_add( File file, uint32_t poll_mask, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_POLL_ADD, file, user_data );
+  sqe.poll32_events = poll_mask;
+}
+
+void IoUring::prepare_poll_remove( uint64_t target_user_data, uint64_t user_data )
+{
+  auto& sqe = next_sqe( IORING_OP_POLL_REMOVE, -1, user_data );
+  sqe.addr = target_user_data;
+}
+
+size_t IoUring::queued() const
+{
+  // the kernel moves the head past each entry it consumes, whether it was submitted by this call or an earlier one
+  return local_tail_ - atomic_ref { *sq_head_ }.load( memory_order_acquire );
+}
+
+void IoUring::submit( unsigned int wait_for, int timeout_ms )
+{
+  atomic_ref { *sq_tail_ }.store( local_tail_, memory_order_release );
+
+  unsigned int flags = 0;
+  __kernel_timespec timeout {};
+  io_uring_getevents_arg arg {};
+  void* argp = nullptr;
+  size_t argsz = 0;
+
+  if ( wait_for > 0 and timeout_ms >= 0 ) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = ( timeout_ms % 1000 ) * 1000000L;
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>( &timeout ); // NOLINT(*-reinterpret-cast)
+    flags |= IORING_ENTER_EXT_ARG;
+    argp = &arg;
+    argsz = sizeof( arg );
+  }
+
+  bool stalled = false; // the kernel took none of the entries: leave them queued, but still wait
+  while ( true ) {
+    const unsigned int to_submit = stalled ? 0 : queued();
+    if ( to_submit == 0 and wait_for == 0 ) {
+      return;
+    }
+
+    const int ret = io_uring_enter(
+      ring_fd_.fd_num(), to_submit, wait_for, flags | ( wait_for > 0 ? IORING_ENTER_GETEVENTS : 0 ), argp, argsz );
+    if ( ret < 0 ) {
+      if ( errno == ETIME or errno == EINTR ) {
+        wait_for = 0; // timed out (or interrupted) waiting: just submit whatever is left
+        continue;
+      }
+      if ( errno == EBUSY or errno == EAGAIN ) {
+        // completion queue overflow (or no memory for the requests): make room, then try again
+        if ( reap() == 0 ) {
+          throw unix_error { "io_uring_enter" };
+        }
+        wait_for = 0; // there are completions to hand out already
+        continue;
+      }
+      throw unix_error { "io_uring_enter" };
+    }
+
+    if ( static_cast<unsigned int>( ret ) == to_submit ) {
+      return; // all submitted, and (if asked) waited for
+    }
+    // short submission: the kernel skips the wait, so go round again for the rest (or just the wait)
+    stalled = ret == 0;
+  }
+}
+
+size_t IoUring::reap()
+{
+  const size_t before = reaped_.size();
+  unsigned head = *cq_head_;
+  const unsigned tail = atomic_ref { *cq_tail_ }.load( memory_order_acquire );
+  for ( ; head != tail; ++head ) {
+    const io_uring_cqe& cqe = cqe_array_[head & cq_mask_]; // NOLINT(*-pointer-arithmetic)
+    reaped_.push_back( { cqe.user_data, cqe.res, cqe.flags } );
+  }
+  atomic_ref { *cq_head_ }.store( head, memory_order_release );
+  return reaped_.size() - before;
+}
+
+optional<IoUring::Completion> IoUring::next_completion()
+{
+  if ( not reaped_.empty() ) {
+    const Completion ret = reaped_.front();
+    reaped_.pop_front();
+    return ret;
+  }
+
+  const unsigned head = *cq_head_;
+  if ( head == atomic_ref { *cq_tail_ }.load( memory_order_acquire ) ) {
+    return {};
+  }
+
+  const io_uring_cqe& cqe = cqe_array_[head & cq_mask_]; // NOLINT(*-pointer-arithmetic)
+  const Completion ret { cqe.user_data, cqe.res, cqe.flags };
+  atomic_ref { *cq_head_ }.store( head + 1, memory_order_release );
+  return ret;
+}
+
+void IoUring::register_buffers( span<const iovec> buffers )
+{
+  io_uring_register( ring_fd_.fd_num(), IORING_UNREGISTER_BUFFERS, nullptr, 0 ); // ENXIO if none: fine
+  CheckSystemCall( "io_uring_register(BUFFERS)",
+                   io_uring_register( ring_fd_.fd_num(), IORING_REGISTER_BUFFERS, buffers.data(), buffers.size() ) );
+}
+
+void IoUring::register_files( span<const int> fds )
+{
+  io_uring_register( ring_fd_.fd_num(), IORING_UNREGISTER_FILES, nullptr, 0 ); // ENXIO if none: fine
+  CheckSystemCall( "io_uring_register(FILES)",
+                   io_uring_register( ring_fd_.fd_num(), IORING_REGISTER_FILES, fds.data(), fds.size() ) );
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "address.hh"
+#include "file_descriptor.hh"
+
+#include <cstdint>
+#include <deque>
+#include <linux/io_uring.h>
+#include <optional>
+#include <span>
+#include <sys/uio.h>
+
+// A submission/completion queue pair shared with the kernel (see io_uring(7)), driven with raw syscalls.
+// 与内核共享的提交/完成队列对（见io_uring(7)），直接通过系统调用驱动
+//
+// Operations are queued with the prepare_*() methods and handed to the kernel together by submit(), which
+// is one io_uring_enter(2) call no matter how many operations are queued. Each operation carries a
+// caller-chosen 64-bit tag that comes back with its Completion. Buffers (and the iovec arrays and
+// addresses passed to prepare_writev() and prepare_connect()) must stay valid until the operation completes.
+class IoUring
+{
+public:
+  // The outcome of one operation: `result` is what the equivalent syscall would return, or -errno.
+  // 一个操作的结果：`result`与对应系统调用的返回值相同，失败时为-errno
+  struct Completion
+  {
+    uint64_t user_data;
+    int32_t result;
+    uint32_t flags;
+  };
+
+  // A descriptor operand: either an fd number, or an index into the table passed to register_files().
+  // 描述符操作数：普通fd编号，或register_files()注册表中的下标（fixed file）
+  struct File
+  {
+    int fd;
+    bool fixed = false;
+
+    File( int fd_num ) : fd( fd_num ) {} // NOLINT(*-explicit-*)
+    File( const FileDescriptor& f ) : fd( f.fd_num() ) {} // NOLINT(*-explicit-*)
+    static File registered( unsigned int index );
+  };
+
+private:
+  struct Mapping
+  {
+    void* addr = nullptr;
+    size_t length = 0;
+  };
+
+  io_uring_params params_ {};
+  FileDescriptor ring_fd_;
+  Mapping sq_ring_ {};
+  Mapping cq_ring_ {}; // same as sq_ring_ when the kernel supports IORING_FEAT_SINGLE_MMAP
+  Mapping sqes_ {};
+
+  // pointers into the shared rings
+  unsigned* sq_head_ {};
+  unsigned* sq_tail_ {};
+  unsigned* sq_array_ {};
+  unsigned sq_mask_ {};
+  unsigned sq_entries_ {};
+  io_uring_sqe* sqe_array_ {};
+  unsigned* cq_head_ {};
+  unsigned* cq_tail_ {};
+  unsigned cq_mask_ {};
+  io_uring_cqe* cqe_array_ {};
+
+  unsigned local_tail_ {}; // SQ entries prepared but not yet published to the kernel
+
+  // completions taken off the ring by submit() to make room (CQ overflow), handed out first by next_completion()
+  std::deque<Completion> reaped_ {};
+
+  static int setup( unsigned int entries, io_uring_params& params );
+  void unmap();
+
+  io_uring_sqe& next_sqe( uint8_t opcode, File file, uint64_t user_data );
+  size_t reap();
+
+public:
+  // Throws unix_error if the kernel refuses (ENOSYS, EPERM under seccomp or io_uring_disabled...).
+  explicit IoUring( unsigned int entries = 256 );
+  ~IoUring();
+
+  IoUring( const IoUring& other ) = delete;
+  IoUring& operator=( const IoUring& other ) = delete;
+  IoUring( IoUring&& other ) = delete;
+  IoUring& operator=( IoUring&& other ) = delete;
+
+  // Whether this kernel can run an IoUring (checked once per process).
+  // 当前内核是否支持io_uring（每个进程只检查一次）
+  static bool supported();
+
+  // Queue an operation. If the submission queue is full, the queued operations are submitted first.
+  // 将操作加入队列；如果提交队列已满，会先提交已排队的操作
+  void prepare_read( File file, std::span<char> buffer, uint64_t user_data );
+  void prepare_read_fixed( File file, std::span<char> buffer, unsigned int buffer_index, uint64_t user_data );
+  void prepare_writev( File file, std::span<const iovec> buffers, uint64_t user_data );
+  void prepare_accept( File file, uint64_t user_data );
+  void prepare_connect( File file, const Address& address, uint64_t user_data );
+  void prepare_poll_add( File file, uint32_t poll_mask, uint64_t user_data );
+  void prepare_poll_remove( uint64_t target_user_data, uint64_t user_data );
+
+  // Hand every queued operation to the kernel, then wait until at least `wait_for` operations have
+  // completed or `timeout_ms` has passed (a negative timeout waits indefinitely). Usually one
+  // io_uring_enter(2): if the kernel takes only some of the operations, the rest are submitted again, and
+  // if the completion queue has overflowed (EBUSY), completions are reaped first. A wait interrupted by a
+  // signal returns early, once everything has been submitted.
+  // 提交所有排队的操作，并等待至少`wait_for`个操作完成或超时（通常一次io_uring_enter系统调用）
+  void submit( unsigned int wait_for = 0, int timeout_ms = -1 );
+
+  // Take the next completion, if any, without blocking.
+  std::optional<Completion> next_completion();
+
+  // Operations prepared but not yet consumed by the kernel.
+  size_t queued() const;
+
+  // Pin buffers (for prepare_read_fixed()) or descriptors (for File::registered()) in the kernel, so each
+  // operation doesn't have to map them again. Replaces any previous registration.
+  // 在内核中预先注册缓冲区或描述符，避免每次操作重复映射
+  void register_buffers( std::span<const iovec> buffers );
+  void register_files( std::span<const int> fds );
+};
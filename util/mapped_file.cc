@@ -0,0 +1,89 @@
+#include "mapped_file.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+MappedFile::MappedFile( FileDescriptor fd, Access access ) : fd_( move( fd ) ), size_( fd_.size() )
+{
+  if ( size_ == 0 ) {
+    return; // mmap(2) refuses zero-length mappings
+  }
+
+  void* addr = mmap( nullptr, size_, PROT_READ, MAP_SHARED, fd_.fd_num(), 0 );
+  if ( addr == MAP_FAILED ) { // NOLINT(*-cstyle-cast, *-int-to-ptr)
+    throw unix_error { "mmap" };
+  }
+  data_ = static_cast<const char*>( addr );
+
+  // only hints: a kernel that ignores them still gives a working mapping
+  if ( access == Access::Sequential ) {
+    madvise( addr, size_, MADV_SEQUENTIAL );
+    madvise( addr, size_, MADV_WILLNEED );
+  } else {
+    madvise( addr, size_, MADV_RANDOM );
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if ( data_ ) {
+    munmap( const_cast<char*>( data_ ), size_ ); // NOLINT(*-const-cast)
+  }
+}
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+  : fd_( move( other.fd_ ) ), data_( exchange( other.data_, nullptr ) ), size_( exchange( other.size_, 0 ) )
+{}
+
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept
+{
+  if ( this != &other ) {
+    if ( data_ ) {
+      munmap( const_cast<char*>( data_ ), size_ ); // NOLINT(*-const-cast)
+    }
+    fd_ = move( other.fd_ );
+    data_ = exchange( other.data_, nullptr );
+    size_ = exchange( other.size_, 0 );
+  }
+  return *this;
+}
+
+string_view MappedFile::window( size_t offset, size_t length ) const
+{
+  return view().substr( min( offset, size_ ), length );
+}
+
+vector<string_view> MappedFile::windows( size_t length ) const
+{
+  if ( length == 0 ) {
+    throw runtime_error( "MappedFile::windows() called with zero length" );
+  }
+
+  vector<string_view> ret;
+  ret.reserve( ( size_ + length - 1 ) / length );
+  for ( size_t offset = 0; offset < size_; offset += length ) {
+    ret.push_back( window( offset, length ) );
+  }
+  return ret;
+}
+
+void MappedFile::prefetch( size_t offset, size_t length ) const
+{
+  const string_view w = window( offset, length );
+  if ( w.empty() ) {
+    return;
+  }
+
+  // madvise(2) wants a page-aligned start
+  const auto page = static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+  const auto start = reinterpret_cast<uintptr_t>( w.data() ) & ~( page - 1 ); // NOLINT(*-reinterpret-cast)
+  const auto end = reinterpret_cast<uintptr_t>( w.data() + w.size() );       // NOLINT(*-reinterpret-cast)
+  madvise( reinterpret_cast<void*>( start ), end - start, MADV_WILLNEED );   // NOLINT(*-reinterpret-cast, *-int-to-ptr)
+}
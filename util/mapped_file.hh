@@ -0,0 +1,59 @@
+#pragma once
+
+#include "file_descriptor.hh"
+#include "parser.hh"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// A file's contents, mapped read-only into memory with [mmap(2)](\ref man2::mmap).
+// 以只读方式映射到内存中的文件内容（使用mmap(2)）
+//
+// The bytes are read straight out of the page cache: views, windows and Parsers over them involve no
+// user-space copies, and neither does writing them to a socket. Views are valid for the MappedFile's
+// lifetime. The file must not be truncated while it is mapped (accessing pages past the new end raises
+// SIGBUS).
+class MappedFile
+{
+public:
+  // How the file will be read, passed to the kernel with [madvise(2)](\ref man2::madvise).
+  enum class Access : uint8_t
+  {
+    Sequential, //!< MADV_SEQUENTIAL | MADV_WILLNEED: aggressive read-ahead, pages dropped soon after use
+    Random      //!< MADV_RANDOM: no read-ahead
+  };
+
+private:
+  FileDescriptor fd_;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+
+public:
+  // Map all of `fd` (a regular file open for reading). An empty file maps to an empty view.
+  // 映射整个`fd`（以读方式打开的普通文件）；空文件得到空的视图
+  explicit MappedFile( FileDescriptor fd, Access access = Access::Sequential );
+  ~MappedFile();
+
+  MappedFile( const MappedFile& other ) = delete;
+  MappedFile& operator=( const MappedFile& other ) = delete;
+  MappedFile( MappedFile&& other ) noexcept;
+  MappedFile& operator=( MappedFile&& other ) noexcept;
+
+  size_t size() const { return size_; }
+  std::string_view view() const { return { data_, size_ }; }
+
+  // Up to `length` bytes starting at `offset` (shorter at the end of the file, empty past it).
+  // 从`offset`开始最多`length`字节的窗口（到文件末尾时更短，超出末尾时为空）
+  std::string_view window( size_t offset, size_t length ) const;
+
+  // The whole file as consecutive windows of at most `length` bytes, e.g. for
+  // FileDescriptor::write(const std::vector<std::string_view>&).
+  std::vector<std::string_view> windows( size_t length ) const;
+
+  // A Parser reading the window in place.
+  Parser parser( size_t offset = 0, size_t length = SIZE_MAX ) const { return Parser { window( offset, length ) }; }
+
+  // Ask the kernel to start reading a window in now (MADV_WILLNEED), e.g. just ahead of a sequential reader.
+  void prefetch( size_t offset, size_t length ) const;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// An unbounded, lock-free queue from any number of producer threads to one consumer thread, drained in batches.
+// 多生产者单消费者的无界无锁队列，消费者一次取走全部元素
+//
+// Producers push onto an atomic stack with a compare-and-swap; the consumer takes the whole stack with one
+// exchange and reverses it, so it sees items in the order they were pushed. push() says whether the queue was
+// empty, so a producer only needs to wake the consumer for the first item of each batch. Each item costs one
+// allocation (its node).
+template<typename T>
+class MPSCQueue
+{
+  struct Node
+  {
+    T value;
+    Node* next;
+  };
+
+  alignas( 64 ) std::atomic<Node*> top_ { nullptr }; // most recently pushed
+
+public:
+  MPSCQueue() = default;
+  MPSCQueue( const MPSCQueue& other ) = delete;
+  MPSCQueue& operator=( const MPSCQueue& other ) = delete;
+  MPSCQueue( MPSCQueue&& other ) = delete;
+  MPSCQueue& operator=( MPSCQueue&& other ) = delete;
+
+  ~MPSCQueue()
+  {
+    Node* node = top_.load( std::memory_order_acquire );
+    while ( node ) {
+      delete std::exchange( node, node->next );
+    }
+  }
+
+  // Any thread: returns whether the queue was empty before this item.
+  template<typename U>
+  bool push( U&& value )
+  {
+    Node* const node = new Node { T( std::forward<U>( value ) ), top_.load( std::memory_order_relaxed ) };
+    while ( not top_.compare_exchange_weak( node->next, node, std::memory_order_release, std::memory_order_relaxed ) ) {
+    }
+    return node->next == nullptr;
+  }
+
+  // Consumer: calls `f` on each item queued so far, oldest first, and returns how many there were. Items
+  // pushed meanwhile (including by `f`) are left for the next call. If `f` throws, the items after that one stay
+  // queued, ahead of any pushed since.
+  template<typename F>
+  size_t drain( F&& f )
+  {
+    Node* oldest = reverse( top_.exchange( nullptr, std::memory_order_acquire ) );
+
+    size_t count = 0;
+    while ( oldest ) {
+      Node* const node = oldest;
+      oldest = node->next;
+      try {
+        f( node->value );
+      } catch ( ... ) {
+        delete node;
+        requeue( oldest );
+        throw;
+      }
+      delete node;
+      ++count;
+    }
+    return count;
+  }
+
+  // Any thread, but only a hint from a producer.
+  bool empty() const { return top_.load( std::memory_order_acquire ) == nullptr; }
+
+private:
+  static Node* reverse( Node* list )
+  {
+    Node* reversed = nullptr;
+    while ( list ) {
+      Node* const next = list->next;
+      list->next = reversed;
+      reversed = list;
+      list = next;
+    }
+    return reversed;
+  }
+
+  // puts back the unvisited rest of a batch (oldest first) below whatever has been pushed since
+  void requeue( Node* oldest )
+  {
+    Node* chain = reverse( oldest ); // newest first, like the stack
+
+    while ( chain ) {
+      if ( Node* const pushed = top_.exchange( nullptr, std::memory_order_acquire ) ) {
+        Node* last = pushed;
+        while ( last->next ) {
+          last = last->next;
+        }
+        last->next = chain;
+        chain = pushed;
+      }
+      Node* expected = nullptr;
+      if ( top_.compare_exchange_strong( expected, chain, std::memory_order_release, std::memory_order_relaxed ) ) {
+        return;
+      }
+    }
+  }
+};
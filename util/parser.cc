@@ -0,0 +1,144 @@
+#include "parser.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+string_view Parser::BufferList::peek() const
+{
+  if ( buffer_.empty() ) {
+    throw runtime_error( "Parser::BufferList::peek() called on empty BufferList" );
+  }
+  return buffer_.front().view;
+}
+
+void Parser::BufferList::remove_prefix( uint64_t len )
+{
+  if ( len > size_ ) {
+    throw runtime_error( "Parser::BufferList::remove_prefix() called with len > size" );
+  }
+
+  size_ -= len;
+  while ( len > 0 ) {
+    string_view& front = buffer_.front().view;
+    if ( len < front.size() ) {
+      front.remove_prefix( len );
+      return;
+    }
+    len -= front.size();
+    buffer_.pop_front();
+  }
+}
+
+void Parser::BufferList::truncate( size_t len )
+{
+  if ( len >= size_ ) {
+    return;
+  }
+
+  size_ = len;
+  uint64_t kept = 0;
+  for ( auto it = buffer_.begin(); it != buffer_.end(); ++it ) {
+    if ( kept + it->view.size() >= len ) {
+      it->view = it->view.substr( 0, len - kept );
+      buffer_.erase( it->view.empty() ? it : next( it ), buffer_.end() );
+      return;
+    }
+    kept += it->view.size();
+  }
+}
+
+void Parser::BufferList::dump_all( vector<Ref<std::string>>& out )
+{
+  out.clear();
+  for ( auto& [view, owner] : buffer_ ) {
+    if ( not owner ) {
+      out.emplace_back( std::string { view } ); // borrowed memory: the caller gets a copy
+      continue;
+    }
+
+    // trim the owned string down to the unparsed part, if any was parsed or truncated away
+    std::string& str = owner->get_mut();
+    const auto offset = static_cast<size_t>( view.data() - str.data() );
+    const size_t length = view.size();
+    if ( offset != 0 or length != str.size() ) {
+      str.resize( offset + length );
+      str.erase( 0, offset );
+    }
+    out.push_back( move( *owner ) );
+  }
+  buffer_.clear();
+  size_ = 0;
+}
+
+vector<string_view> Parser::BufferList::buffer() const
+{
+  vector<string_view> ret;
+  ret.reserve( buffer_.size() );
+  for ( const auto& segment : buffer_ ) {
+    ret.push_back( segment.view );
+  }
+  return ret;
+}
+
+void Parser::string( span<char> out )
+{
+  check_size( out.size() );
+  if ( has_error() ) {
+    return;
+  }
+
+  auto dest = out.begin();
+  while ( dest != out.end() ) {
+    const auto view = input_.peek().substr( 0, out.end() - dest );
+    dest = copy( view.begin(), view.end(), dest );
+    input_.remove_prefix( view.size() );
+  }
+}
+
+void Parser::concatenate_all_remaining( std::string& out )
+{
+  out.clear();
+  out.reserve( input_.size() );
+  for ( const auto view : input_.buffer() ) {
+    out.append( view );
+  }
+  input_.remove_prefix( input_.size() );
+}
+
+void Serializer::flush()
+{
+  if ( not buffer_.empty() ) {
+    output_.emplace_back( move( buffer_ ) );
+    buffer_.clear();
+  }
+}
+
+void Serializer::buffer( std::string buf )
+{
+  flush();
+  if ( not buf.empty() ) {
+    output_.emplace_back( move( buf ) );
+  }
+}
+
+void Serializer::buffer( Ref<std::string> buf )
+{
+  flush();
+  if ( not buf.get().empty() ) {
+    output_.push_back( move( buf ) );
+  }
+}
+
+void Serializer::buffer( const vector<Ref<std::string>>& bufs )
+{
+  for ( const auto& buf : bufs ) {
+    buffer( buf.borrow() );
+  }
+}
+
+vector<Ref<std::string>> Serializer::finish()
+{
+  flush();
+  return move( output_ );
+}
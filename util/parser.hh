@@ -2,9 +2,11 @@
 
 #include "ref.hh"
 
+#include <array>
 #include <concepts>
 #include <cstdint>
 #include <deque>
+#include <optional>
 #include <ranges>
 #include <span>
 #include <stdexcept>
@@ -16,20 +18,42 @@ class Parser
 {
   class BufferList
   {
+    struct Segment
+    {
+      std::string_view view;                 // the unparsed bytes
+      std::optional<Ref<std::string>> owner; // holds them (empty if the input was string_views)
+    };
+
     uint64_t size_ {};
-    std::deque<Ref<std::string>> buffer_ {};
-    uint64_t skip_ {};
+    std::deque<Segment> buffer_ {};
 
   public:
     explicit BufferList( std::ranges::range auto&& buffers )
       requires std::is_convertible_v<decltype( std::move( *buffers.begin() ) ), Ref<std::string>>
     {
       for ( auto&& x : buffers ) {
-        buffer_.emplace_back( std::move( x ) );
-        if ( buffer_.back().is_borrowed() ) {
+        Ref<std::string> buf { std::move( x ) };
+        if ( buf.is_borrowed() ) {
           throw std::runtime_error( "cannot parse borrowed string" );
         }
-        size_ += buffer_.back()->size();
+        if ( buf.get().empty() ) {
+          continue;
+        }
+        size_ += buf.get().size();
+        buffer_.push_back( { {}, std::move( buf ) } );
+        buffer_.back().view = buffer_.back().owner->get(); // after the move: a short string's bytes move too
+      }
+    }
+
+    // Parse memory owned by someone else (e.g. a MappedFile) in place; it must outlive the Parser.
+    explicit BufferList( std::ranges::range auto&& views )
+      requires std::same_as<std::ranges::range_value_t<decltype( views )>, std::string_view>
+    {
+      for ( const std::string_view view : views ) {
+        if ( not view.empty() ) {
+          size_ += view.size();
+          buffer_.push_back( { view, {} } );
+        }
       }
     }
 
@@ -57,6 +81,7 @@ class Parser
 
 public:
   explicit Parser( std::ranges::range auto&& input ) : input_( std::forward<decltype( input )>( input ) ) {}
+  explicit Parser( std::string_view input ) : input_( std::array { input } ) {}
 
   bool has_error() const { return error_; }
   void set_error() { error_ = true; }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// A doubly-linked list whose elements live in a slab: fixed blocks of slots that are allocated 64 at a time and
+// reused through a free list, so adding an element costs no allocation in the steady state. Elements never
+// move, and are addressed by slot index as well as by iterator.
+// 元素存放在slab中的双向链表：插入通常无需分配内存，元素地址固定不变
+//
+// Erasing an element bumps its slot's generation, so a Handle (index and generation) taken earlier can be
+// checked for staleness even after the slot has been reused. Iterators stay valid until their own element is
+// erased, across insertions, move_to_back() and detach() of any element.
+//
+// A detached element stays in the slab (reachable by iterator, index or handle) but is skipped by iteration.
+// A slot index, and the generation of the element that was in it
+struct SlabHandle
+{
+  uint32_t index = std::numeric_limits<uint32_t>::max();
+  uint32_t generation = 0;
+};
+
+template<typename T>
+class SlabList
+{
+public:
+  static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+  using Handle = SlabHandle;
+
+private:
+  static constexpr uint32_t kBlockBits = 6;
+  static constexpr uint32_t kBlockSize = 1 << kBlockBits;
+
+  struct Slot
+  {
+    std::optional<T> value {};
+    uint32_t generation = 0;
+    uint32_t prev = kNone;
+    uint32_t next = kNone; // in the list, or in the free list when empty
+    bool linked = false;   // in the list (not detached)
+  };
+
+  using Block = std::array<Slot, kBlockSize>;
+
+  std::vector<std::unique_ptr<Block>> blocks_ {};
+  uint32_t head_ = kNone;
+  uint32_t tail_ = kNone;
+  uint32_t free_ = kNone;
+  size_t size_ = 0;
+
+  Slot& slot( uint32_t index ) { return ( *blocks_[index >> kBlockBits] )[index & ( kBlockSize - 1 )]; }
+  const Slot& slot( uint32_t index ) const
+  {
+    return ( *blocks_[index >> kBlockBits] )[index & ( kBlockSize - 1 )];
+  }
+
+  void unlink( uint32_t index )
+  {
+    Slot& s = slot( index );
+    ( s.prev == kNone ? head_ : slot( s.prev ).next ) = s.next;
+    ( s.next == kNone ? tail_ : slot( s.next ).prev ) = s.prev;
+    s.linked = false;
+  }
+
+  void link_back( uint32_t index )
+  {
+    Slot& s = slot( index );
+    s.prev = tail_;
+    s.next = kNone;
+    s.linked = true;
+    ( tail_ == kNone ? head_ : slot( tail_ ).next ) = index;
+    tail_ = index;
+  }
+
+public:
+  class iterator
+  {
+    friend class SlabList;
+
+    SlabList* list_ = nullptr;
+    uint32_t index_ = kNone;
+
+    iterator( SlabList* list, uint32_t index ) : list_( list ), index_( index ) {}
+
+  public:
+    iterator() = default;
+
+    T& operator*() const { return *list_->slot( index_ ).value; }
+    T* operator->() const { return &*list_->slot( index_ ).value; }
+
+    iterator& operator++()
+    {
+      index_ = list_->slot( index_ ).next;
+      return *this;
+    }
+
+    uint32_t index() const { return index_; }
+
+    bool operator==( const iterator& other ) const { return index_ == other.index_; }
+  };
+
+  SlabList() = default;
+  SlabList( const SlabList& other ) = delete;
+  SlabList& operator=( const SlabList& other ) = delete;
+  SlabList( SlabList&& other ) = delete; // iterators point to the list
+  SlabList& operator=( SlabList&& other ) = delete;
+  ~SlabList() = default;
+
+  iterator begin() { return { this, head_ }; }
+  iterator end() { return { this, kNone }; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Construct an element at the back of the list.
+  template<typename... Args>
+  iterator emplace_back( Args&&... args )
+  {
+    if ( free_ == kNone ) {
+      const auto first = static_cast<uint32_t>( blocks_.size() * kBlockSize );
+      blocks_.push_back( std::make_unique<Block>() );
+      for ( uint32_t i = kBlockSize; i-- > 0; ) {
+        slot( first + i ).next = free_;
+        free_ = first + i;
+      }
+    }
+
+    const uint32_t index = free_;
+    Slot& s = slot( index );
+    s.value.emplace( std::forward<Args>( args )... );
+    free_ = s.next;
+    link_back( index );
+    ++size_;
+    return { this, index };
+  }
+
+  // Destroy an element; returns the iterator to the one after it.
+  iterator erase( iterator it )
+  {
+    const uint32_t index = it.index_;
+    Slot& s = slot( index );
+    const uint32_t next = s.linked ? s.next : kNone;
+    if ( s.linked ) {
+      unlink( index );
+    }
+    s.value.reset();
+    ++s.generation;
+    s.next = free_;
+    free_ = index;
+    --size_;
+    return { this, next };
+  }
+
+  // Move an element to the back of the list (unless detached).
+  void move_to_back( iterator it )
+  {
+    if ( slot( it.index_ ).linked and it.index_ != tail_ ) {
+      unlink( it.index_ );
+      link_back( it.index_ );
+    }
+  }
+
+  // Take an element out of iteration, keeping it in the slab until erased.
+  void detach( iterator it )
+  {
+    if ( slot( it.index_ ).linked ) {
+      unlink( it.index_ );
+    }
+  }
+
+  Handle handle( iterator it ) const { return { it.index_, slot( it.index_ ).generation }; }
+
+  // The element in slot `index`, if any.
+  T* at_index( uint32_t index )
+  {
+    if ( index >= blocks_.size() * kBlockSize ) {
+      return nullptr;
+    }
+    auto& value = slot( index ).value;
+    return value ? &*value : nullptr;
+  }
+
+  // The element `handle` was taken from, unless it has since been erased.
+  T* find( Handle handle )
+  {
+    const iterator it = locate( handle );
+    return it == end() ? nullptr : &*it;
+  }
+
+  // (the same, as an iterator: end() if erased)
+  iterator locate( Handle handle )
+  {
+    const bool current = at_index( handle.index ) and slot( handle.index ).generation == handle.generation;
+    return { this, current ? handle.index : kNone };
+  }
+};
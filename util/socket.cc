@@ -2,8 +2,13 @@
 
 #include "exception.hh"
 
+#include <array>
+#include <cstring>
+#include <linux/errqueue.h>
 #include <linux/if_packet.h>
+#include <netinet/in.h>
 #include <stdexcept>
+#include <sys/uio.h>
 
 using namespace std;
 
@@ -158,9 +163,31 @@ void TCPSocket::listen( const int backlog )
 //! \returns a new TCPSocket connected to the peer.
 //! \note This function blocks until a new connection is available
 TCPSocket TCPSocket::accept()
+{
+  optional<TCPSocket> connection;
+  try_accept( connection ).throw_if_error( "accept" );
+  return move( *connection );
+}
+
+// accept a new incoming connection, reporting failure (e.g. EAGAIN or ECONNABORTED) without throwing
+//! \param[out] connection is set to the new TCPSocket on success
+IOResult TCPSocket::try_accept( optional<TCPSocket>& connection )
 {
   register_read();
-  return TCPSocket( FileDescriptor( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) ) );
+  const int fd = ::accept( fd_num(), nullptr, nullptr );
+  if ( fd < 0 ) {
+    return IOResult::failure( errno );
+  }
+  connection.emplace( TCPSocket( FileDescriptor( fd ) ) );
+  return IOResult::success( 0 );
+}
+
+// accept a new incoming connection without allocating
+//! \returns an FDHandle for the connection (see fd_handle.hh)
+FDHandle TCPSocket::accept_handle()
+{
+  register_read();
+  return FDHandle( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) );
 }
 
 // get socket option
@@ -196,6 +223,12 @@ void Socket::set_reuseaddr()
   setsockopt( SOL_SOCKET, SO_REUSEADDR, int { true } );
 }
 
+// allow other sockets to bind the same address and port, sharing incoming connections
+void Socket::set_reuseport()
+{
+  setsockopt( SOL_SOCKET, SO_REUSEPORT, int { true } );
+}
+
 void Socket::throw_if_error() const
 {
   int socket_error = 0;
@@ -209,6 +242,65 @@ void Socket::throw_if_error() const
   }
 }
 
+void Socket::set_zerocopy()
+{
+  setsockopt( SOL_SOCKET, SO_ZEROCOPY, int { true } );
+}
+
+// send buffers with sendmsg(2)
+//! \param[in] buffers are sent in order, as with FileDescriptor::write
+//! \param[in] flags are passed to sendmsg(2), e.g. MSG_ZEROCOPY
+size_t Socket::sendmsg( const vector<string_view>& buffers, const int flags )
+{
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  for ( const auto x : buffers ) {
+    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
+  }
+
+  msghdr message {};
+  message.msg_iov = iovecs.data();
+  message.msg_iovlen = iovecs.size();
+
+  const ssize_t bytes_sent = CheckSystemCall( "sendmsg", ::sendmsg( fd_num(), &message, flags ) );
+  register_write();
+  return bytes_sent;
+}
+
+// read the error queue until a MSG_ZEROCOPY notification turns up (other messages are discarded)
+//! \returns the completion, or nothing if the error queue is empty
+optional<Socket::ZeroCopyCompletion> Socket::recv_zerocopy_completion()
+{
+  while ( true ) {
+    array<char, CMSG_SPACE( sizeof( sock_extended_err ) )> control {};
+    msghdr message {};
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    // the error queue never blocks: EAGAIN just means it's empty
+    if ( ::recvmsg( fd_num(), &message, MSG_ERRQUEUE ) < 0 ) {
+      if ( errno == EAGAIN ) {
+        return {};
+      }
+      throw unix_error { "recvmsg(MSG_ERRQUEUE)" };
+    }
+    register_read();
+
+    for ( cmsghdr* cm = CMSG_FIRSTHDR( &message ); cm; cm = CMSG_NXTHDR( &message, cm ) ) {
+      const bool recverr = ( cm->cmsg_level == SOL_IP and cm->cmsg_type == IP_RECVERR )
+                           or ( cm->cmsg_level == SOL_IPV6 and cm->cmsg_type == IPV6_RECVERR );
+      if ( not recverr ) {
+        continue;
+      }
+      sock_extended_err err {};
+      memcpy( &err, CMSG_DATA( cm ), sizeof( err ) );
+      if ( err.ee_errno == 0 and err.ee_origin == SO_EE_ORIGIN_ZEROCOPY ) {
+        return ZeroCopyCompletion { err.ee_info, err.ee_data, ( err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED ) != 0 };
+      }
+    }
+  }
+}
+
 void PacketSocket::set_promiscuous()
 {
   setsockopt( SOL_PACKET,
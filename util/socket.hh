@@ -1,9 +1,13 @@
 #pragma once
 
 #include "address.hh"
+#include "fd_handle.hh"
 #include "file_descriptor.hh"
 
 #include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
 #include <sys/socket.h>
 
 /*
@@ -142,11 +146,41 @@ public:
   //! \note 这可以避免 "Address already in use" 错误，特别是在服务器重启时
   void set_reuseaddr();
 
+  //! Let several sockets bind the same address and port via [SO_REUSEPORT](\ref man7::socket); the kernel
+  //! spreads incoming connections (or datagrams) across them
+  //! 通过 [SO_REUSEPORT] 选项允许多个套接字绑定同一地址和端口，由内核在它们之间分配新连接
+  //! \note 每个套接字都必须在 bind() 之前设置此选项
+  void set_reuseport();
+
   //! Check for errors (will be seen on non-blocking sockets)
   //! 检查套接字错误（主要用于非阻塞套接字）
   //! \throws 如果套接字有错误，抛出相应异常
   //! \note 非阻塞套接字的错误可能不会立即报告，需要主动检查
   void throw_if_error() const;
+
+  //! Allow [MSG_ZEROCOPY](https://docs.kernel.org/networking/msg_zerocopy.html) sends (sets SO_ZEROCOPY)
+  //! 允许使用 MSG_ZEROCOPY 发送（设置 SO_ZEROCOPY）
+  //! \throws unix_error if the kernel doesn't support it for this socket
+  void set_zerocopy();
+
+  //! Send `buffers` with [sendmsg(2)](\ref man2::sendmsg), passing `flags` (such as MSG_ZEROCOPY)
+  //! 用 sendmsg(2) 发送 `buffers`，并传入 `flags`（例如 MSG_ZEROCOPY）
+  //! \returns the number of bytes sent (0 if a non-blocking socket would block)
+  size_t sendmsg( const std::vector<std::string_view>& buffers, int flags = 0 );
+
+  //! The kernel is done with the buffers of MSG_ZEROCOPY sends `first` through `last` (inclusive). The kernel
+  //! numbers a socket's successful zerocopy sends from 0. `copied` means it had to copy the data anyway.
+  //! MSG_ZEROCOPY 完成通知：编号 `first` 到 `last`（含）的发送已不再使用其缓冲区
+  struct ZeroCopyCompletion
+  {
+    uint32_t first;
+    uint32_t last;
+    bool copied;
+  };
+
+  //! Take the next MSG_ZEROCOPY completion from the socket's error queue, if any (never blocks)
+  //! 从套接字的错误队列中取出下一个 MSG_ZEROCOPY 完成通知（不会阻塞）
+  std::optional<ZeroCopyCompletion> recv_zerocopy_completion();
 };
 
 //! \brief Datagram socket class for connectionless communication
@@ -296,6 +330,15 @@ public:
   //! \note 这是阻塞调用，会等待直到有客户端连接
   //! \note 服务器使用这个函数来处理客户端连接请求
   TCPSocket accept();
+
+  //! Accept a new incoming connection into `connection`, returning the errno instead of throwing on failure
+  //! 接受新的传入连接并存入 `connection`；失败时返回 errno 而不是抛出异常
+  //! \note accept() is built on this
+  IOResult try_accept( std::optional<TCPSocket>& connection );
+
+  //! Accept a new incoming connection as a heap-free FDHandle (no allocation per connection)
+  //! 接受新的传入连接，返回不分配堆内存的 FDHandle
+  FDHandle accept_handle();
 };
 
 //! A wrapper around [packet sockets](\ref man7:packet)
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// A bounded, lock-free queue between exactly one producer thread and one consumer thread.
+// 单生产者单消费者的有界无锁队列
+//
+// The capacity is rounded up to a power of two. Neither side ever blocks, except a consumer that asks to
+// with wait(), which sleeps on the tail index (a futex) until the producer pushes.
+template<typename T>
+class SPSCQueue
+{
+  std::vector<T> slots_;
+  size_t mask_;
+
+  alignas( 64 ) std::atomic<size_t> head_ { 0 }; // next slot to pop; written by the consumer
+  alignas( 64 ) std::atomic<size_t> tail_ { 0 }; // next slot to push; written by the producer
+
+public:
+  explicit SPSCQueue( size_t capacity )
+    : slots_( std::bit_ceil( std::max<size_t>( capacity, 1 ) ) ), mask_( slots_.size() - 1 )
+  {}
+
+  // Producer: false (and `value` not moved from) if the queue is full.
+  template<typename U>
+  bool push( U&& value )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - head_.load( std::memory_order_acquire ) == slots_.size() ) {
+      return false;
+    }
+    slots_[tail & mask_] = std::forward<U>( value );
+    tail_.store( tail + 1, std::memory_order_release );
+    tail_.notify_one();
+    return true;
+  }
+
+  // Consumer: the oldest item, if any.
+  std::optional<T> pop()
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head == tail_.load( std::memory_order_acquire ) ) {
+      return std::nullopt;
+    }
+    std::optional<T> ret { std::move( slots_[head & mask_] ) };
+    head_.store( head + 1, std::memory_order_release );
+    return ret;
+  }
+
+  // Consumer: sleep until the queue is not empty.
+  void wait() const
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    tail_.wait( head, std::memory_order_acquire );
+  }
+
+  // Exact on the consumer's thread; from the producer it may overstate (items popped meanwhile).
+  size_t size() const { return tail_.load( std::memory_order_acquire ) - head_.load( std::memory_order_acquire ); }
+  bool empty() const { return size() == 0; }
+  size_t capacity() const { return slots_.size(); }
+};
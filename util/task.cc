@@ -0,0 +1,139 @@
+#include "task.hh"
+
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+void* Task::promise_type::operator new( const size_t size )
+{
+  return FramePool::local().allocate( size );
+}
+
+void Task::promise_type::operator delete( void* const frame, const size_t size )
+{
+  FramePool::local().deallocate( frame, size );
+}
+
+Task::Task( Task&& other ) noexcept : handle_( exchange( other.handle_, nullptr ) ) {}
+
+Task& Task::operator=( Task&& other ) noexcept
+{
+  if ( this != &other ) {
+    if ( handle_ ) {
+      handle_.destroy();
+    }
+    handle_ = exchange( other.handle_, nullptr );
+  }
+  return *this;
+}
+
+Task::~Task()
+{
+  if ( handle_ ) {
+    handle_.destroy();
+  }
+}
+
+void Task::start( TaskList& list ) &&
+{
+  if ( not handle_ ) {
+    throw runtime_error( "Task: no coroutine to start" );
+  }
+  const Handle handle = exchange( handle_, nullptr );
+  list.link( handle.promise() );
+  resume( handle );
+}
+
+void Task::resume( const Handle handle )
+{
+  handle.resume();
+  if ( not handle.done() ) {
+    return;
+  }
+
+  auto& promise = handle.promise();
+  const exception_ptr error = move( promise.error_ );
+  if ( promise.list_ ) {
+    promise.list_->unlink( promise );
+  }
+  handle.destroy();
+  if ( error ) {
+    rethrow_exception( error );
+  }
+}
+
+void TaskList::link( Task::promise_type& promise )
+{
+  promise.list_ = this;
+  promise.prev_ = nullptr;
+  promise.next_ = head_;
+  if ( head_ ) {
+    head_->prev_ = &promise;
+  }
+  head_ = &promise;
+  ++size_;
+}
+
+void TaskList::unlink( Task::promise_type& promise )
+{
+  ( promise.prev_ ? promise.prev_->next_ : head_ ) = promise.next_;
+  if ( promise.next_ ) {
+    promise.next_->prev_ = promise.prev_;
+  }
+  promise.list_ = nullptr;
+  --size_;
+}
+
+TaskList::~TaskList()
+{
+  // each frame's locals are destroyed with it, and may still refer to the loop: it's the loop's first member to go
+  while ( head_ ) {
+    Task::promise_type& promise = *head_;
+    unlink( promise );
+    Task::Handle::from_promise( promise ).destroy();
+  }
+}
+
+FramePool::~FramePool()
+{
+  for ( FreeFrame*& head : free_ ) {
+    while ( head ) {
+      ::operator delete( exchange( head, head->next ) );
+    }
+  }
+}
+
+void* FramePool::allocate( const size_t size )
+{
+  const size_t size_class = ( size + kClassSize - 1 ) / kClassSize - 1;
+  if ( size_class >= kClasses ) {
+    return ::operator new( size );
+  }
+
+  if ( FreeFrame* const frame = free_[size_class] ) {
+    free_[size_class] = frame->next;
+    --cached_;
+    return frame;
+  }
+  return ::operator new( ( size_class + 1 ) * kClassSize );
+}
+
+void FramePool::deallocate( void* const frame, const size_t size )
+{
+  const size_t size_class = ( size + kClassSize - 1 ) / kClassSize - 1;
+  if ( size_class >= kClasses ) {
+    ::operator delete( frame );
+    return;
+  }
+
+  free_[size_class] = new ( frame ) FreeFrame { free_[size_class] };
+  ++cached_;
+}
+
+FramePool& FramePool::local()
+{
+  thread_local FramePool pool;
+  return pool;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+class TaskList;
+
+// A coroutine run by an EventLoop (see EventLoop::spawn): it starts when spawned, and from then on is resumed
+// by the loop, straight from the callback of whatever it awaits (EventLoop::sleep, AsyncFD::readable and
+// AsyncFD::writable). Its frame is destroyed when it finishes, or with the loop if it never does.
+// 由EventLoop运行的协程：从等待对象的回调中直接恢复执行
+//
+// An exception that escapes the coroutine comes out of the call that resumed it: EventLoop::spawn, or
+// EventLoop::wait_next_event. Frames come from a per-thread pool of recycled blocks, so starting a task in the
+// steady state costs no allocation.
+class Task
+{
+public:
+  class promise_type
+  {
+    friend class Task;
+    friend class TaskList;
+
+    std::exception_ptr error_ {};
+    TaskList* list_ = nullptr; // the loop's list of live tasks, once spawned
+    promise_type* prev_ = nullptr;
+    promise_type* next_ = nullptr;
+
+  public:
+    promise_type() = default;
+    promise_type( const promise_type& other ) = delete;
+    promise_type& operator=( const promise_type& other ) = delete;
+    promise_type( promise_type&& other ) = delete;
+    promise_type& operator=( promise_type&& other ) = delete;
+    ~promise_type() = default;
+
+    Task get_return_object() { return Task { Handle::from_promise( *this ) }; }
+    std::suspend_always initial_suspend() noexcept { return {}; } // until spawned
+    std::suspend_always final_suspend() noexcept { return {}; }   // destroyed by Task::resume
+    void return_void() {}
+    void unhandled_exception() { error_ = std::current_exception(); }
+
+    // frames are recycled through the thread's FramePool
+    static void* operator new( size_t size );
+    static void operator delete( void* frame, size_t size );
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+private:
+  Handle handle_;
+
+  explicit Task( Handle handle ) : handle_( handle ) {}
+
+public:
+  Task( const Task& other ) = delete;
+  Task& operator=( const Task& other ) = delete;
+  Task( Task&& other ) noexcept;
+  Task& operator=( Task&& other ) noexcept;
+  ~Task(); // destroys the coroutine if it was never spawned
+
+  //! Gives up the coroutine to `list`, and runs it to its first suspension.
+  void start( TaskList& list ) &&;
+
+  //! Continues a spawned coroutine. If that finishes it, destroys it, rethrowing any exception that escaped.
+  static void resume( Handle handle );
+};
+
+// The live (spawned and unfinished) tasks of an EventLoop, linked through their promises.
+// Destroying the list destroys their frames.
+class TaskList
+{
+  friend class Task;
+
+  Task::promise_type* head_ = nullptr;
+  size_t size_ = 0;
+
+  void link( Task::promise_type& promise );
+  void unlink( Task::promise_type& promise );
+
+public:
+  TaskList() = default;
+  TaskList( const TaskList& other ) = delete;
+  TaskList& operator=( const TaskList& other ) = delete;
+  TaskList( TaskList&& other ) = delete;
+  TaskList& operator=( TaskList&& other ) = delete;
+  ~TaskList();
+
+  size_t size() const { return size_; }
+};
+
+// Recycles coroutine frames on one thread: freed frames are kept on a free list per 64-byte size class (up to
+// kMaxPooled bytes) and handed out again, so a coroutine that is started over and over, such as a connection
+// handler, allocates its frame once. Larger frames go straight to the allocator.
+// 协程帧内存池：按64字节大小分级回收
+class FramePool
+{
+  static constexpr size_t kClassSize = 64;
+  static constexpr size_t kMaxPooled = 4096;
+  static constexpr size_t kClasses = kMaxPooled / kClassSize;
+
+  struct FreeFrame
+  {
+    FreeFrame* next;
+  };
+
+  std::array<FreeFrame*, kClasses> free_ {};
+  size_t cached_ = 0;
+
+public:
+  FramePool() = default;
+  FramePool( const FramePool& other ) = delete;
+  FramePool& operator=( const FramePool& other ) = delete;
+  FramePool( FramePool&& other ) = delete;
+  FramePool& operator=( FramePool&& other ) = delete;
+  ~FramePool();
+
+  void* allocate( size_t size );
+  void deallocate( void* frame, size_t size );
+
+  size_t cached() const { return cached_; } // freed frames waiting to be reused
+
+  //! The calling thread's pool.
+  static FramePool& local();
+};
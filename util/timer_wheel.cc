@@ -0,0 +1,142 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+vector<TimerWheel::Timer*>& TimerWheel::bucket( const Timer& timer )
+{
+  return timer.level_ == kLevels ? due_ : slots_[timer.level_][timer.slot_];
+}
+
+// Put an unarmed timer in the finest level whose range (relative to now_) covers its deadline.
+void TimerWheel::place( Timer& timer )
+{
+  if ( timer.deadline_ <= now_ ) {
+    timer.level_ = kLevels;
+  } else {
+    timer.level_ = kLevels - 1;
+    for ( unsigned int level = 0; level < kLevels; ++level ) {
+      const unsigned int shift = level * kSlotBits;
+      if ( ( timer.deadline_ >> shift ) - ( now_ >> shift ) < kSlots ) {
+        timer.level_ = level;
+        break;
+      }
+    }
+
+    const unsigned int shift = timer.level_ * kSlotBits;
+    // past the top level's range: wait in its furthest slot, to be placed again when that cascades
+    const uint64_t position = min( timer.deadline_ >> shift, ( now_ >> shift ) + kSlots - 1 );
+    timer.slot_ = position & ( kSlots - 1 );
+    occupied_[timer.level_] |= uint64_t { 1 } << timer.slot_;
+  }
+
+  auto& timers = bucket( timer );
+  timer.index_ = timers.size();
+  timers.push_back( &timer );
+  timer.armed_ = true;
+}
+
+void TimerWheel::remove( Timer& timer )
+{
+  auto& timers = bucket( timer );
+  Timer* const last = timers.back();
+  timers[timer.index_] = last;
+  last->index_ = timer.index_;
+  timers.pop_back();
+  if ( timers.empty() and timer.level_ < kLevels ) {
+    occupied_[timer.level_] &= ~( uint64_t { 1 } << timer.slot_ );
+  }
+  timer.armed_ = false;
+}
+
+void TimerWheel::arm( Timer& timer, uint64_t deadline )
+{
+  if ( timer.armed_ ) {
+    remove( timer );
+  } else {
+    ++size_;
+  }
+  timer.deadline_ = deadline;
+  place( timer );
+}
+
+void TimerWheel::cancel( Timer& timer )
+{
+  if ( timer.armed_ ) {
+    remove( timer );
+    --size_;
+  }
+}
+
+// The next tick after now_ at which a level-0 slot expires or a coarser slot cascades.
+optional<uint64_t> TimerWheel::next_event() const
+{
+  optional<uint64_t> ret;
+  for ( unsigned int level = 0; level < kLevels; ++level ) {
+    if ( not occupied_[level] ) {
+      continue;
+    }
+    const unsigned int shift = level * kSlotBits;
+    const uint64_t position = now_ >> shift;
+    // distance (1 to kSlots) from the current slot to the next occupied one, going round the wheel
+    const auto rotated = rotr( occupied_[level], static_cast<int>( ( position + 1 ) & ( kSlots - 1 ) ) );
+    const uint64_t tick = ( position + countr_zero( rotated ) + 1 ) << shift;
+    ret = ret ? min( *ret, tick ) : tick;
+  }
+  return ret;
+}
+
+optional<uint64_t> TimerWheel::next_wakeup() const
+{
+  if ( not due_.empty() ) {
+    return now_;
+  }
+  return next_event();
+}
+
+void TimerWheel::advance( uint64_t now, vector<Timer*>& expired )
+{
+  const auto expire = [&]( vector<Timer*>& timers ) {
+    for ( Timer* const timer : timers ) {
+      timer->armed_ = false;
+      expired.push_back( timer );
+    }
+    size_ -= timers.size();
+    timers.clear();
+  };
+
+  expire( due_ );
+
+  // jump from one occupied slot to the next; nothing happens in between
+  for ( auto tick = next_event(); tick and *tick <= now; tick = next_event() ) {
+    now_ = *tick;
+
+    for ( unsigned int level = kLevels - 1; level > 0; --level ) {
+      const unsigned int shift = level * kSlotBits;
+      if ( now_ & ( ( uint64_t { 1 } << shift ) - 1 ) ) {
+        continue; // not at the start of a slot on this level
+      }
+      const auto slot = ( now_ >> shift ) & ( kSlots - 1 );
+      if ( not( occupied_[level] & ( uint64_t { 1 } << slot ) ) ) {
+        continue;
+      }
+      occupied_[level] &= ~( uint64_t { 1 } << slot );
+      cascading_.swap( slots_[level][slot] ); // nothing cascades back into the slot being emptied
+      for ( Timer* const timer : cascading_ ) {
+        place( *timer );
+      }
+      cascading_.clear();
+    }
+
+    const auto slot = now_ & ( kSlots - 1 );
+    if ( occupied_[0] & ( uint64_t { 1 } << slot ) ) {
+      occupied_[0] &= ~( uint64_t { 1 } << slot );
+      expire( slots_[0][slot] );
+    }
+    expire( due_ );
+  }
+
+  now_ = max( now_, now );
+}
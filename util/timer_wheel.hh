@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// A hierarchical timing wheel: timers are armed and cancelled in O(1), and advancing the clock costs time
+// proportional to the timers that expire (plus a cascade step for each timer on a coarser level), not to the
+// number of ticks elapsed or of timers armed.
+// 分层时间轮：定时器的设置与取消都是O(1)
+//
+// Time is counted in ticks of whatever length the owner chooses. Level 0 has one slot per tick for the next 64
+// ticks; each level above has slots 64 times as long. A timer sits in the finest level whose range covers its
+// deadline, and moves down a level ("cascades") when the clock reaches the start of its slot, so all timers in
+// a level-0 slot expire together, in one batch.
+//
+// The wheel does not own its timers: a Timer must stay alive (and not move) while it is armed.
+class TimerWheel
+{
+public:
+  static constexpr unsigned int kSlotBits = 6;
+  static constexpr unsigned int kSlots = 1 << kSlotBits;
+  static constexpr unsigned int kLevels = 6; // 2^36 ticks; later deadlines wait on the top level
+
+  class Timer
+  {
+    friend class TimerWheel;
+
+    uint64_t deadline_ = 0;
+    uint32_t index_ = 0; // position in its slot
+    uint8_t level_ = 0;  // kLevels: in the due list
+    uint8_t slot_ = 0;
+    bool armed_ = false;
+
+  public:
+    uint64_t deadline() const { return deadline_; }
+    bool armed() const { return armed_; }
+  };
+
+private:
+  uint64_t now_;
+  std::array<std::array<std::vector<Timer*>, kSlots>, kLevels> slots_ {};
+  std::array<uint64_t, kLevels> occupied_ {}; // bit s set: slot s is not empty
+  std::vector<Timer*> due_ {};                // deadline already reached when armed or cascaded
+  std::vector<Timer*> cascading_ {};          // scratch space for advance()
+  size_t size_ = 0;
+
+  std::vector<Timer*>& bucket( const Timer& timer );
+  void place( Timer& timer );
+  void remove( Timer& timer );
+  std::optional<uint64_t> next_event() const;
+
+public:
+  explicit TimerWheel( uint64_t now ) : now_( now ) {}
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; } // armed timers
+
+  // Arm (or re-arm) `timer` to expire at `deadline`. A deadline that has passed expires on the next advance().
+  void arm( Timer& timer, uint64_t deadline );
+
+  // Disarm `timer`, if armed.
+  void cancel( Timer& timer );
+
+  // The tick by which advance() must next be called for timers to expire on time: the earliest deadline, or
+  // earlier, when timers need to cascade first. Empty if nothing is armed.
+  std::optional<uint64_t> next_wakeup() const;
+
+  // Move the clock forward to `now`, disarming the timers whose deadlines have been reached and appending them to
+  // `expired` in order of deadline.
+  void advance( uint64_t now, std::vector<Timer*>& expired );
+};
@@ -0,0 +1,147 @@
+#include "zerocopy.hh"
+
+#include "exception.hh"
+
+#include <sys/socket.h>
+
+using namespace std;
+
+ZeroCopySender::ZeroCopySender( Socket& socket, size_t threshold ) : socket_( socket ), threshold_( threshold )
+{
+  try {
+    socket_.set_zerocopy();
+  } catch ( const unix_error& ) {
+    zerocopy_ = false; // e.g. EOPNOTSUPP on a Unix-domain socket, or a kernel without SO_ZEROCOPY
+  }
+}
+
+void ZeroCopySender::push( Ref<string> buffer )
+{
+  if ( buffer.get().empty() ) {
+    return;
+  }
+  if ( buffer.is_borrowed() ) {
+    buffer = Ref<string> { string { buffer.get() } };
+  }
+  buffered_bytes_ += buffer.get().size();
+  queue_.push_back( { move( buffer ) } );
+}
+
+size_t ZeroCopySender::flush()
+{
+  size_t total_sent = 0;
+
+  while ( first_unsent_ < queue_.size() ) {
+    views_.clear();
+    size_t bytes = 0;
+    for ( size_t i = first_unsent_; i < queue_.size() and views_.size() < kMaxBuffersPerSend; ++i ) {
+      views_.emplace_back( queue_[i].buffer.get() );
+      if ( i == first_unsent_ ) {
+        views_.back().remove_prefix( offset_ );
+      }
+      bytes += views_.back().size();
+    }
+
+    bool zerocopy = zerocopy_ and bytes >= threshold_;
+    size_t sent = 0;
+    try {
+      sent = socket_.sendmsg( views_, zerocopy ? MSG_ZEROCOPY : 0 );
+    } catch ( const unix_error& e ) {
+      if ( not zerocopy or e.error_code() != ENOBUFS ) {
+        throw;
+      }
+      zerocopy = false; // out of memory for pinning pages (optmem or locked-memory limit): copy this one
+      sent = socket_.sendmsg( views_ );
+    }
+
+    if ( sent == 0 ) {
+      break; // the socket is full
+    }
+
+    if ( zerocopy ) {
+      ++zerocopy_sends_;
+      in_flight_.push_back( false );
+    } else {
+      ++copying_sends_;
+    }
+
+    total_sent += sent;
+    buffered_bytes_ -= sent;
+    for ( size_t remaining = sent; remaining > 0; ) {
+      Entry& entry = queue_[first_unsent_];
+      if ( zerocopy ) {
+        entry.pinned = true;
+        entry.last_send = next_send_;
+      }
+      const size_t available = entry.buffer.get().size() - offset_;
+      if ( remaining < available ) {
+        offset_ += remaining;
+        break;
+      }
+      remaining -= available;
+      offset_ = 0;
+      ++first_unsent_;
+    }
+    next_send_ += zerocopy;
+
+    if ( sent < bytes ) {
+      break;
+    }
+  }
+
+  release_sent();
+  return total_sent;
+}
+
+size_t ZeroCopySender::reap()
+{
+  size_t count = 0;
+  while ( const auto completion = socket_.recv_zerocopy_completion() ) {
+    ++count;
+    for ( uint32_t send = completion->first;; ++send ) {
+      const uint32_t index = send - oldest_in_flight_;
+      if ( index < in_flight_.size() ) {
+        in_flight_[index] = true;
+      }
+      if ( send == completion->last ) {
+        break;
+      }
+    }
+
+    if ( completion->copied ) {
+      // the data was copied after all, so pinning only added cost: stop using MSG_ZEROCOPY on this socket
+      ++copied_by_kernel_;
+      zerocopy_ = false;
+    }
+  }
+
+  while ( not in_flight_.empty() and in_flight_.front() ) {
+    in_flight_.pop_front();
+    ++oldest_in_flight_;
+  }
+
+  release_sent();
+  return count;
+}
+
+bool ZeroCopySender::send_complete( uint32_t send ) const
+{
+  const uint32_t index = send - oldest_in_flight_; // wraps around for sends older than the oldest in flight
+  return index >= in_flight_.size() or in_flight_[index];
+}
+
+void ZeroCopySender::release_sent()
+{
+  while ( first_unsent_ > 0 and ( not queue_.front().pinned or send_complete( queue_.front().last_send ) ) ) {
+    queue_.pop_front();
+    --first_unsent_;
+  }
+}
+
+void ZeroCopySender::add_rules( EventLoop& loop, size_t category_id )
+{
+  loop.add_rule(
+    category_id, socket_, Direction::Out, [this] { flush(); }, [this] { return buffered_bytes_ > 0; } );
+  loop.add_rule(
+    category_id, socket_, Direction::ErrorQueue, [this] { reap(); }, [this] { return not in_flight_.empty(); } );
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "eventloop.hh"
+#include "ref.hh"
+#include "socket.hh"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sends a socket's outgoing data with MSG_ZEROCOPY, so the kernel reads the payload straight out of our
+// buffers instead of copying it first.
+// 用 MSG_ZEROCOPY 发送数据：内核直接从我们的缓冲区读取数据，而不是先拷贝一份
+//
+// The sender owns every buffer pushed to it. A buffer is released once it has been sent and the kernel has
+// reported (on the socket's error queue, see reap()) that every send covering it is complete. Sends smaller
+// than the threshold are ordinary copying sends, because pinning pages costs more than copying a few KB; so
+// is everything after the kernel reports that it had to copy a zerocopy send anyway (e.g. over loopback).
+//
+// The socket must outlive the sender, and nothing else may make MSG_ZEROCOPY sends on it. Destroying the
+// sender with sends in flight frees buffers the kernel may still be reading: wait for sends_in_flight() == 0
+// (or close the socket) first.
+class ZeroCopySender
+{
+public:
+  // The kernel's guidance: MSG_ZEROCOPY is generally only effective above around 10 KB per send.
+  static constexpr size_t kDefaultThreshold = 10240;
+
+private:
+  static constexpr size_t kMaxBuffersPerSend = 64;
+
+  struct Entry
+  {
+    Ref<std::string> buffer;
+    bool pinned = false;    // part of a zerocopy send...
+    uint32_t last_send = 0; // ...the latest of which is this one
+  };
+
+  Socket& socket_;
+  size_t threshold_;
+  bool zerocopy_ = true;
+
+  std::deque<Entry> queue_ {}; // buffers sent but pinned, then unsent buffers
+  size_t first_unsent_ = 0;    // index in queue_
+  size_t offset_ = 0;          // bytes of queue_[first_unsent_] already sent
+  size_t buffered_bytes_ = 0;  // unsent bytes
+
+  uint32_t next_send_ = 0;        // number the kernel will give the next zerocopy send
+  uint32_t oldest_in_flight_ = 0; // number of in_flight_.front()
+  std::deque<bool> in_flight_ {}; // whether each zerocopy send since oldest_in_flight_ has completed
+
+  std::vector<std::string_view> views_ {}; // scratch space for flush()
+
+  uint64_t zerocopy_sends_ = 0;
+  uint64_t copying_sends_ = 0;
+  uint64_t copied_by_kernel_ = 0;
+
+  bool send_complete( uint32_t send ) const;
+  void release_sent();
+
+public:
+  // Enables SO_ZEROCOPY on `socket`. If the kernel refuses, every send copies.
+  explicit ZeroCopySender( Socket& socket, size_t threshold = kDefaultThreshold );
+
+  // Queue a buffer for sending. An owned Ref is moved in without copying; a borrowed one is copied.
+  void push( Ref<std::string> buffer );
+
+  // Send as much of the queue as the socket takes. Returns the number of bytes sent.
+  size_t flush();
+
+  // Process the completions on the socket's error queue, releasing buffers the kernel is done with.
+  // Returns the number of completion notifications read.
+  size_t reap();
+
+  // Add the rules that drive the sender: flush() while the socket is writable and data is queued, and
+  // reap() when the socket's error queue has completions (an EventLoop::Direction::ErrorQueue rule).
+  void add_rules( EventLoop& loop, size_t category_id );
+
+  size_t buffered_bytes() const { return buffered_bytes_; }
+  size_t buffers_held() const { return queue_.size(); } // unsent, or waiting for a completion
+  size_t sends_in_flight() const { return in_flight_.size(); }
+  bool zerocopy() const { return zerocopy_; } // whether sends above the threshold still use MSG_ZEROCOPY
+
+  uint64_t zerocopy_sends() const { return zerocopy_sends_; }
+  uint64_t copying_sends() const { return copying_sends_; }
+  uint64_t copied_by_kernel() const { return copied_by_kernel_; } // zerocopy sends the kernel copied anyway
+};